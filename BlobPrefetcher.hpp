@@ -0,0 +1,125 @@
+#ifndef BLOB_PREFETCHER_HPP
+#define BLOB_PREFETCHER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+// Loads a known list of objects ahead of the code that consumes them, in order.
+// Up to 'window' loads are queued or done-but-unconsumed at any time, so reads overlap (one round trip
+// per 'threads' files instead of per file on slow or network-mounted stores) while memory stays bounded.
+// No new load starts while the unconsumed files hold 'maxBytes' or more, so a run of large blobs is
+// buffered up to 'maxBytes' plus the at most 'threads' files already being loaded, not 'window' of them.
+// Decoding happens in the loader, i.e. on the worker threads as well.
+//
+//   BlobPrefetcher prefetch(loader, {hashA, hashB, ""}, 8, 64, 64 << 20);
+//   MappedFile a = prefetch.next(); // hashA; blocks until it has arrived
+//   MappedFile b = prefetch.next(); // hashB
+//   MappedFile none = prefetch.next(); // "" is never loaded: an empty (not open) file
+//
+// The loader must be thread-safe. Destroying the prefetcher early (e.g. a diff that stops after the
+// first file) skips the loads that have not started and waits for the running ones.
+class BlobPrefetcher {
+public:
+    using Loader = std::function<MappedFile(const std::string&)>;
+
+    BlobPrefetcher(Loader objectLoader, std::vector<std::string> objectHashes, unsigned int threads, size_t window,
+                   size_t maxBytes)
+        : loader(std::move(objectLoader)), hashes(std::move(objectHashes)), slots(hashes.size()),
+          windowSize(std::max<size_t>(window, 1)), byteLimit(std::max<size_t>(maxBytes, 1)) {
+        if (threads <= 1 || hashes.size() <= 1) return; // Nothing to overlap: next() loads inline
+        threadCount = static_cast<unsigned int>(std::min<size_t>(threads, hashes.size()));
+        pool = std::make_unique<ThreadPool>(threadCount);
+        std::lock_guard<std::mutex> lock(mutex);
+        refill();
+    }
+
+    ~BlobPrefetcher() {
+        cancelled.store(true, std::memory_order_relaxed);
+        pool.reset(); // Joins the workers; queued loads see 'cancelled' and return at once
+    }
+
+    BlobPrefetcher(const BlobPrefetcher&) = delete;
+    BlobPrefetcher& operator=(const BlobPrefetcher&) = delete;
+
+    size_t size() const { return hashes.size(); }
+
+    // The object of the next hash in the list (not open if it is missing or the hash is empty).
+    // Must be called at most size() times.
+    MappedFile next() {
+        if (!pool) return load(hashes[consumed++]);
+        std::unique_lock<std::mutex> lock(mutex);
+        const size_t i = consumed++;
+        arrived.wait(lock, [&] { return slots[i].done; });
+        MappedFile file = std::move(slots[i].file);
+        bufferedBytes -= file.size();
+        refill(); // The consumed slot frees a place in the window and its bytes
+        return file;
+    }
+
+private:
+    struct Slot {
+        MappedFile file;
+        bool done = false;
+    };
+
+    Loader loader;
+    std::vector<std::string> hashes;
+    std::vector<Slot> slots; // Guarded by 'mutex'
+    size_t windowSize;
+    size_t byteLimit;
+    unsigned int threadCount = 0;
+    size_t consumed = 0;      // Calls to next(); guarded by 'mutex' like the counters below once there is a pool
+    size_t scheduled = 0;     // Loads submitted to the pool, for hashes[0, scheduled)
+    size_t loading = 0;       // Submitted loads that have not finished
+    size_t bufferedBytes = 0; // Size of the finished files not consumed yet
+    std::atomic<bool> cancelled{false};
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::unique_ptr<ThreadPool> pool; // Last member: destroyed (joined) before everything its tasks use
+
+    MappedFile load(const std::string& hash) { return hash.empty() ? MappedFile() : loader(hash); }
+
+    // Submits the next loads the window, the byte budget and the thread count allow. Caller holds 'mutex'.
+    void refill() {
+        while (scheduled < hashes.size() && scheduled - consumed < windowSize && bufferedBytes < byteLimit &&
+               loading < threadCount) {
+            ++loading;
+            schedule(scheduled++);
+        }
+    }
+
+    void schedule(size_t i) {
+        pool->submit([this, i] {
+            MappedFile file;
+            if (!cancelled.load(std::memory_order_relaxed)) {
+                try {
+                    file = load(hashes[i]);
+                } catch (...) {
+                    // Reported as a missing object; the consumer must not wait forever
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bufferedBytes += file.size();
+                slots[i].file = std::move(file);
+                slots[i].done = true;
+                --loading;
+                if (!cancelled.load(std::memory_order_relaxed)) refill();
+            }
+            arrived.notify_all();
+        });
+    }
+};
+
+#endif // BLOB_PREFETCHER_HPP
@@ -0,0 +1,124 @@
+#ifndef BLOOM_FILTER_HPP
+#define BLOOM_FILTER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Encoding.hpp"
+#include "MappedFile.hpp"
+
+// Bloom filter over object IDs, persisted as .minigit/object-filter.
+// A negative answer is definite, so existence checks of objects that are not stored never touch the
+// object directory. A positive answer ("maybe") still has to be confirmed.
+//
+// File: "MGBF", u8 version, u8 hash count, u64 LE bit count, u64 LE item count, then the bit array.
+// The file is always replaced as a whole (serialize() through RefStore::writeFileAtomic()), so a crash never
+// leaves an item count that does not match the bits. A lost update (concurrent writer) only causes a false
+// negative, i.e. a redundant object write.
+class BloomFilter {
+public:
+    static constexpr std::string_view MAGIC = "MGBF";
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t BITS_PER_ITEM = 10; // ~1% false positives at capacity with 7 hashes
+    static constexpr uint8_t HASH_COUNT = 7;
+    static constexpr size_t HEADER_SIZE = 4 + 1 + 1 + 8 + 8;
+
+    // Empties the filter and sizes it for 'expectedItems' IDs.
+    void reset(size_t expectedItems) {
+        size_t bitCount = std::max<size_t>(expectedItems, 1024) * BITS_PER_ITEM;
+        bits.assign((bitCount + 7) / 8, 0);
+        hashes = HASH_COUNT;
+        items = 0;
+        dirty = true;
+    }
+
+    bool isOpen() const { return !bits.empty(); }
+    size_t size() const { return items; }
+    size_t capacity() const { return bits.size() * 8 / BITS_PER_ITEM; }
+
+    void add(std::string_view id) {
+        uint64_t h1, h2;
+        hashPair(id, h1, h2);
+        const uint64_t bitCount = bits.size() * 8;
+        for (uint8_t i = 0; i < hashes; ++i) {
+            uint64_t bit = (h1 + i * h2) % bitCount;
+            uint8_t mask = static_cast<uint8_t>(1u << (bit % 8));
+            bits[bit / 8] |= mask;
+        }
+        ++items;
+        dirty = true;
+    }
+
+    // False if 'id' was certainly never added.
+    bool mayContain(std::string_view id) const {
+        if (bits.empty()) return true;
+        uint64_t h1, h2;
+        hashPair(id, h1, h2);
+        const uint64_t bitCount = bits.size() * 8;
+        for (uint8_t i = 0; i < hashes; ++i) {
+            uint64_t bit = (h1 + i * h2) % bitCount;
+            if (!(bits[bit / 8] & (1u << (bit % 8)))) return false;
+        }
+        return true;
+    }
+
+    bool load(const std::string& path) {
+        bits.clear();
+        MappedFile file(path);
+        std::string_view data = file.view();
+        if (data.size() < HEADER_SIZE || data.substr(0, 4) != MAGIC || static_cast<uint8_t>(data[4]) != VERSION) return false;
+        uint64_t bitCount = readLE<uint64_t>(data.data() + 6), itemCount = readLE<uint64_t>(data.data() + 14);
+        if (bitCount == 0 || data.size() != HEADER_SIZE + (bitCount + 7) / 8 || data[5] == 0) return false;
+        hashes = static_cast<uint8_t>(data[5]);
+        items = static_cast<size_t>(itemCount);
+        bits.assign(data.begin() + HEADER_SIZE, data.end());
+        dirty = false;
+        return true;
+    }
+
+    // The whole file, for writing it from scratch (see RefStore::writeFileAtomic()).
+    std::string serialize() const {
+        std::string out = header();
+        out.append(bits.begin(), bits.end());
+        return out;
+    }
+
+    // True if IDs were added since load() or the last markClean(), i.e. the file is out of date.
+    bool isDirty() const { return dirty; }
+    void markClean() { dirty = false; }
+
+private:
+    std::vector<uint8_t> bits;
+    uint8_t hashes = HASH_COUNT;
+    size_t items = 0;
+    bool dirty = false;
+
+    std::string header() const {
+        std::string out(MAGIC);
+        out.push_back(static_cast<char>(VERSION));
+        out.push_back(static_cast<char>(hashes));
+        putLE(out, static_cast<uint64_t>(bits.size()) * 8);
+        putLE(out, static_cast<uint64_t>(items));
+        return out;
+    }
+
+    // Two 64-bit hashes for double hashing (h1 + i * h2): FNV-1a of the ID, finalized twice with splitmix64.
+    // IDs are hashed as strings, so legacy std::hash IDs work as well as SHA-256 or BLAKE3 ones.
+    static void hashPair(std::string_view id, uint64_t& h1, uint64_t& h2) {
+        uint64_t h = 14695981039346656037ULL;
+        for (char c : id) h = (h ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+        h1 = mix(h);
+        h2 = mix(h ^ 0x9e3779b97f4a7c15ULL) | 1; // Never 0, so the probes do not all land on the same bit
+    }
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+};
+
+#endif // BLOOM_FILTER_HPP
@@ -0,0 +1,135 @@
+#ifndef BYTE_SCAN_HPP
+#define BYTE_SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define MINIGIT_SCAN_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define MINIGIT_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Vectorized byte scanning for the content paths of 'diff': whole-buffer equality checks and
+// newline search for line splitting. SSE2 (every x86-64 CPU) and NEON (every AArch64 CPU) are
+// baseline, so the vector paths are chosen at compile time; other targets use memcmp/memchr.
+
+namespace scan_detail {
+
+#if defined(MINIGIT_SCAN_SSE2)
+inline unsigned lowestBit(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+// Offset of the first 'byte' in [data, data + size), or size if there is none.
+inline size_t findByte(const char* data, size_t size, char byte) {
+    size_t i = 0;
+#if defined(MINIGIT_SCAN_SSE2)
+    const __m128i needle = _mm_set1_epi8(byte);
+    for (; i + 32 <= size; i += 32) { // Two vectors per iteration: one branch per 32 bytes
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), needle);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16)), needle);
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(a)) | (static_cast<uint32_t>(_mm_movemask_epi8(b)) << 16);
+        if (mask) return i + lowestBit(mask);
+    }
+    for (; i + 16 <= size; i += 16) {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), needle);
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(a));
+        if (mask) return i + lowestBit(mask);
+    }
+#elif defined(MINIGIT_SCAN_NEON)
+    const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(byte));
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(data + i)), needle);
+        if (vmaxvq_u8(eq) == 0) continue;
+        // Narrow each byte of the match vector to 4 bits: the first set nibble is the first match
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        return i + static_cast<size_t>(__builtin_ctzll(mask)) / 4;
+    }
+#endif
+    const void* found = size > i ? std::memchr(data + i, byte, size - i) : nullptr;
+    return found ? static_cast<size_t>(static_cast<const char*>(found) - data) : size;
+}
+
+// True if [a, a + size) and [b, b + size) hold the same bytes. Exits at the first differing block.
+inline bool equalBytes(const char* a, const char* b, size_t size) {
+    size_t i = 0;
+#if defined(MINIGIT_SCAN_SSE2)
+    for (; i + 64 <= size; i += 64) { // Four vectors per comparison
+        __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16)));
+        __m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 32)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 32)));
+        __m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 48)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 48)));
+        __m128i all = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+        if (_mm_movemask_epi8(all) != 0xFFFF) return false;
+    }
+#elif defined(MINIGIT_SCAN_NEON)
+    for (; i + 64 <= size; i += 64) {
+        const uint8_t* pa = reinterpret_cast<const uint8_t*>(a + i);
+        const uint8_t* pb = reinterpret_cast<const uint8_t*>(b + i);
+        uint8x16_t e0 = vceqq_u8(vld1q_u8(pa), vld1q_u8(pb));
+        uint8x16_t e1 = vceqq_u8(vld1q_u8(pa + 16), vld1q_u8(pb + 16));
+        uint8x16_t e2 = vceqq_u8(vld1q_u8(pa + 32), vld1q_u8(pb + 32));
+        uint8x16_t e3 = vceqq_u8(vld1q_u8(pa + 48), vld1q_u8(pb + 48));
+        if (vminvq_u8(vandq_u8(vandq_u8(e0, e1), vandq_u8(e2, e3))) != 0xFF) return false;
+    }
+#endif
+    return size == i || std::memcmp(a + i, b + i, size - i) == 0;
+}
+
+} // namespace scan_detail
+
+// True if both buffers hold the same bytes. Sizes are compared first, so most changed files
+// are told apart without reading their content.
+inline bool sameContent(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    if (a.data() == b.data() || a.empty()) return true;
+    return scan_detail::equalBytes(a.data(), b.data(), a.size());
+}
+
+// Position of the first '\n' at or after 'from', or std::string_view::npos.
+inline size_t findNewline(std::string_view text, size_t from) {
+    if (from >= text.size()) return std::string_view::npos;
+    size_t offset = scan_detail::findByte(text.data() + from, text.size() - from, '\n');
+    return from + offset == text.size() ? std::string_view::npos : from + offset;
+}
+
+// Splits text into lines without their '\n'; a final line without '\n' is kept, an empty text has no lines.
+// 'lines' is overwritten; passing the same vector for every file reuses its storage.
+inline void splitLines(std::string_view text, std::vector<std::string_view>& lines) {
+    lines.clear();
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = findNewline(text, start);
+        if (end == std::string_view::npos) end = text.size();
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+inline std::vector<std::string_view> splitLines(std::string_view text) {
+    std::vector<std::string_view> lines;
+    splitLines(text, lines);
+    return lines;
+}
+
+#endif // BYTE_SCAN_HPP
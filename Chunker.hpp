@@ -0,0 +1,147 @@
+#ifndef CHUNKER_HPP
+#define CHUNKER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Content-defined chunking (FastCDC with normalized chunking) for large blobs.
+// Cut points depend only on the bytes around them, so an edit in one place of a large file
+// only changes the chunks that cover it; every other chunk keeps its hash and is stored once.
+//
+// The gear hash at position i is sum(gear[b[i-j]] << j) for j < 64: shifting by one bit per byte
+// drops the contribution of bytes more than 64 positions back. That makes the hash independent
+// of where scanning started, so the candidate scan runs four independent hash lanes over four
+// segments at once and the min/normal/max rules are applied afterwards in a cheap sequential pass.
+// The lanes are plain 64-bit registers: the CPU overlaps the four dependency chains, which measured
+// about 2x faster than one chain and faster than an AVX2 version (its table gathers dominate).
+
+namespace chunk_detail {
+
+constexpr size_t MIN_CHUNK = 16 * 1024;
+constexpr size_t AVG_CHUNK = 64 * 1024;
+constexpr size_t MAX_CHUNK = 256 * 1024;
+constexpr size_t WINDOW = 64;
+
+// Bits of the hash that must be zero for a cut. The high bits depend on the most bytes.
+// Before AVG_CHUNK the stricter mask applies, after it the looser one (normalization level 2).
+constexpr uint64_t MASK_STRICT = ~0ull << (64 - 18);
+constexpr uint64_t MASK_LOOSE = ~0ull << (64 - 14);
+
+inline const std::array<uint64_t, 256>& gearTable() {
+    static const std::array<uint64_t, 256> table = [] {
+        std::array<uint64_t, 256> values{};
+        uint64_t state = 0x6d696e6967697421ull; // Fixed seed: boundaries must be identical on every machine
+        for (uint64_t& value : values) { // splitmix64
+            state += 0x9e3779b97f4a7c15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            value = z ^ (z >> 31);
+        }
+        return values;
+    }();
+    return table;
+}
+
+// A position whose hash passes MASK_LOOSE; 'strict' if it also passes MASK_STRICT.
+// A cut at a candidate ends the chunk after that byte.
+struct Candidate {
+    size_t pos;
+    bool strict;
+};
+
+// Appends the candidates in [begin, end), hashing the WINDOW - 1 bytes before 'begin' first.
+inline void scanPortable(const uint8_t* data, size_t begin, size_t end, std::vector<Candidate>& out) {
+    const std::array<uint64_t, 256>& gear = gearTable();
+    uint64_t hash = 0;
+    for (size_t i = begin >= WINDOW - 1 ? begin - (WINDOW - 1) : 0; i < begin; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+    }
+    for (size_t i = begin; i < end; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & MASK_LOOSE) == 0) out.push_back({i, (hash & MASK_STRICT) == 0});
+    }
+}
+
+// Four hash lanes over four consecutive segments of the input, in lock-step.
+inline void scanLanes(const uint8_t* data, size_t size, std::vector<Candidate>& out) {
+    const std::array<uint64_t, 256>& gear = gearTable();
+    const size_t segment = size / 4;
+    const uint8_t* p0 = data;
+    const uint8_t* p1 = data + segment;
+    const uint8_t* p2 = data + 2 * segment;
+    const uint8_t* p3 = data + 3 * segment;
+
+    // Warm up lanes 1-3 on the bytes before their segment; lane 0 starts at the beginning of the input.
+    uint64_t h0 = 0, h1 = 0, h2 = 0, h3 = 0;
+    for (size_t back = WINDOW - 1; back > 0; --back) {
+        h1 = (h1 << 1) + gear[p1[-static_cast<std::ptrdiff_t>(back)]];
+        h2 = (h2 << 1) + gear[p2[-static_cast<std::ptrdiff_t>(back)]];
+        h3 = (h3 << 1) + gear[p3[-static_cast<std::ptrdiff_t>(back)]];
+    }
+
+    std::vector<Candidate> lanes[4];
+    for (size_t t = 0; t < segment; ++t) {
+        h0 = (h0 << 1) + gear[p0[t]];
+        h1 = (h1 << 1) + gear[p1[t]];
+        h2 = (h2 << 1) + gear[p2[t]];
+        h3 = (h3 << 1) + gear[p3[t]];
+        if ((h0 & MASK_LOOSE) && (h1 & MASK_LOOSE) && (h2 & MASK_LOOSE) && (h3 & MASK_LOOSE)) continue;
+        // Rare: about one position in 2^14 per lane
+        if (!(h0 & MASK_LOOSE)) lanes[0].push_back({t, (h0 & MASK_STRICT) == 0});
+        if (!(h1 & MASK_LOOSE)) lanes[1].push_back({segment + t, (h1 & MASK_STRICT) == 0});
+        if (!(h2 & MASK_LOOSE)) lanes[2].push_back({2 * segment + t, (h2 & MASK_STRICT) == 0});
+        if (!(h3 & MASK_LOOSE)) lanes[3].push_back({3 * segment + t, (h3 & MASK_STRICT) == 0});
+    }
+    for (const std::vector<Candidate>& lane : lanes) out.insert(out.end(), lane.begin(), lane.end());
+    scanPortable(data, 4 * segment, size, out); // Remainder that did not divide evenly
+}
+
+inline std::vector<Candidate> findCandidates(std::string_view content) {
+    std::vector<Candidate> candidates;
+    candidates.reserve(content.size() / (size_t(1) << 14) + 16);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(content.data());
+    if (content.size() >= 4 * MIN_CHUNK) {
+        scanLanes(data, content.size(), candidates);
+        return candidates;
+    }
+    scanPortable(data, 0, content.size(), candidates);
+    return candidates;
+}
+
+} // namespace chunk_detail
+
+// Splits 'content' into chunks and returns the end offset of each one (the last is content.size()).
+// Chunks are between MIN_CHUNK and MAX_CHUNK bytes (only the final chunk may be smaller).
+inline std::vector<size_t> chunkBoundaries(std::string_view content) {
+    using namespace chunk_detail;
+    std::vector<Candidate> candidates = findCandidates(content);
+    std::vector<size_t> ends;
+    size_t next = 0; // First candidate not yet passed
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t remaining = content.size() - start;
+        size_t cut = content.size();
+        if (remaining > MIN_CHUNK) {
+            size_t normalEnd = start + (remaining < AVG_CHUNK ? remaining : AVG_CHUNK);
+            size_t maxEnd = start + (remaining < MAX_CHUNK ? remaining : MAX_CHUNK);
+            cut = maxEnd;
+            while (next < candidates.size() && candidates[next].pos + 1 < start + MIN_CHUNK) ++next;
+            for (size_t k = next; k < candidates.size() && candidates[k].pos + 1 <= maxEnd; ++k) {
+                size_t end = candidates[k].pos + 1;
+                if (end < normalEnd ? candidates[k].strict : true) {
+                    cut = end;
+                    break;
+                }
+            }
+        }
+        ends.push_back(cut);
+        start = cut;
+    }
+    return ends;
+}
+
+#endif // CHUNKER_HPP
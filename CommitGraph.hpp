@@ -0,0 +1,363 @@
+#ifndef COMMIT_GRAPH_HPP
+#define COMMIT_GRAPH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "Encoding.hpp"
+#include "MappedFile.hpp"
+
+// Binary cache of the commit DAG (.minigit/commit-graph), so history walks and ancestry
+// queries never have to open or parse the per-commit text files.
+//
+// Layout (little-endian):
+//   "MGCG", u32 version, u32 commit count, u32 id width, u32 extra edge count
+//   count records sorted by commit ID:
+//       id (id width bytes, NUL-padded), u32 parent 1, u32 parent 2, u32 generation, i64 timestamp
+//   extra edge list: u32 each
+// Parents are record indices (NONE if absent). Commits with more than two parents store
+// EXTRA_EDGES | <offset> as parent 2; the extra edge list then holds the remaining parents,
+// the last one marked with LAST_EDGE.
+// generation = 1 + max(generation of parents), so a commit can only be an ancestor of commits
+// with a strictly larger generation, which prunes ancestry searches.
+//
+// Commits made since the file was written are appended to a tail file next to it (<path>-tail), so a commit
+// costs one small append instead of a rewrite of the whole graph; write() (gc) folds the tail back in.
+// Tail layout: "MGCT", u32 version, then per commit:
+//   u32 id length, id, i64 timestamp, u32 parent count, per parent: u32 id length, id
+// Parents precede their children (in the main file or earlier in the tail). Tail commits get the positions
+// after the main file's records; their generations are computed when the tail is loaded. A torn last record
+// (crash mid-append) is ignored, which only makes the next commit rebuild the graph.
+class CommitGraph {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t NONE = 0xffffffffu;
+    static constexpr uint32_t EXTRA_EDGES = 0x80000000u;
+    static constexpr uint32_t LAST_EDGE = 0x80000000u;
+
+    struct Entry {
+        std::string id;
+        std::vector<std::string> parents;
+        int64_t timestamp = 0; // Seconds since the epoch
+    };
+
+    // Opens the graph at 'path' and its tail. Returns false if the main file is missing or malformed.
+    bool open(const std::string& path) {
+        close();
+        tailPath = path + TAIL_SUFFIX;
+        if (!openMain(path)) return false;
+        loadTail();
+        return true;
+    }
+
+    void close() {
+        file.close();
+        count = 0;
+        tail.clear();
+        tailPositions.clear();
+    }
+
+    bool isOpen() const { return file.isOpen(); }
+    uint32_t size() const { return count + static_cast<uint32_t>(tail.size()); }
+
+    // Binary search by full commit ID, then the tail.
+    bool find(std::string_view id, uint32_t& position) const {
+        uint32_t lo = 0, hi = count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            int order = this->id(mid).compare(id);
+            if (order == 0) {
+                position = mid;
+                return true;
+            }
+            if (order < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        if (tail.empty()) return false;
+        auto it = tailPositions.find(std::string(id));
+        if (it == tailPositions.end()) return false;
+        position = it->second;
+        return true;
+    }
+
+    std::string_view id(uint32_t position) const {
+        if (position >= count) return tail[position - count].id;
+        std::string_view raw(record(position), idWidth);
+        size_t end = raw.find('\0');
+        return end == std::string_view::npos ? raw : raw.substr(0, end);
+    }
+
+    std::vector<uint32_t> parents(uint32_t position) const {
+        if (position >= count) return tail[position - count].parents;
+        std::vector<uint32_t> result;
+        const char* r = record(position) + idWidth;
+        uint32_t first = readLE<uint32_t>(r), second = readLE<uint32_t>(r + 4);
+        if (first != NONE) result.push_back(first);
+        if (second == NONE) return result;
+        if ((second & EXTRA_EDGES) == 0) {
+            result.push_back(second);
+            return result;
+        }
+        for (uint32_t edge = second & ~EXTRA_EDGES; edge < extraEdges; ++edge) {
+            uint32_t value = readLE<uint32_t>(edgeList() + 4 * static_cast<size_t>(edge));
+            result.push_back(value & ~LAST_EDGE);
+            if (value & LAST_EDGE) break;
+        }
+        return result;
+    }
+
+    uint32_t generation(uint32_t position) const {
+        if (position >= count) return tail[position - count].generation;
+        return readLE<uint32_t>(record(position) + idWidth + 8);
+    }
+    int64_t timestamp(uint32_t position) const {
+        if (position >= count) return tail[position - count].timestamp;
+        return static_cast<int64_t>(readLE<uint64_t>(record(position) + idWidth + 12));
+    }
+
+    // True if 'ancestor' is reachable from 'descendant' (a commit counts as its own ancestor).
+    // Only commits with a generation above the ancestor's need to be visited.
+    bool isAncestor(uint32_t ancestor, uint32_t descendant) const {
+        const uint32_t floor = generation(ancestor);
+        std::vector<uint32_t> stack{descendant};
+        std::vector<bool> seen(size(), false);
+        while (!stack.empty()) {
+            uint32_t current = stack.back();
+            stack.pop_back();
+            if (current == ancestor) return true;
+            if (seen[current] || generation(current) <= floor) continue;
+            seen[current] = true;
+            for (uint32_t parent : parents(current)) stack.push_back(parent);
+        }
+        return false;
+    }
+
+    // Reads every entry back (used to extend the graph with new commits).
+    std::vector<Entry> entries() const {
+        std::vector<Entry> result(size());
+        for (uint32_t i = 0; i < size(); ++i) {
+            result[i].id = std::string(id(i));
+            result[i].timestamp = timestamp(i);
+            for (uint32_t parent : parents(i)) result[i].parents.emplace_back(id(parent));
+        }
+        return result;
+    }
+
+    // Adds a commit whose parents are all in the graph by appending it to the tail file.
+    // Returns false (leaving the graph unchanged) if a parent is unknown or the tail cannot be written.
+    bool append(const Entry& entry) {
+        if (!isOpen()) return false;
+        TailCommit commit{entry.id, {}, entry.timestamp, 1};
+        for (const std::string& parent : entry.parents) {
+            uint32_t position;
+            if (!find(parent, position)) return false;
+            commit.parents.push_back(position);
+            commit.generation = std::max(commit.generation, generation(position) + 1);
+        }
+        std::string encoded;
+        std::error_code ec;
+        if (!std::filesystem::exists(tailPath, ec)) {
+            encoded = "MGCT";
+            putLE(encoded, VERSION);
+        }
+        putString(encoded, entry.id);
+        putLE(encoded, static_cast<uint64_t>(entry.timestamp));
+        putLE(encoded, static_cast<uint32_t>(entry.parents.size()));
+        for (const std::string& parent : entry.parents) putString(encoded, parent);
+        std::ofstream out(tailPath, std::ios::binary | std::ios::app);
+        out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+        out.close();
+        if (!out) return false;
+        tailPositions[commit.id] = size();
+        tail.push_back(std::move(commit));
+        return true;
+    }
+
+    // Writes a graph of 'commits' to 'path' (via a temporary file and rename) and removes its tail.
+    // Parents that are not among 'commits' are dropped; returns false if the file cannot be written.
+    static bool write(const std::string& path, std::vector<Entry> commits) {
+        std::sort(commits.begin(), commits.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+        commits.erase(std::unique(commits.begin(), commits.end(), [](const Entry& a, const Entry& b) { return a.id == b.id; }),
+                      commits.end());
+        std::unordered_map<std::string, uint32_t> positions;
+        uint32_t width = 0;
+        for (uint32_t i = 0; i < commits.size(); ++i) {
+            positions[commits[i].id] = i;
+            width = std::max(width, static_cast<uint32_t>(commits[i].id.size()));
+        }
+
+        std::vector<std::vector<uint32_t>> parentPositions(commits.size());
+        for (uint32_t i = 0; i < commits.size(); ++i) {
+            for (const std::string& parent : commits[i].parents) {
+                auto it = positions.find(parent);
+                if (it != positions.end()) parentPositions[i].push_back(it->second);
+            }
+        }
+        std::vector<uint32_t> generations = computeGenerations(parentPositions);
+
+        std::string temp = path + ".tmp";
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        std::vector<uint32_t> extra;
+        out.write("MGCG", 4);
+        writeLE(out, VERSION);
+        writeLE(out, static_cast<uint32_t>(commits.size()));
+        writeLE(out, width);
+        size_t extraCountOffset = 16;
+        writeLE(out, uint32_t(0)); // Extra edge count, patched below
+        for (uint32_t i = 0; i < commits.size(); ++i) {
+            std::string paddedId = commits[i].id;
+            paddedId.resize(width, '\0');
+            out.write(paddedId.data(), static_cast<std::streamsize>(paddedId.size()));
+            const std::vector<uint32_t>& ps = parentPositions[i];
+            writeLE(out, ps.size() > 0 ? ps[0] : NONE);
+            if (ps.size() <= 2) {
+                writeLE(out, ps.size() > 1 ? ps[1] : NONE);
+            } else {
+                writeLE(out, EXTRA_EDGES | static_cast<uint32_t>(extra.size()));
+                for (size_t p = 1; p < ps.size(); ++p) extra.push_back(ps[p] | (p + 1 == ps.size() ? LAST_EDGE : 0));
+            }
+            writeLE(out, generations[i]);
+            writeLE(out, static_cast<uint64_t>(commits[i].timestamp));
+        }
+        for (uint32_t edge : extra) writeLE(out, edge);
+        out.seekp(static_cast<std::streamoff>(extraCountOffset));
+        writeLE(out, static_cast<uint32_t>(extra.size()));
+        out.close();
+        if (!out || std::rename(temp.c_str(), path.c_str()) != 0) {
+            std::remove(temp.c_str());
+            return false;
+        }
+        std::remove((path + TAIL_SUFFIX).c_str()); // Its commits are in the new file (if left behind, load skips them)
+        return true;
+    }
+
+private:
+    static constexpr size_t HEADER_SIZE = 20;
+    static constexpr const char* TAIL_SUFFIX = "-tail";
+
+    struct TailCommit {
+        std::string id;
+        std::vector<uint32_t> parents; // Positions
+        int64_t timestamp = 0;
+        uint32_t generation = 1;
+    };
+
+    MappedFile file;
+    uint32_t count = 0;
+    uint32_t idWidth = 0;
+    uint32_t extraEdges = 0;
+    size_t recordSize = 0;
+    std::string tailPath;
+    std::vector<TailCommit> tail;                            // Positions count, count + 1, ...
+    std::unordered_map<std::string, uint32_t> tailPositions; // id -> position
+
+    bool openMain(const std::string& path) {
+        if (!file.open(path)) return false;
+        std::string_view data = file.view();
+        if (data.size() < HEADER_SIZE || data.substr(0, 4) != "MGCG" || readLE<uint32_t>(data.data() + 4) != VERSION) {
+            file.close();
+            return false;
+        }
+        uint32_t entries = readLE<uint32_t>(data.data() + 8);
+        idWidth = readLE<uint32_t>(data.data() + 12);
+        extraEdges = readLE<uint32_t>(data.data() + 16);
+        recordSize = idWidth + 20;
+        if (data.size() != HEADER_SIZE + static_cast<size_t>(entries) * recordSize + static_cast<size_t>(extraEdges) * 4) {
+            file.close();
+            return false;
+        }
+        count = entries;
+        return true;
+    }
+
+    void loadTail() {
+        MappedFile tailFile;
+        if (!tailFile.open(tailPath)) return;
+        std::string_view data = tailFile.view();
+        if (data.size() < 8 || data.substr(0, 4) != "MGCT" || readLE<uint32_t>(data.data() + 4) != VERSION) return;
+        data.remove_prefix(8);
+        while (!data.empty()) {
+            TailCommit commit;
+            uint64_t timestamp = 0;
+            uint32_t parentCount = 0;
+            if (!getString(data, commit.id) || !getLE(data, timestamp) || !getLE(data, parentCount)) return; // Torn record
+            commit.timestamp = static_cast<int64_t>(timestamp);
+            for (uint32_t i = 0; i < parentCount; ++i) {
+                std::string parent;
+                if (!getString(data, parent)) return;
+                uint32_t position;
+                if (!find(parent, position)) continue; // Dropped like unknown parents in write()
+                commit.parents.push_back(position);
+                commit.generation = std::max(commit.generation, generation(position) + 1);
+            }
+            uint32_t existing;
+            if (find(commit.id, existing)) continue; // Already folded into the main file
+            tailPositions[commit.id] = size();
+            tail.push_back(std::move(commit));
+        }
+    }
+
+    static void putString(std::string& out, const std::string& value) {
+        putLE(out, static_cast<uint32_t>(value.size()));
+        out += value;
+    }
+
+    template <typename T>
+    static bool getLE(std::string_view& data, T& value) {
+        if (data.size() < sizeof(T)) return false;
+        value = readLE<T>(data.data());
+        data.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    static bool getString(std::string_view& data, std::string& value) {
+        uint32_t length = 0;
+        if (!getLE(data, length) || data.size() < length) return false;
+        value.assign(data.substr(0, length));
+        data.remove_prefix(length);
+        return true;
+    }
+
+    const char* record(uint32_t position) const { return file.data() + HEADER_SIZE + static_cast<size_t>(position) * recordSize; }
+    const char* edgeList() const { return file.data() + HEADER_SIZE + static_cast<size_t>(count) * recordSize; }
+
+    // Iterative post-order walk, so deep histories don't overflow the stack.
+    static std::vector<uint32_t> computeGenerations(const std::vector<std::vector<uint32_t>>& parentPositions) {
+        std::vector<uint32_t> generations(parentPositions.size(), 0);
+        for (uint32_t start = 0; start < parentPositions.size(); ++start) {
+            if (generations[start] != 0) continue;
+            std::vector<std::pair<uint32_t, size_t>> stack{{start, 0}}; // (commit, next parent to visit)
+            generations[start] = NONE; // In progress
+            while (!stack.empty()) {
+                auto& [current, next] = stack.back();
+                const std::vector<uint32_t>& ps = parentPositions[current];
+                if (next < ps.size()) {
+                    uint32_t parent = ps[next++];
+                    if (generations[parent] == 0) {
+                        generations[parent] = NONE;
+                        stack.push_back({parent, 0});
+                    }
+                    continue;
+                }
+                uint32_t generation = 1;
+                for (uint32_t parent : ps) {
+                    if (generations[parent] != NONE) generation = std::max(generation, generations[parent] + 1); // NONE: cycle in a corrupt history
+                }
+                generations[current] = generation;
+                stack.pop_back();
+            }
+        }
+        return generations;
+    }
+};
+
+#endif // COMMIT_GRAPH_HPP
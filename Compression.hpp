@@ -0,0 +1,257 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Encoding.hpp"
+
+// Object compression and delta encoding, self-contained so MiniGit still builds with a plain
+// "g++ main.cpp" and no external libraries.
+//   - LZ: byte-oriented LZ77 in the style of LZ4 (fast to decode, ~2-4x on source code).
+//   - Envelope: method byte + raw size + payload; incompressible content is stored as-is.
+//   - Delta: copy/insert instructions that rebuild a target from a similar base (used by packfiles).
+
+namespace compression_detail {
+
+    inline uint32_t load32(const char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    // Lengths >= 15 continue in extra bytes of 255 (LZ4 convention).
+    inline void putLength(std::string& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(static_cast<char>(255));
+            length -= 255;
+        }
+        out.push_back(static_cast<char>(length));
+    }
+
+    inline bool getLength(std::string_view in, size_t& pos, size_t& length) {
+        for (;;) {
+            if (pos >= in.size()) return false;
+            uint8_t byte = static_cast<uint8_t>(in[pos++]);
+            length += byte;
+            if (byte != 255) return true;
+        }
+    }
+
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t MAX_OFFSET = 65535;
+    constexpr int HASH_BITS = 16;
+
+    inline uint32_t hashSequence(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+} // namespace compression_detail
+
+// Compresses 'input' into a sequence of (literals, match) tokens.
+inline std::string compressLz(std::string_view input) {
+    using namespace compression_detail;
+    std::string out;
+    out.reserve(input.size() / 2 + 16);
+    std::vector<uint32_t> table(size_t(1) << HASH_BITS, UINT32_MAX);
+
+    auto emitSequence = [&](size_t literalStart, size_t literalEnd, size_t offset, size_t matchLength) {
+        size_t literalLength = literalEnd - literalStart;
+        uint8_t token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+        if (matchLength > 0) {
+            size_t code = matchLength - MIN_MATCH;
+            token |= static_cast<uint8_t>(code >= 15 ? 15 : code);
+        }
+        out.push_back(static_cast<char>(token));
+        if (literalLength >= 15) putLength(out, literalLength - 15);
+        out.append(input.data() + literalStart, literalLength);
+        if (matchLength > 0) {
+            out.push_back(static_cast<char>(offset & 0xff));
+            out.push_back(static_cast<char>(offset >> 8));
+            if (matchLength - MIN_MATCH >= 15) putLength(out, matchLength - MIN_MATCH - 15);
+        }
+    };
+
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + MIN_MATCH <= input.size()) {
+        uint32_t sequence = load32(input.data() + pos);
+        uint32_t& slot = table[hashSequence(sequence)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(pos);
+        if (candidate != UINT32_MAX && pos - candidate <= MAX_OFFSET && load32(input.data() + candidate) == sequence) {
+            size_t length = MIN_MATCH;
+            while (pos + length < input.size() && input[candidate + length] == input[pos + length]) ++length;
+            emitSequence(anchor, pos, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+        } else {
+            ++pos;
+        }
+    }
+    emitSequence(anchor, input.size(), 0, 0); // Trailing literals end the stream
+    return out;
+}
+
+// Decompresses 'input' into exactly 'rawSize' bytes. Returns false if the stream is corrupt.
+inline bool decompressLz(std::string_view input, size_t rawSize, std::string& out) {
+    using namespace compression_detail;
+    out.clear();
+    out.reserve(rawSize);
+    size_t pos = 0;
+    while (pos < input.size()) {
+        uint8_t token = static_cast<uint8_t>(input[pos++]);
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !getLength(input, pos, literalLength)) return false;
+        if (literalLength > input.size() - pos || out.size() + literalLength > rawSize) return false;
+        out.append(input.data() + pos, literalLength);
+        pos += literalLength;
+        if (pos == input.size()) break; // Last sequence has no match
+
+        if (input.size() - pos < 2) return false;
+        size_t offset = static_cast<uint8_t>(input[pos]) | (static_cast<size_t>(static_cast<uint8_t>(input[pos + 1])) << 8);
+        pos += 2;
+        size_t matchLength = token & 0x0f;
+        if (matchLength == 15 && !getLength(input, pos, matchLength)) return false;
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > out.size() || out.size() + matchLength > rawSize) return false;
+        size_t from = out.size() - offset;
+        for (size_t i = 0; i < matchLength; ++i) out.push_back(out[from + i]); // Matches may overlap their output
+    }
+    return out.size() == rawSize;
+}
+
+enum class CompressionMethod : uint8_t { Stored = 0, Lz = 1 };
+
+// Wraps content as: method byte, varint raw size, payload. Falls back to Stored when LZ does not help.
+inline std::string encodeEnvelope(std::string_view content) {
+    // The LZ match table stores 32-bit positions, so very large objects are stored uncompressed.
+    std::string compressed = content.size() < UINT32_MAX ? compressLz(content) : std::string();
+    std::string out;
+    bool useLz = !compressed.empty() && compressed.size() < content.size();
+    out.push_back(static_cast<char>(useLz ? CompressionMethod::Lz : CompressionMethod::Stored));
+    putVarint(out, content.size());
+    if (useLz) out += compressed;
+    else out.append(content.data(), content.size());
+    return out;
+}
+
+// Reverses encodeEnvelope(). Returns false for unknown methods or corrupt payloads.
+inline bool decodeEnvelope(std::string_view envelope, std::string& content) {
+    if (envelope.empty()) return false;
+    size_t pos = 1;
+    uint64_t rawSize = 0;
+    if (!getVarint(envelope, pos, rawSize)) return false;
+    std::string_view payload = envelope.substr(pos);
+    switch (static_cast<CompressionMethod>(envelope[0])) {
+        case CompressionMethod::Stored:
+            if (payload.size() != rawSize) return false;
+            content.assign(payload.data(), payload.size());
+            return true;
+        case CompressionMethod::Lz:
+            return decompressLz(payload, static_cast<size_t>(rawSize), content);
+    }
+    return false;
+}
+
+// --- Delta encoding ---
+// Format: varint base size, varint target size, then instructions:
+//   0x00 <varint length> <bytes>      insert literal bytes
+//   0x01 <varint offset> <varint len> copy a range of the base
+
+namespace compression_detail {
+    constexpr size_t DELTA_BLOCK = 16; // Base is indexed at every DELTA_BLOCK-aligned offset
+
+    inline uint64_t hashBlock(const char* p) {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (size_t i = 0; i < DELTA_BLOCK; ++i) {
+            hash ^= static_cast<uint8_t>(p[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+// Encodes 'target' as instructions against 'base'.
+inline std::string encodeDelta(std::string_view base, std::string_view target) {
+    using namespace compression_detail;
+    std::string out;
+    putVarint(out, base.size());
+    putVarint(out, target.size());
+
+    std::unordered_map<uint64_t, size_t> blocks;
+    for (size_t offset = 0; offset + DELTA_BLOCK <= base.size(); offset += DELTA_BLOCK) {
+        blocks.emplace(hashBlock(base.data() + offset), offset); // First occurrence wins
+    }
+
+    size_t literalStart = 0;
+    auto flushLiterals = [&](size_t end) {
+        if (end > literalStart) {
+            out.push_back(0x00);
+            putVarint(out, end - literalStart);
+            out.append(target.data() + literalStart, end - literalStart);
+        }
+    };
+
+    size_t pos = 0;
+    while (pos + DELTA_BLOCK <= target.size()) {
+        auto it = blocks.find(hashBlock(target.data() + pos));
+        if (it == blocks.end() || base.compare(it->second, DELTA_BLOCK, target.substr(pos, DELTA_BLOCK)) != 0) {
+            ++pos;
+            continue;
+        }
+        // Extend the match backwards into pending literals, then forwards.
+        size_t baseStart = it->second, targetStart = pos;
+        while (baseStart > 0 && targetStart > literalStart && base[baseStart - 1] == target[targetStart - 1]) {
+            --baseStart;
+            --targetStart;
+        }
+        size_t length = pos - targetStart + DELTA_BLOCK;
+        while (baseStart + length < base.size() && targetStart + length < target.size() &&
+               base[baseStart + length] == target[targetStart + length]) {
+            ++length;
+        }
+        flushLiterals(targetStart);
+        out.push_back(0x01);
+        putVarint(out, baseStart);
+        putVarint(out, length);
+        pos = targetStart + length;
+        literalStart = pos;
+    }
+    flushLiterals(target.size());
+    return out;
+}
+
+// Rebuilds the target of encodeDelta(). Returns false if the delta does not fit 'base' or is corrupt.
+inline bool applyDelta(std::string_view base, std::string_view delta, std::string& target) {
+    using namespace compression_detail;
+    size_t pos = 0;
+    uint64_t baseSize = 0, targetSize = 0;
+    if (!getVarint(delta, pos, baseSize) || !getVarint(delta, pos, targetSize) || baseSize != base.size()) return false;
+    target.clear();
+    target.reserve(static_cast<size_t>(targetSize));
+    while (pos < delta.size()) {
+        uint8_t op = static_cast<uint8_t>(delta[pos++]);
+        if (op == 0x00) {
+            uint64_t length = 0;
+            if (!getVarint(delta, pos, length) || length > delta.size() - pos) return false;
+            target.append(delta.data() + pos, static_cast<size_t>(length));
+            pos += static_cast<size_t>(length);
+        } else if (op == 0x01) {
+            uint64_t offset = 0, length = 0;
+            if (!getVarint(delta, pos, offset) || !getVarint(delta, pos, length)) return false;
+            if (offset > base.size() || length > base.size() - offset) return false;
+            target.append(base.data() + offset, static_cast<size_t>(length));
+        } else {
+            return false;
+        }
+        if (target.size() > targetSize) return false;
+    }
+    return target.size() == targetSize;
+}
+
+#endif // COMPRESSION_HPP
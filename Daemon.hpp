@@ -0,0 +1,436 @@
+#ifndef DAEMON_HPP
+#define DAEMON_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef __linux__
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Daemon mode: one long-running process keeps the repository loaded and answers status/diff
+// requests from other minigit invocations over a Unix socket (.minigit/daemon.sock).
+//
+// Protocol: the client sends its arguments, each terminated by '\0', and shuts down its write side.
+// The daemon answers with one line "<exit status> <N>", then N bytes of diagnostics (what the command
+// writes to stderr in-process) and the command's output, then closes the connection. A client that
+// does not finish its request (or read the answer) within CLIENT_TIMEOUT is dropped.
+//
+// Only Linux is supported (inotify); elsewhere start() and listen() fail and minigit runs
+// every command in-process as before.
+
+// Reports changes below the working tree through inotify. Every non-hidden directory that the 'skip' predicate
+// passed to start() does not exclude (e.g. .minigitignore'd build output) is watched; directories created later
+// are added as their events arrive, and the tree is re-walked when the root .minigitignore changes. Changes inside .minigit (HEAD, refs,
+// index, packed-refs, commit-graph) are reported separately, so the daemon can reload repository state; files the daemon
+// replaced itself (see ignoreOwnWrites()) and temporary ".tmp"/".lock" files, which are renamed into place, are not.
+class FileWatcher {
+public:
+    struct Changes {
+        std::vector<std::string> paths; // Working-tree paths (files or directories) that changed
+        bool repositoryChanged = false; // Something in .minigit changed
+        bool overflow = false;          // Events were lost: everything must be rescanned
+    };
+
+    FileWatcher() = default;
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    ~FileWatcher() { stop(); }
+
+    // 'skip' is asked for each directory below the root ('/'-separated, relative to it).
+    using DirectoryFilter = std::function<bool(const std::string& dir)>;
+
+    bool start(DirectoryFilter skip = nullptr) {
+#ifdef __linux__
+        skipDirectory = std::move(skip);
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return false;
+        watchTree("");
+        for (const char* dir : REPOSITORY_DIRS) {
+            addWatch(dir, REPOSITORY + std::string(dir), IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_CLOSE_WRITE);
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        if (fd >= 0) ::close(fd);
+#endif
+        fd = -1;
+        watches.clear();
+        ownWrites.clear();
+    }
+
+    int descriptor() const { return fd; }
+
+    // Identity of one file in the watched .minigit directories, by path.
+    struct FileStamp {
+        uint64_t device = 0, inode = 0, size = 0;
+        int64_t mtimeNs = 0;
+        bool operator==(const FileStamp& other) const {
+            return device == other.device && inode == other.inode && size == other.size && mtimeNs == other.mtimeNs;
+        }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+    };
+    using Snapshot = std::unordered_map<std::string, FileStamp>;
+
+    // The files in the watched .minigit directories as they are now.
+    Snapshot snapshotRepository() const {
+        Snapshot files;
+#ifdef __linux__
+        for (const char* dir : REPOSITORY_DIRS) {
+            DIR* handle = ::opendir(dir);
+            if (!handle) continue;
+            while (const dirent* entry = ::readdir(handle)) {
+                if (entry->d_name[0] == '.') continue;
+                std::string path = std::string(dir) + "/" + entry->d_name;
+                FileStamp stamp;
+                if (stampOf(path, stamp)) files.emplace(std::move(path), stamp);
+            }
+            ::closedir(handle);
+        }
+#endif
+        return files;
+    }
+
+    // Files that differ from 'before' were written by this process (e.g. the index a status refreshed):
+    // their events are not reported as repository changes while they stay exactly as they are now.
+    // A file another process replaces in the same interval is taken for an own write as well.
+    void ignoreOwnWrites(const Snapshot& before) {
+        for (auto& [path, stamp] : snapshotRepository()) {
+            auto it = before.find(path);
+            if (it == before.end() || it->second != stamp) ownWrites[path] = stamp;
+        }
+    }
+
+    // Drains the pending events without blocking.
+    Changes poll() {
+        Changes changes;
+#ifdef __linux__
+        alignas(inotify_event) char buffer[16 * 1024];
+        bool rulesChanged = false;
+        for (;;) {
+            ssize_t length = ::read(fd, buffer, sizeof(buffer));
+            if (length <= 0) break; // EAGAIN: nothing left
+            for (char* p = buffer; p < buffer + length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW) {
+                    changes.overflow = true;
+                    continue;
+                }
+                auto it = watches.find(event->wd);
+                if (it == watches.end()) continue;
+                if (event->mask & IN_IGNORED) { // Directory removed (or unmounted)
+                    watches.erase(it);
+                    continue;
+                }
+                if (it->second.compare(0, REPOSITORY.size(), REPOSITORY) == 0) {
+                    if (!changes.repositoryChanged && !isOwnOrTransient(it->second.substr(REPOSITORY.size()), event)) {
+                        changes.repositoryChanged = true;
+                    }
+                    continue;
+                }
+                if (event->len != 0 && it->second.empty() && std::strcmp(event->name, ".minigitignore") == 0) rulesChanged = true;
+                if (event->len == 0 || event->name[0] == '.') continue; // Hidden files are not part of the working tree
+                std::string path = it->second.empty() ? event->name : it->second + "/" + event->name;
+                if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) watchTree(path);
+                changes.paths.push_back(std::move(path));
+            }
+        }
+        if (rulesChanged) watchTree(""); // Directories that are no longer ignored (existing watches are kept)
+#endif
+        return changes;
+    }
+
+private:
+    inline static const std::string REPOSITORY = "\x01"; // Prefix of the labels of watches inside .minigit
+    static constexpr const char* REPOSITORY_DIRS[] = {".minigit", ".minigit/refs/heads"};
+    int fd = -1;
+    std::unordered_map<int, std::string> watches; // watch descriptor -> directory ("" = root)
+    DirectoryFilter skipDirectory;
+    Snapshot ownWrites; // Files this process wrote, as it left them
+
+#ifdef __linux__
+    static bool stampOf(const std::string& path, FileStamp& stamp) {
+        struct stat info;
+        if (::lstat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) return false;
+        stamp.device = static_cast<uint64_t>(info.st_dev);
+        stamp.inode = static_cast<uint64_t>(info.st_ino);
+        stamp.size = static_cast<uint64_t>(info.st_size);
+        stamp.mtimeNs = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+        return true;
+    }
+
+    // True for events that do not change what the repository holds: the daemon's socket, temporary files
+    // (the rename that publishes them is an event of its own) and files still as this process wrote them.
+    bool isOwnOrTransient(const std::string& dir, const inotify_event* event) const {
+        if (event->len == 0) return false;
+        std::string name = event->name;
+        if (name == "daemon.sock") return true;
+        auto endsWith = [&](const char* suffix) {
+            size_t length = std::strlen(suffix);
+            return name.size() > length && name.compare(name.size() - length, length, suffix) == 0;
+        };
+        if (endsWith(".tmp") || endsWith(".lock")) return true;
+        auto own = ownWrites.find(dir + "/" + name);
+        FileStamp stamp;
+        return own != ownWrites.end() && stampOf(own->first, stamp) && stamp == own->second;
+    }
+#endif
+
+    void addWatch(const std::string& dir, const std::string& label, uint32_t mask) {
+#ifdef __linux__
+        int wd = inotify_add_watch(fd, dir.empty() ? "." : dir.c_str(), mask | IN_ONLYDIR);
+        if (wd >= 0) watches[wd] = label;
+#else
+        (void)dir; (void)label; (void)mask;
+#endif
+    }
+
+    // Watches 'dir' and every non-hidden, non-skipped directory below it.
+    void watchTree(const std::string& dir) {
+#ifdef __linux__
+        if (!dir.empty() && skipDirectory && skipDirectory(dir)) return;
+        addWatch(dir, dir, IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB);
+        DIR* handle = ::opendir(dir.empty() ? "." : dir.c_str());
+        if (!handle) return;
+        std::vector<std::string> subdirs;
+        while (const dirent* entry = ::readdir(handle)) {
+            if (entry->d_name[0] == '.') continue;
+            std::string path = dir.empty() ? entry->d_name : dir + "/" + entry->d_name;
+            bool isDir = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN) {
+                DIR* probe = ::opendir(path.c_str());
+                isDir = probe != nullptr;
+                if (probe) ::closedir(probe);
+            }
+            if (isDir) subdirs.push_back(std::move(path));
+        }
+        ::closedir(handle);
+        for (const std::string& subdir : subdirs) watchTree(subdir);
+#else
+        (void)dir;
+#endif
+    }
+};
+
+// Unix socket server and client for daemon requests.
+class DaemonSocket {
+public:
+    // Handles one request: fills 'output' (and 'errors' with its diagnostics) and returns the exit status.
+    // Setting 'stop' ends serve().
+    using Handler = std::function<int(const std::vector<std::string>& args, std::string& output, std::string& errors, bool& stop)>;
+
+    static constexpr std::chrono::milliseconds CLIENT_TIMEOUT{2000}; // To send the request, and to take the answer
+    static constexpr size_t MAX_REQUEST_BYTES = 1 << 20;
+
+    DaemonSocket() = default;
+    DaemonSocket(const DaemonSocket&) = delete;
+    DaemonSocket& operator=(const DaemonSocket&) = delete;
+    ~DaemonSocket() { close(); }
+
+    // Binds 'path'. A socket file left behind by a daemon that died is replaced;
+    // fails if another daemon still answers on it.
+    bool listen(const std::string& path) {
+#ifdef __linux__
+        sockaddr_un address;
+        if (!makeAddress(path, address)) return false;
+        std::string ignored, ignoredErrors;
+        if (request(path, {"ping"}, ignored, ignoredErrors) >= 0) return false; // Already running
+        ::unlink(path.c_str());
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0) {
+            close();
+            return false;
+        }
+        socketPath = path;
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    void close() {
+#ifdef __linux__
+        if (fd >= 0) ::close(fd);
+        if (!socketPath.empty()) ::unlink(socketPath.c_str());
+#endif
+        fd = -1;
+        socketPath.clear();
+    }
+
+    // Serves requests until a handler sets 'stop' or SIGINT/SIGTERM arrives. Before each request,
+    // pending watcher events are handed to onChanges, so answers reflect every change made before it.
+    // Requests are answered one at a time: a client that stalls is dropped after CLIENT_TIMEOUT.
+    void serve(FileWatcher& watcher, const std::function<void(const FileWatcher::Changes&)>& onChanges, const Handler& handle) {
+#ifdef __linux__
+        interrupted() = 0;
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+        std::signal(SIGPIPE, SIG_IGN); // A client that hangs up early must not kill the daemon
+        bool stop = false;
+        while (!stop && !interrupted()) {
+            pollfd fds[2] = {{fd, POLLIN, 0}, {watcher.descriptor(), POLLIN, 0}};
+            if (::poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (fds[1].revents & POLLIN) onChanges(watcher.poll()); // Batch events between requests
+            if (!(fds[0].revents & POLLIN)) continue;
+            int client = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (client < 0) continue;
+            std::string data;
+            if (!readRequest(client, data, Clock::now() + CLIENT_TIMEOUT)) {
+                ::close(client); // Unanswered: the client runs the command in-process
+                continue;
+            }
+            std::vector<std::string> args;
+            for (size_t start = 0, end; (end = data.find('\0', start)) != std::string::npos; start = end + 1) {
+                args.push_back(data.substr(start, end - start));
+            }
+            onChanges(watcher.poll());
+            std::string output, errors;
+            int status = 0;
+            if (args.size() != 1 || args[0] != "ping") {
+                FileWatcher::Snapshot before = watcher.snapshotRepository();
+                status = handle(args, output, errors, stop);
+                watcher.ignoreOwnWrites(before);
+            }
+            std::string response = std::to_string(status) + " " + std::to_string(errors.size()) + "\n" + errors + output;
+            writeAll(client, response, Clock::now() + CLIENT_TIMEOUT);
+            ::close(client);
+        }
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+#else
+        (void)watcher; (void)onChanges; (void)handle;
+#endif
+    }
+
+    // Sends one request to the daemon at 'path'. Returns its exit status, or -1 if no daemon answered.
+    static int request(const std::string& path, const std::vector<std::string>& args, std::string& output, std::string& errors) {
+#ifdef __linux__
+        sockaddr_un address;
+        if (!makeAddress(path, address)) return -1;
+        int client = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (client < 0) return -1;
+        if (::connect(client, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(client);
+            return -1;
+        }
+        std::string message;
+        for (const std::string& arg : args) message += arg + '\0';
+        std::signal(SIGPIPE, SIG_IGN);
+        if (!writeAll(client, message)) {
+            ::close(client);
+            return -1;
+        }
+        ::shutdown(client, SHUT_WR);
+        std::string response;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = ::read(client, buffer, sizeof(buffer))) > 0) response.append(buffer, static_cast<size_t>(n));
+        ::close(client);
+        size_t newline = response.find('\n');
+        if (newline == std::string::npos || newline == 0) return -1; // Daemon went away mid-request
+        const std::string header = response.substr(0, newline);
+        size_t space = header.find(' ');
+        size_t errorBytes = space == std::string::npos ? 0 : std::strtoull(header.c_str() + space + 1, nullptr, 10);
+        errorBytes = std::min(errorBytes, response.size() - newline - 1);
+        errors = response.substr(newline + 1, errorBytes);
+        output = response.substr(newline + 1 + errorBytes);
+        return std::atoi(header.c_str());
+#else
+        (void)path; (void)args; (void)output; (void)errors;
+        return -1;
+#endif
+    }
+
+private:
+    int fd = -1;
+    std::string socketPath;
+
+#ifdef __linux__
+    static volatile std::sig_atomic_t& interrupted() {
+        static volatile std::sig_atomic_t flag = 0;
+        return flag;
+    }
+    static void onSignal(int) { interrupted() = 1; }
+
+    static bool makeAddress(const std::string& path, sockaddr_un& address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) return false;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    // Waits until 'target' is ready for 'events'. False if 'deadline' passes first or poll() fails.
+    static bool waitFor(int target, short events, Clock::time_point deadline) {
+        for (;;) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (left <= 0) return false;
+            pollfd ready = {target, events, 0};
+            int n = ::poll(&ready, 1, static_cast<int>(std::min<decltype(left)>(left, INT_MAX)));
+            if (n > 0) return true; // Also on POLLHUP/POLLERR: the next read or write reports it
+            if (n == 0 || errno != EINTR) return false;
+        }
+    }
+
+    // Reads a request up to the client's end of file from the non-blocking 'client'.
+    static bool readRequest(int client, std::string& data, Clock::time_point deadline) {
+        char buffer[4096];
+        for (;;) {
+            ssize_t n = ::read(client, buffer, sizeof(buffer));
+            if (n == 0) return true;
+            if (n > 0) {
+                data.append(buffer, static_cast<size_t>(n));
+                if (data.size() > MAX_REQUEST_BYTES) return false;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (!waitFor(client, POLLIN, deadline)) return false;
+            } else if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    // Writes all of 'data'. A non-blocking 'target' is waited for until 'deadline'.
+    static bool writeAll(int target, const std::string& data, Clock::time_point deadline = Clock::time_point::max()) {
+        for (size_t written = 0; written < data.size();) {
+            ssize_t n = ::write(target, data.data() + written, data.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!waitFor(target, POLLOUT, deadline)) return false;
+                continue;
+            }
+            if (n <= 0) return false;
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+#endif
+};
+
+#endif // DAEMON_HPP
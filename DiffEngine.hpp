@@ -0,0 +1,370 @@
+#ifndef DIFF_ENGINE_HPP
+#define DIFF_ENGINE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ByteScan.hpp"
+#include "LineTable.hpp"
+
+// Line diff engine producing unified hunks.
+// Lines are interned to integer IDs first, so the algorithms only ever compare integers.
+//   - Myers: O(ND) with the linear-space divide-and-conquer ("middle snake") refinement.
+//   - Patience: anchors on lines that are unique on both sides, falls back to Myers between anchors.
+//   - Histogram: anchors on the least frequent common line, falls back to Myers for repetitive regions.
+
+enum class DiffAlgorithm { Myers, Patience, Histogram };
+
+// Parses "myers", "patience" or "histogram". Returns false for unknown names.
+inline bool parseDiffAlgorithm(const std::string& name, DiffAlgorithm& algorithm) {
+    if (name == "myers" || name == "default") algorithm = DiffAlgorithm::Myers;
+    else if (name == "patience") algorithm = DiffAlgorithm::Patience;
+    else if (name == "histogram") algorithm = DiffAlgorithm::Histogram;
+    else return false;
+    return true;
+}
+
+class DiffEngine {
+public:
+    struct Line {
+        char op; // ' ' context, '-' removed, '+' added
+        std::string_view text;
+    };
+
+    struct Hunk {
+        size_t oldStart = 0; // 1-based; for an empty range, the line before it (unified diff convention)
+        size_t oldCount = 0;
+        size_t newStart = 0;
+        size_t newCount = 0;
+        std::vector<Line> lines;
+    };
+
+    explicit DiffEngine(DiffAlgorithm algorithm = DiffAlgorithm::Myers, size_t contextLines = 3)
+        : algorithm(algorithm), contextLines(contextLines) {}
+
+    // Diffs two texts line by line. The returned hunks point into oldText/newText, which must outlive them.
+    std::vector<Hunk> diff(std::string_view oldText, std::string_view newText) {
+        splitLines(oldText, oldLines);
+        splitLines(newText, newLines);
+        lineTable.reset(); // IDs are per file; the table's storage is kept for the next one
+        lineTable.reserve(oldLines.size() + newLines.size());
+        internLines(oldLines, oldIds);
+        internLines(newLines, newIds);
+        oldChanged.assign(oldIds.size(), false);
+        newChanged.assign(newIds.size(), false);
+
+        switch (algorithm) {
+            case DiffAlgorithm::Myers: compareMyersFiltered(); break;
+            case DiffAlgorithm::Patience: comparePatience(0, oldIds.size(), 0, newIds.size()); break;
+            case DiffAlgorithm::Histogram: compareHistogram(0, oldIds.size(), 0, newIds.size()); break;
+        }
+        return buildHunks();
+    }
+
+private:
+    DiffAlgorithm algorithm;
+    size_t contextLines;
+
+    // Per-file working sets. The engine is reused for every file of a diff, so after the first few
+    // files these vectors and the line table have grown to size and nothing is allocated per line.
+    std::vector<std::string_view> oldLines, newLines;
+    std::vector<uint32_t> oldIds, newIds;
+    std::vector<bool> oldChanged, newChanged;
+    LineTable lineTable;
+    std::vector<long> forwardV, backwardV; // Myers furthest-reaching x per diagonal, reused across calls
+
+    void internLines(const std::vector<std::string_view>& lines, std::vector<uint32_t>& ids) {
+        ids.clear();
+        for (std::string_view line : lines) ids.push_back(lineTable.intern(line));
+    }
+
+    // Strips the common prefix and suffix of a region. Returns false once either side is empty
+    // (after marking the rest of the other side as changed).
+    bool trimRegion(size_t& aLo, size_t& aHi, size_t& bLo, size_t& bHi) {
+        while (aLo < aHi && bLo < bHi && oldIds[aLo] == newIds[bLo]) { ++aLo; ++bLo; }
+        while (aLo < aHi && bLo < bHi && oldIds[aHi - 1] == newIds[bHi - 1]) { --aHi; --bHi; }
+        if (aLo == aHi || bLo == bHi) {
+            for (size_t i = aLo; i < aHi; ++i) oldChanged[i] = true;
+            for (size_t j = bLo; j < bHi; ++j) newChanged[j] = true;
+            return false;
+        }
+        return true;
+    }
+
+    // --- Myers ---
+
+    void compareMyers(size_t aLo, size_t aHi, size_t bLo, size_t bHi) {
+        if (!trimRegion(aLo, aHi, bLo, bHi)) return;
+        size_t splitA = 0, splitB = 0;
+        middleSnake(aLo, aHi, bLo, bHi, splitA, splitB);
+        compareMyers(aLo, splitA, bLo, splitB);
+        compareMyers(splitA, aHi, splitB, bHi);
+    }
+
+    // Lines that never occur on the other side cannot be part of any common subsequence. They are marked
+    // changed up front and left out of the O(ND) search, so rewritten files no longer cost O(N^2).
+    void compareMyersFiltered() {
+        std::vector<bool> inOld(lineTable.size(), false), inNew(lineTable.size(), false);
+        for (uint32_t id : oldIds) inOld[id] = true;
+        for (uint32_t id : newIds) inNew[id] = true;
+
+        std::vector<size_t> oldKept, newKept;
+        for (size_t i = 0; i < oldIds.size(); ++i) {
+            if (inNew[oldIds[i]]) oldKept.push_back(i);
+            else oldChanged[i] = true;
+        }
+        for (size_t j = 0; j < newIds.size(); ++j) {
+            if (inOld[newIds[j]]) newKept.push_back(j);
+            else newChanged[j] = true;
+        }
+        if (oldKept.size() == oldIds.size() && newKept.size() == newIds.size()) {
+            compareMyers(0, oldIds.size(), 0, newIds.size());
+            return;
+        }
+
+        // Run the search on the kept lines only, then map the result back to the full sequences.
+        std::vector<uint32_t> fullOldIds = std::move(oldIds), fullNewIds = std::move(newIds);
+        std::vector<bool> fullOldChanged = std::move(oldChanged), fullNewChanged = std::move(newChanged);
+        oldIds.clear();
+        newIds.clear();
+        for (size_t i : oldKept) oldIds.push_back(fullOldIds[i]);
+        for (size_t j : newKept) newIds.push_back(fullNewIds[j]);
+        oldChanged.assign(oldIds.size(), false);
+        newChanged.assign(newIds.size(), false);
+        compareMyers(0, oldIds.size(), 0, newIds.size());
+        for (size_t i = 0; i < oldKept.size(); ++i) fullOldChanged[oldKept[i]] = oldChanged[i];
+        for (size_t j = 0; j < newKept.size(); ++j) fullNewChanged[newKept[j]] = newChanged[j];
+        oldIds = std::move(fullOldIds);
+        newIds = std::move(fullNewIds);
+        oldChanged = std::move(fullOldChanged);
+        newChanged = std::move(fullNewChanged);
+    }
+
+    // Finds a point on an optimal edit path by running the search from both ends until they overlap.
+    // The point is never a corner of the region, so both halves are strictly smaller.
+    void middleSnake(size_t aLo, size_t aHi, size_t bLo, size_t bHi, size_t& splitA, size_t& splitB) {
+        const long n = static_cast<long>(aHi - aLo);
+        const long m = static_cast<long>(bHi - bLo);
+        const long delta = n - m;
+        const bool odd = (delta & 1) != 0;
+        const long maxD = (n + m + 1) / 2;
+        const long offset = maxD + 1;
+        forwardV.assign(static_cast<size_t>(2 * offset + 1), 0);
+        backwardV.assign(static_cast<size_t>(2 * offset + 1), 0);
+        long* vf = forwardV.data() + offset;
+        long* vb = backwardV.data() + offset;
+
+        for (long d = 0; d <= maxD; ++d) {
+            for (long k = -d; k <= d; k += 2) {
+                long x = (k == -d || (k != d && vf[k - 1] < vf[k + 1])) ? vf[k + 1] : vf[k - 1] + 1;
+                long y = x - k;
+                while (x < n && y < m && oldIds[aLo + x] == newIds[bLo + y]) { ++x; ++y; }
+                vf[k] = x;
+                long reverseK = delta - k;
+                if (odd && reverseK >= -(d - 1) && reverseK <= d - 1 && x + vb[reverseK] >= n) {
+                    splitA = aLo + static_cast<size_t>(x);
+                    splitB = bLo + static_cast<size_t>(y);
+                    return;
+                }
+            }
+            for (long k = -d; k <= d; k += 2) {
+                long x = (k == -d || (k != d && vb[k - 1] < vb[k + 1])) ? vb[k + 1] : vb[k - 1] + 1;
+                long y = x - k;
+                while (x < n && y < m && oldIds[aHi - 1 - x] == newIds[bHi - 1 - y]) { ++x; ++y; }
+                vb[k] = x;
+                long forwardK = delta - k;
+                if (!odd && forwardK >= -d && forwardK <= d && x + vf[forwardK] >= n) {
+                    splitA = aHi - static_cast<size_t>(x);
+                    splitB = bHi - static_cast<size_t>(y);
+                    return;
+                }
+            }
+        }
+        // Unreachable for non-empty regions; split in the middle to stay safe.
+        splitA = aLo + static_cast<size_t>(n) / 2;
+        splitB = bLo + static_cast<size_t>(m) / 2;
+    }
+
+    // --- Patience ---
+
+    void comparePatience(size_t aLo, size_t aHi, size_t bLo, size_t bHi) {
+        if (!trimRegion(aLo, aHi, bLo, bHi)) return;
+
+        struct Occurrence {
+            size_t countA = 0, countB = 0;
+            size_t posA = 0, posB = 0;
+        };
+        std::unordered_map<uint32_t, Occurrence> occurrences;
+        for (size_t i = aLo; i < aHi; ++i) {
+            Occurrence& occ = occurrences[oldIds[i]];
+            ++occ.countA;
+            occ.posA = i;
+        }
+        for (size_t j = bLo; j < bHi; ++j) {
+            auto it = occurrences.find(newIds[j]);
+            if (it != occurrences.end()) {
+                ++it->second.countB;
+                it->second.posB = j;
+            }
+        }
+
+        // Lines unique on both sides, in old order; their longest increasing run by new position are the anchors.
+        std::vector<std::pair<size_t, size_t>> unique;
+        for (size_t i = aLo; i < aHi; ++i) {
+            const Occurrence& occ = occurrences[oldIds[i]];
+            if (occ.countA == 1 && occ.countB == 1) unique.emplace_back(i, occ.posB);
+        }
+        std::vector<std::pair<size_t, size_t>> anchors = longestIncreasingByNew(unique);
+        if (anchors.empty()) {
+            compareMyers(aLo, aHi, bLo, bHi);
+            return;
+        }
+
+        size_t prevA = aLo, prevB = bLo;
+        for (const auto& [anchorA, anchorB] : anchors) {
+            comparePatience(prevA, anchorA, prevB, anchorB);
+            prevA = anchorA + 1;
+            prevB = anchorB + 1;
+        }
+        comparePatience(prevA, aHi, prevB, bHi);
+    }
+
+    // Patience sorting: longest subsequence of 'pairs' (sorted by old position) with increasing new positions.
+    static std::vector<std::pair<size_t, size_t>> longestIncreasingByNew(const std::vector<std::pair<size_t, size_t>>& pairs) {
+        std::vector<size_t> pileTops;            // Index into 'pairs' of the top card of each pile
+        std::vector<long> previous(pairs.size(), -1);
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            auto pile = std::lower_bound(pileTops.begin(), pileTops.end(), pairs[i].second,
+                                         [&](size_t top, size_t value) { return pairs[top].second < value; });
+            if (pile != pileTops.begin()) previous[i] = static_cast<long>(*(pile - 1));
+            if (pile == pileTops.end()) pileTops.push_back(i);
+            else *pile = i;
+        }
+        std::vector<std::pair<size_t, size_t>> result;
+        for (long i = pileTops.empty() ? -1 : static_cast<long>(pileTops.back()); i >= 0; i = previous[static_cast<size_t>(i)]) {
+            result.push_back(pairs[static_cast<size_t>(i)]);
+        }
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    // --- Histogram ---
+
+    void compareHistogram(size_t aLo, size_t aHi, size_t bLo, size_t bHi) {
+        // The right-hand side is handled by looping, so recursion depth only grows with nested regions.
+        while (trimRegion(aLo, aHi, bLo, bHi)) {
+            size_t anchorA0, anchorA1, anchorB0, anchorB1;
+            if (!findHistogramAnchor(aLo, aHi, bLo, bHi, anchorA0, anchorA1, anchorB0, anchorB1)) {
+                compareMyers(aLo, aHi, bLo, bHi);
+                return;
+            }
+            compareHistogram(aLo, anchorA0, bLo, anchorB0);
+            aLo = anchorA1;
+            bLo = anchorB1;
+        }
+    }
+
+    // Finds the longest common run around the least frequent line shared by both sides of a region.
+    // Returns false if every shared line occurs more than MAX_CHAIN times in the old side.
+    bool findHistogramAnchor(size_t aLo, size_t aHi, size_t bLo, size_t bHi,
+                             size_t& bestA0, size_t& bestA1, size_t& bestB0, size_t& bestB1) const {
+        static constexpr size_t MAX_CHAIN = 64; // Lines more frequent than this are not used as anchors
+        std::unordered_map<uint32_t, std::vector<size_t>> oldPositions;
+        for (size_t i = aLo; i < aHi; ++i) oldPositions[oldIds[i]].push_back(i);
+
+        size_t bestCount = MAX_CHAIN + 1;
+        bestA0 = bestA1 = bestB0 = bestB1 = 0;
+        const size_t middle = bLo + (bHi - bLo) / 2;
+        for (size_t j = bLo; j < bHi;) {
+            size_t next = j + 1;
+            auto it = oldPositions.find(newIds[j]);
+            if (it != oldPositions.end() && it->second.size() <= bestCount) {
+                for (size_t i : it->second) {
+                    size_t a0 = i, b0 = j, a1 = i + 1, b1 = j + 1;
+                    while (a0 > aLo && b0 > bLo && oldIds[a0 - 1] == newIds[b0 - 1]) { --a0; --b0; }
+                    while (a1 < aHi && b1 < bHi && oldIds[a1] == newIds[b1]) { ++a1; ++b1; }
+                    // Fewer occurrences win, then longer runs, then runs nearer the middle (keeps recursion balanced).
+                    bool better = it->second.size() < bestCount || (a1 - a0) > (bestA1 - bestA0) ||
+                                  ((a1 - a0) == (bestA1 - bestA0) && distanceFrom(middle, b0, b1) < distanceFrom(middle, bestB0, bestB1));
+                    if (better) {
+                        bestCount = it->second.size();
+                        bestA0 = a0; bestA1 = a1; bestB0 = b0; bestB1 = b1;
+                    }
+                    next = std::max(next, b1); // Lines inside this run cannot start a longer one
+                }
+            }
+            j = next;
+        }
+        return bestCount <= MAX_CHAIN;
+    }
+
+    static size_t distanceFrom(size_t middle, size_t begin, size_t end) {
+        size_t center = begin + (end - begin) / 2;
+        return center > middle ? center - middle : middle - center;
+    }
+
+    // --- Hunks ---
+
+    std::vector<Hunk> buildHunks() const {
+        struct Op {
+            char op;
+            size_t oldIndex, newIndex; // Position on each side when the op starts
+        };
+        std::vector<Op> ops;
+        size_t i = 0, j = 0;
+        while (i < oldIds.size() || j < newIds.size()) {
+            if (i < oldIds.size() && oldChanged[i]) {
+                ops.push_back({'-', i, j});
+                ++i;
+            } else if (j < newIds.size() && newChanged[j]) {
+                ops.push_back({'+', i, j});
+                ++j;
+            } else {
+                ops.push_back({' ', i, j});
+                ++i;
+                ++j;
+            }
+        }
+
+        std::vector<Hunk> hunks;
+        size_t k = 0;
+        while (k < ops.size()) {
+            while (k < ops.size() && ops[k].op == ' ') ++k;
+            if (k == ops.size()) break;
+
+            // Extend the hunk while the gap between changes is small enough for contexts to touch.
+            size_t begin = k >= contextLines ? k - contextLines : 0;
+            size_t end = k;
+            while (end < ops.size()) {
+                size_t nextChange = end;
+                while (nextChange < ops.size() && ops[nextChange].op != ' ') ++nextChange;
+                size_t gapEnd = nextChange;
+                while (gapEnd < ops.size() && ops[gapEnd].op == ' ') ++gapEnd;
+                if (gapEnd == ops.size() || gapEnd - nextChange > 2 * contextLines) {
+                    end = std::min(ops.size(), nextChange + contextLines);
+                    break;
+                }
+                end = gapEnd;
+            }
+
+            Hunk hunk;
+            for (size_t n = begin; n < end; ++n) {
+                const Op& op = ops[n];
+                if (op.op != '+') ++hunk.oldCount;
+                if (op.op != '-') ++hunk.newCount;
+                hunk.lines.push_back({op.op, op.op == '+' ? newLines[op.newIndex] : oldLines[op.oldIndex]});
+            }
+            hunk.oldStart = ops[begin].oldIndex + (hunk.oldCount > 0 ? 1 : 0);
+            hunk.newStart = ops[begin].newIndex + (hunk.newCount > 0 ? 1 : 0);
+            hunks.push_back(std::move(hunk));
+            k = end;
+        }
+        return hunks;
+    }
+};
+
+#endif // DIFF_ENGINE_HPP
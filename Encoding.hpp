@@ -0,0 +1,76 @@
+#ifndef ENCODING_HPP
+#define ENCODING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Integer encodings shared by the binary file formats (index, packs, commit-graph, object filter,
+// object envelopes and format 4 objects), so each format only describes its layout.
+//   - Little-endian fixed width: 'bytes' (or sizeof(T)) bytes, least significant first.
+//   - Varint: 7 bits per byte, least significant group first, high bit set on all but the last byte.
+
+inline uint64_t readLE(const char* p, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return value;
+}
+
+template <typename T>
+T readLE(const char* p) {
+    return static_cast<T>(readLE(p, sizeof(T)));
+}
+
+inline void putLE(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+template <typename T>
+void putLE(std::string& out, T value) {
+    putLE(out, static_cast<uint64_t>(value), sizeof(T));
+}
+
+inline void writeLE(std::ostream& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) out.put(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+template <typename T>
+void writeLE(std::ostream& out, T value) {
+    writeLE(out, static_cast<uint64_t>(value), sizeof(T));
+}
+
+// Returns false if the stream ends first.
+inline bool readLE(std::istream& in, uint64_t& value, size_t bytes) {
+    value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        int c = in.get();
+        if (c == std::char_traits<char>::eof()) return false;
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(c)) << (8 * i);
+    }
+    return true;
+}
+
+inline void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Decodes the varint at in[pos] and advances 'pos'. Returns false if it is truncated or longer than 64 bits.
+inline bool getVarint(std::string_view in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) return false;
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+#endif // ENCODING_HPP
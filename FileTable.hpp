@@ -0,0 +1,162 @@
+#ifndef FILE_TABLE_HPP
+#define FILE_TABLE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Compact, shareable snapshots of a commit's files (path -> blob).
+// Paths are interned once per process in a PathTable; blob IDs are stored as fixed-size ObjectIds; the
+// entries of a snapshot live in one sorted, immutable FileTable that every commit with the same root
+// tree shares. A snapshot of n files therefore costs one small vector instead of n map nodes and 2n strings.
+
+// An object ID in 34 bytes, without heap storage. Hex IDs (SHA-256, BLAKE3: 64 digits) are kept as
+// their binary value; anything else of up to 32 characters (legacy decimal std::hash IDs) verbatim.
+class ObjectId {
+public:
+    static constexpr size_t MAX_BYTES = 32;
+
+    ObjectId() = default;
+
+    // False if 'id' fits neither form.
+    static bool parse(std::string_view id, ObjectId& out) {
+        out = ObjectId();
+        if (isLowerHex(id) && id.size() % 2 == 0 && id.size() / 2 <= MAX_BYTES) {
+            out.kind = HEX;
+            out.length = static_cast<uint8_t>(id.size() / 2);
+            for (size_t i = 0; i < out.length; ++i) {
+                out.bytes[i] = static_cast<uint8_t>(nibble(id[2 * i]) << 4 | nibble(id[2 * i + 1]));
+            }
+            return true;
+        }
+        if (id.size() > MAX_BYTES) return false;
+        out.kind = TEXT;
+        out.length = static_cast<uint8_t>(id.size());
+        std::copy(id.begin(), id.end(), out.bytes.begin());
+        return true;
+    }
+
+    bool empty() const { return length == 0; }
+
+    std::string toString() const {
+        if (kind == TEXT) return std::string(bytes.begin(), bytes.begin() + length);
+        static const char digits[] = "0123456789abcdef";
+        std::string hex(2 * length, '0');
+        for (size_t i = 0; i < length; ++i) {
+            hex[2 * i] = digits[bytes[i] >> 4];
+            hex[2 * i + 1] = digits[bytes[i] & 0x0F];
+        }
+        return hex;
+    }
+
+    bool operator==(const ObjectId& other) const {
+        return kind == other.kind && length == other.length && std::equal(bytes.begin(), bytes.begin() + length, other.bytes.begin());
+    }
+    bool operator!=(const ObjectId& other) const { return !(*this == other); }
+
+private:
+    static constexpr uint8_t HEX = 0, TEXT = 1;
+    std::array<uint8_t, MAX_BYTES> bytes{};
+    uint8_t length = 0;
+    uint8_t kind = HEX;
+
+    static bool isLowerHex(std::string_view id) {
+        return !id.empty() && std::all_of(id.begin(), id.end(), [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'); });
+    }
+    static int nibble(char c) { return c <= '9' ? c - '0' : c - 'a' + 10; }
+};
+
+// Every distinct path seen by the process, stored once. IDs are dense and never reused.
+class PathTable {
+public:
+    uint32_t intern(std::string_view path) {
+        auto it = ids.find(path);
+        if (it != ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(paths.size());
+        paths.emplace_back(path);
+        ids.emplace(paths.back(), id); // Keyed by a view of the stored string (deque elements never move)
+        return id;
+    }
+
+    const std::string& path(uint32_t id) const { return paths[id]; }
+
+private:
+    std::deque<std::string> paths;
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+// The files of one snapshot, sorted by path. Immutable once built, so it can be shared freely.
+class FileTable {
+public:
+    struct Entry {
+        uint32_t path; // PathTable ID
+        ObjectId blob;
+    };
+
+    // Builds the table for a flat path -> blob map. Paths are interned in 'pathTable', which must outlive the table
+    // (it is kept alive by the shared pointer).
+    static std::shared_ptr<const FileTable> build(const std::unordered_map<std::string, std::string>& files,
+                                                  std::shared_ptr<PathTable> pathTable) {
+        std::shared_ptr<FileTable> table(new FileTable(std::move(pathTable)));
+        std::vector<const std::pair<const std::string, std::string>*> sorted;
+        sorted.reserve(files.size());
+        for (const auto& file : files) sorted.push_back(&file);
+        std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+        table->entries.reserve(sorted.size());
+        for (const auto* file : sorted) {
+            Entry entry{table->paths->intern(file->first), ObjectId()};
+            ObjectId::parse(file->second, entry.blob); // Every ID the hash engines produce fits
+            table->entries.push_back(entry);
+        }
+        return table;
+    }
+
+    static const FileTable& empty() {
+        static const FileTable none(std::make_shared<PathTable>());
+        return none;
+    }
+
+    size_t size() const { return entries.size(); }
+    std::vector<Entry>::const_iterator begin() const { return entries.begin(); }
+    std::vector<Entry>::const_iterator end() const { return entries.end(); }
+
+    const std::string& path(const Entry& entry) const { return paths->path(entry.path); }
+
+    // The entry for 'filePath', or nullptr (binary search).
+    const Entry* find(std::string_view filePath) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), filePath,
+                                   [&](const Entry& entry, std::string_view key) { return std::string_view(path(entry)) < key; });
+        return it != entries.end() && path(*it) == filePath ? &*it : nullptr;
+    }
+
+    bool contains(std::string_view filePath) const { return find(filePath) != nullptr; }
+
+    // Blob hash of 'filePath', or "" if the snapshot does not contain it.
+    std::string blob(std::string_view filePath) const {
+        const Entry* entry = find(filePath);
+        return entry ? entry->blob.toString() : std::string();
+    }
+
+    // A mutable copy, e.g. as the starting point of the next commit's snapshot.
+    std::unordered_map<std::string, std::string> toMap() const {
+        std::unordered_map<std::string, std::string> files;
+        files.reserve(entries.size());
+        for (const Entry& entry : entries) files.emplace(path(entry), entry.blob.toString());
+        return files;
+    }
+
+private:
+    explicit FileTable(std::shared_ptr<PathTable> pathTable) : paths(std::move(pathTable)) {}
+
+    std::shared_ptr<PathTable> paths;
+    std::vector<Entry> entries;
+};
+
+#endif // FILE_TABLE_HPP
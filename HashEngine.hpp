@@ -0,0 +1,457 @@
+#ifndef HASH_ENGINE_HPP
+#define HASH_ENGINE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <functional> // For std::hash (legacy repositories)
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MINIGIT_SHA256_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define MINIGIT_SHA256_ARM 1
+#include <arm_neon.h>
+#endif
+
+// Content hashing for MiniGit objects.
+// Every engine has the same streaming interface, so files can be hashed chunk by chunk
+// without ever holding the whole content in memory.
+
+enum class HashAlgorithm {
+    LegacyStdHash, // std::hash<std::string>, used by repositories created before the format marker existed
+    Sha256,        // Default for new repositories
+    Blake3         // Faster alternative, selected with 'init --hash=blake3'
+};
+
+class Hasher {
+public:
+    virtual ~Hasher() = default;
+    virtual void update(const void* data, size_t length) = 0;
+    // Returns the digest as a lowercase hex string (decimal for the legacy engine).
+    virtual std::string finalize() = 0;
+
+    void update(const std::string& data) { update(data.data(), data.size()); }
+};
+
+namespace hash_detail {
+
+inline std::string toHex(const uint8_t* bytes, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(length * 2, '0');
+    for (size_t i = 0; i < length; ++i) {
+        hex[2 * i] = digits[bytes[i] >> 4];
+        hex[2 * i + 1] = digits[bytes[i] & 0x0F];
+    }
+    return hex;
+}
+
+inline uint32_t rotr32(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline uint32_t loadBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline uint32_t loadLE32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+alignas(16) static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Portable SHA-256 compression of 'blocks' consecutive 64-byte blocks.
+inline void sha256CompressPortable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    for (; blocks > 0; --blocks, data += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) w[i] = loadBE32(data + 4 * i);
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#if defined(MINIGIT_SHA256_X86)
+// SHA-NI path. The state is kept in the ABEF/CDGH layout the sha256rnds2 instruction expects.
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sha,sse4.1,ssse3")))
+#endif
+inline void sha256CompressShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                 // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);           // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);        // CDGH
+
+    for (; blocks > 0; --blocks, data += 64) {
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+        __m128i w[4];
+        for (int g = 0; g < 16; ++g) {
+            if (g < 4) {
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * g)), byteSwap);
+            } else {
+                // W[g] = msg2(msg1(W[g-4], W[g-3]) + W[t-7 lanes], W[g-1])
+                __m128i sum = _mm_add_epi32(_mm_sha256msg1_epu32(w[g % 4], w[(g + 1) % 4]),
+                                            _mm_alignr_epi8(w[(g + 3) % 4], w[(g + 2) % 4], 4));
+                w[g % 4] = _mm_sha256msg2_epu32(sum, w[(g + 3) % 4]);
+            }
+            __m128i msg = _mm_add_epi32(w[g % 4], _mm_load_si128(reinterpret_cast<const __m128i*>(&SHA256_K[4 * g])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);              // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);           // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);        // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);           // ABEF
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+inline bool cpuHasShaNi() {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 1);
+    ecx = static_cast<unsigned int>(regs[2]);
+    bool sse41 = (ecx & (1u << 19)) != 0, ssse3 = (ecx & (1u << 9)) != 0;
+    __cpuidex(regs, 7, 0);
+    ebx = static_cast<unsigned int>(regs[1]);
+#else
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    bool sse41 = (ecx & (1u << 19)) != 0, ssse3 = (ecx & (1u << 9)) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+#endif
+    return sse41 && ssse3 && (ebx & (1u << 29)) != 0;
+}
+#endif // MINIGIT_SHA256_X86
+
+#if defined(MINIGIT_SHA256_ARM)
+// ARMv8 Cryptography Extensions path.
+inline void sha256CompressArm(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+    for (; blocks > 0; --blocks, data += 64) {
+        const uint32x4_t abcdSave = state0;
+        const uint32x4_t efghSave = state1;
+        uint32x4_t w[4];
+        for (int g = 0; g < 16; ++g) {
+            if (g < 4) {
+                w[g] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * g)));
+            } else {
+                w[g % 4] = vsha256su1q_u32(vsha256su0q_u32(w[g % 4], w[(g + 1) % 4]), w[(g + 2) % 4], w[(g + 3) % 4]);
+            }
+            uint32x4_t msg = vaddq_u32(w[g % 4], vld1q_u32(&SHA256_K[4 * g]));
+            uint32x4_t abcd = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, abcd, msg);
+        }
+        state0 = vaddq_u32(state0, abcdSave);
+        state1 = vaddq_u32(state1, efghSave);
+    }
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+#endif // MINIGIT_SHA256_ARM
+
+using Sha256CompressFn = void (*)(uint32_t*, const uint8_t*, size_t);
+
+// Picks the fastest compression function the CPU supports (resolved once per process).
+inline Sha256CompressFn selectSha256Compress() {
+#if defined(MINIGIT_SHA256_X86)
+    static const Sha256CompressFn fn = cpuHasShaNi() ? sha256CompressShaNi : sha256CompressPortable;
+    return fn;
+#elif defined(MINIGIT_SHA256_ARM)
+    return sha256CompressArm;
+#else
+    return sha256CompressPortable;
+#endif
+}
+
+} // namespace hash_detail
+
+class Sha256Hasher : public Hasher {
+private:
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint8_t buffer[64];
+    size_t bufferLen = 0;
+    uint64_t totalLen = 0;
+    hash_detail::Sha256CompressFn compress = hash_detail::selectSha256Compress();
+
+public:
+    void update(const void* data, size_t length) override {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        totalLen += length;
+        if (bufferLen > 0) {
+            size_t take = std::min(length, sizeof(buffer) - bufferLen);
+            std::memcpy(buffer + bufferLen, p, take);
+            bufferLen += take;
+            p += take;
+            length -= take;
+            if (bufferLen < sizeof(buffer)) return;
+            compress(state, buffer, 1);
+            bufferLen = 0;
+        }
+        if (length >= 64) { // Compress whole blocks straight from the caller's buffer
+            compress(state, p, length / 64);
+            p += length - length % 64;
+            length %= 64;
+        }
+        std::memcpy(buffer, p, length);
+        bufferLen = length;
+    }
+    using Hasher::update;
+
+    std::string finalize() override {
+        uint64_t bitLen = totalLen * 8;
+        uint8_t padding[72] = {0x80};
+        size_t padLen = (bufferLen < 56) ? (56 - bufferLen) : (120 - bufferLen);
+        for (int i = 0; i < 8; ++i) padding[padLen + i] = static_cast<uint8_t>(bitLen >> (56 - 8 * i));
+        update(padding, padLen + 8);
+        uint8_t digest[32];
+        for (int i = 0; i < 8; ++i) {
+            digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+            digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+        }
+        return hash_detail::toHex(digest, sizeof(digest));
+    }
+};
+
+// BLAKE3 (unkeyed, 256-bit output), following the structure of the reference implementation:
+// 1 KiB chunks are compressed into chaining values which are merged pairwise on a stack.
+class Blake3Hasher : public Hasher {
+private:
+    static constexpr uint32_t CHUNK_START = 1, CHUNK_END = 2, PARENT = 4, ROOT = 8;
+    static constexpr size_t BLOCK_LEN = 64, CHUNK_LEN = 1024;
+
+    static const uint32_t* iv() {
+        static const uint32_t values[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                           0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        return values;
+    }
+
+    static void g(uint32_t* s, int a, int b, int c, int d, uint32_t mx, uint32_t my) {
+        s[a] = s[a] + s[b] + mx; s[d] = hash_detail::rotr32(s[d] ^ s[a], 16);
+        s[c] = s[c] + s[d];      s[b] = hash_detail::rotr32(s[b] ^ s[c], 12);
+        s[a] = s[a] + s[b] + my; s[d] = hash_detail::rotr32(s[d] ^ s[a], 8);
+        s[c] = s[c] + s[d];      s[b] = hash_detail::rotr32(s[b] ^ s[c], 7);
+    }
+
+    static void compress(const uint32_t cv[8], const uint32_t block[16], uint64_t counter,
+                         uint32_t blockLen, uint32_t flags, uint32_t out[16]) {
+        static const int permutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+        uint32_t s[16] = {cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+                          iv()[0], iv()[1], iv()[2], iv()[3],
+                          static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), blockLen, flags};
+        uint32_t m[16];
+        std::memcpy(m, block, sizeof(m));
+        for (int round = 0; round < 7; ++round) {
+            g(s, 0, 4, 8, 12, m[0], m[1]);
+            g(s, 1, 5, 9, 13, m[2], m[3]);
+            g(s, 2, 6, 10, 14, m[4], m[5]);
+            g(s, 3, 7, 11, 15, m[6], m[7]);
+            g(s, 0, 5, 10, 15, m[8], m[9]);
+            g(s, 1, 6, 11, 12, m[10], m[11]);
+            g(s, 2, 7, 8, 13, m[12], m[13]);
+            g(s, 3, 4, 9, 14, m[14], m[15]);
+            if (round < 6) {
+                uint32_t permuted[16];
+                for (int i = 0; i < 16; ++i) permuted[i] = m[permutation[i]];
+                std::memcpy(m, permuted, sizeof(m));
+            }
+        }
+        for (int i = 0; i < 8; ++i) {
+            out[i] = s[i] ^ s[i + 8];
+            out[i + 8] = s[i + 8] ^ cv[i];
+        }
+    }
+
+    static void wordsFromBytes(const uint8_t* bytes, uint32_t words[16]) {
+        for (int i = 0; i < 16; ++i) words[i] = hash_detail::loadLE32(bytes + 4 * i);
+    }
+
+    // State of the chunk currently being filled.
+    uint32_t chunkCv[8];
+    uint64_t chunkCounter = 0;
+    uint8_t block[BLOCK_LEN] = {};
+    size_t blockLen = 0;
+    size_t blocksCompressed = 0;
+
+    // Chaining values of completed subtrees; at most one per level.
+    uint32_t cvStack[54][8];
+    size_t cvStackLen = 0;
+
+    size_t chunkLen() const { return BLOCK_LEN * blocksCompressed + blockLen; }
+    uint32_t startFlag() const { return blocksCompressed == 0 ? CHUNK_START : 0; }
+
+    void resetChunk(uint64_t counter) {
+        std::memcpy(chunkCv, iv(), sizeof(chunkCv));
+        chunkCounter = counter;
+        std::memset(block, 0, sizeof(block));
+        blockLen = 0;
+        blocksCompressed = 0;
+    }
+
+    void chunkOutputCv(uint32_t cv[8]) const {
+        uint32_t words[16], out[16];
+        wordsFromBytes(block, words);
+        compress(chunkCv, words, chunkCounter, static_cast<uint32_t>(blockLen), startFlag() | CHUNK_END, out);
+        std::memcpy(cv, out, 8 * sizeof(uint32_t));
+    }
+
+    static void parentCv(const uint32_t left[8], const uint32_t right[8], uint32_t flags, uint32_t out[16]) {
+        uint32_t words[16];
+        std::memcpy(words, left, 8 * sizeof(uint32_t));
+        std::memcpy(words + 8, right, 8 * sizeof(uint32_t));
+        compress(iv(), words, 0, BLOCK_LEN, PARENT | flags, out);
+    }
+
+    void pushChunkCv(uint32_t cv[8], uint64_t totalChunks) {
+        // Merge completed subtrees: one merge per trailing zero bit of the chunk count.
+        while ((totalChunks & 1) == 0) {
+            uint32_t out[16];
+            parentCv(cvStack[--cvStackLen], cv, 0, out);
+            std::memcpy(cv, out, 8 * sizeof(uint32_t));
+            totalChunks >>= 1;
+        }
+        std::memcpy(cvStack[cvStackLen++], cv, 8 * sizeof(uint32_t));
+    }
+
+public:
+    Blake3Hasher() { resetChunk(0); }
+
+    void update(const void* data, size_t length) override {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        while (length > 0) {
+            if (chunkLen() == CHUNK_LEN) {
+                uint32_t cv[8];
+                chunkOutputCv(cv);
+                uint64_t totalChunks = chunkCounter + 1;
+                pushChunkCv(cv, totalChunks);
+                resetChunk(totalChunks);
+            }
+            if (blockLen == BLOCK_LEN) {
+                uint32_t words[16], out[16];
+                wordsFromBytes(block, words);
+                compress(chunkCv, words, chunkCounter, BLOCK_LEN, startFlag(), out);
+                std::memcpy(chunkCv, out, sizeof(chunkCv));
+                ++blocksCompressed;
+                std::memset(block, 0, sizeof(block));
+                blockLen = 0;
+            }
+            size_t take = std::min(length, std::min(BLOCK_LEN - blockLen, CHUNK_LEN - chunkLen()));
+            std::memcpy(block + blockLen, p, take);
+            blockLen += take;
+            p += take;
+            length -= take;
+        }
+    }
+    using Hasher::update;
+
+    std::string finalize() override {
+        // Build the root node: the last chunk, folded with every pending subtree from right to left.
+        uint32_t inputCv[8], words[16], out[16];
+        uint64_t counter = chunkCounter;
+        uint32_t blockLength = static_cast<uint32_t>(blockLen);
+        uint32_t flags = startFlag() | CHUNK_END;
+        std::memcpy(inputCv, chunkCv, sizeof(inputCv));
+        wordsFromBytes(block, words);
+
+        for (size_t remaining = cvStackLen; remaining > 0; --remaining) {
+            compress(inputCv, words, counter, blockLength, flags, out); // Chaining value of the right child
+            std::memcpy(words, cvStack[remaining - 1], 8 * sizeof(uint32_t));
+            std::memcpy(words + 8, out, 8 * sizeof(uint32_t));
+            std::memcpy(inputCv, iv(), sizeof(inputCv));
+            counter = 0;
+            blockLength = BLOCK_LEN;
+            flags = PARENT;
+        }
+        compress(inputCv, words, counter, blockLength, flags | ROOT, out);
+
+        uint8_t digest[32];
+        for (int i = 0; i < 8; ++i) {
+            for (int b = 0; b < 4; ++b) digest[4 * i + b] = static_cast<uint8_t>(out[i] >> (8 * b));
+        }
+        return hash_detail::toHex(digest, sizeof(digest));
+    }
+};
+
+// std::hash<std::string> needs the whole content at once, so this engine buffers its input.
+// Only used for repositories without a format marker.
+class LegacyStdHasher : public Hasher {
+private:
+    std::string content;
+
+public:
+    void update(const void* data, size_t length) override {
+        content.append(static_cast<const char*>(data), length);
+    }
+    using Hasher::update;
+
+    std::string finalize() override {
+        return std::to_string(std::hash<std::string>{}(content));
+    }
+};
+
+inline std::unique_ptr<Hasher> makeHasher(HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::Sha256: return std::make_unique<Sha256Hasher>();
+        case HashAlgorithm::Blake3: return std::make_unique<Blake3Hasher>();
+        case HashAlgorithm::LegacyStdHash: break;
+    }
+    return std::make_unique<LegacyStdHasher>();
+}
+
+inline const char* hashAlgorithmName(HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::Sha256: return "sha256";
+        case HashAlgorithm::Blake3: return "blake3";
+        case HashAlgorithm::LegacyStdHash: break;
+    }
+    return "legacy";
+}
+
+// Parses a name written by hashAlgorithmName(). Returns false for unknown names.
+inline bool parseHashAlgorithm(const std::string& name, HashAlgorithm& algorithm) {
+    if (name == "sha256") algorithm = HashAlgorithm::Sha256;
+    else if (name == "blake3") algorithm = HashAlgorithm::Blake3;
+    else if (name == "legacy") algorithm = HashAlgorithm::LegacyStdHash;
+    else return false;
+    return true;
+}
+
+#endif // HASH_ENGINE_HPP
@@ -0,0 +1,231 @@
+#ifndef IGNORE_RULES_HPP
+#define IGNORE_RULES_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Compiled .minigitignore rules (a subset of the .gitignore syntax):
+//   # comment         blank lines and lines starting with '#' are skipped
+//   build/            a trailing '/' matches directories only
+//   *.o               a pattern without '/' matches the name at any depth
+//   /out, doc/*.html  a pattern with a '/' (other than a trailing one) matches the path from the root
+//   **/cache, a/**/b  '**' spans directories; '*', '?' and '[...]' never match '/'
+//   !keep.o           re-includes what an earlier rule ignored (the last matching rule wins)
+//   \#file, \!file    a backslash makes the next character literal
+// Literal names and paths are looked up in hash tables; only the glob rules that could still override them
+// run, each as a small automaton behind a literal-suffix check, so most entries cost one or two hash lookups.
+// Ignored directories are pruned by the walker, so, as in git, a '!' rule cannot re-include anything inside one.
+class IgnoreRules {
+public:
+    // Replaces the rules with those of 'path'. Returns false (and has no rules) if it cannot be read.
+    bool load(const std::string& path) {
+        *this = IgnoreRules();
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) return false;
+        parse(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+        return true;
+    }
+
+    // Adds the rules (one per line) of 'text'.
+    void parse(std::string_view text) {
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string_view::npos) end = text.size();
+            addRule(text.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    bool empty() const { return rules.empty(); }
+
+    // True if 'path' ('/'-separated, relative to the root) is ignored by its own rules; its parents are not looked at.
+    bool ignored(std::string_view path, bool isDirectory) const {
+        if (rules.empty()) return false;
+        const size_t slash = path.rfind('/');
+        const std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+        int best = -1; // Index of the last matching rule
+        auto lookUp = [&](const std::unordered_map<std::string, std::vector<int>>& table, std::string_view key) {
+            if (table.empty()) return;
+            auto it = table.find(std::string(key));
+            if (it == table.end()) return;
+            for (int index : it->second) {
+                if (index > best && (isDirectory || !rules[index].directoryOnly)) best = index;
+            }
+        };
+        lookUp(literalNames, name);
+        lookUp(literalPaths, path);
+        for (auto glob = globs.rbegin(); glob != globs.rend() && glob->rule > best; ++glob) {
+            if (!isDirectory && rules[glob->rule].directoryOnly) continue;
+            if (glob->matches(rules[glob->rule].anchored ? path : name)) {
+                best = glob->rule;
+                break;
+            }
+        }
+        return best >= 0 && !rules[best].negated;
+    }
+
+    // True if 'path' or one of its parent directories is ignored, i.e. if a walk from the root would not list it.
+    bool excluded(std::string_view path, bool isDirectory) const {
+        if (rules.empty()) return false;
+        for (size_t slash = path.find('/'); slash != std::string_view::npos; slash = path.find('/', slash + 1)) {
+            if (ignored(path.substr(0, slash), true)) return true;
+        }
+        return ignored(path, isDirectory);
+    }
+
+private:
+    struct Rule {
+        bool negated = false;
+        bool directoryOnly = false;
+        bool anchored = false; // Matched against the whole path instead of the name
+    };
+
+    static constexpr size_t MAX_TOKENS = 255; // Longer patterns are ignored
+
+    // One step of a compiled glob. The kinds from Star on may match nothing; AnyDirs is "**/" (zero or more directories).
+    struct Token {
+        enum Kind { Char, AnyChar, Set, Star, DoubleStar, AnyDirs } kind;
+        char c = 0;
+        std::bitset<256> set;
+    };
+
+    struct Glob {
+        int rule = 0;
+        std::vector<Token> tokens;
+        std::string suffix; // Literal tail every match must end with (cheap rejection before the automaton)
+
+        // Runs the automaton: the set of token positions reachable after each character of 'text'.
+        bool matches(std::string_view text) const {
+            if (text.size() < suffix.size() || text.compare(text.size() - suffix.size(), suffix.size(), suffix) != 0) return false;
+            const size_t n = tokens.size();
+            std::bitset<MAX_TOKENS + 1> current, next;
+            current.set(0);
+            close(current);
+            for (char ch : text) {
+                next.reset();
+                for (size_t i = 0; i < n; ++i) {
+                    if (!current.test(i)) continue;
+                    const Token& token = tokens[i];
+                    switch (token.kind) {
+                        case Token::Char: if (ch == token.c) next.set(i + 1); break;
+                        case Token::AnyChar: if (ch != '/') next.set(i + 1); break;
+                        case Token::Set: if (ch != '/' && token.set.test(static_cast<unsigned char>(ch))) next.set(i + 1); break;
+                        case Token::Star: if (ch != '/') next.set(i); break;
+                        case Token::DoubleStar: next.set(i); break;
+                        case Token::AnyDirs:
+                            next.set(i);
+                            if (ch == '/') next.set(i + 1);
+                            break;
+                    }
+                }
+                if (next.none()) return false;
+                close(next);
+                std::swap(current, next);
+            }
+            return current.test(n);
+        }
+
+        // Adds the positions reachable without consuming a character.
+        void close(std::bitset<MAX_TOKENS + 1>& states) const {
+            for (size_t i = 0; i < tokens.size(); ++i) {
+                if (states.test(i) && tokens[i].kind >= Token::Star) states.set(i + 1);
+            }
+        }
+    };
+
+    std::vector<Rule> rules;
+    std::unordered_map<std::string, std::vector<int>> literalNames; // name -> rules matching it at any depth
+    std::unordered_map<std::string, std::vector<int>> literalPaths; // path from the root -> rules
+    std::vector<Glob> globs;                                        // In rule order
+
+    void addRule(std::string_view line) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        while (!line.empty() && line.back() == ' ' && (line.size() < 2 || line[line.size() - 2] != '\\')) line.remove_suffix(1);
+        if (line.empty() || line[0] == '#') return;
+        Rule rule;
+        if (line[0] == '!') {
+            rule.negated = true;
+            line.remove_prefix(1);
+        }
+        if (!line.empty() && line.back() == '/') {
+            rule.directoryOnly = true;
+            line.remove_suffix(1);
+        }
+        rule.anchored = line.find('/') != std::string_view::npos;
+        if (!line.empty() && line[0] == '/') line.remove_prefix(1);
+        if (line.empty()) return;
+
+        const int index = static_cast<int>(rules.size());
+        Glob glob;
+        glob.rule = index;
+        bool literal = true;
+        std::string text; // The pattern without escapes, if it is literal
+        for (size_t i = 0; i < line.size(); ++i) {
+            Token token{Token::Char, line[i], {}};
+            if (line[i] == '\\' && i + 1 < line.size()) {
+                token.c = line[++i];
+            } else if (line[i] == '*') {
+                const bool twoStars = i + 1 < line.size() && line[i + 1] == '*';
+                const bool wholeComponent = (i == 0 || line[i - 1] == '/') && (i + 2 >= line.size() || line[i + 2] == '/');
+                if (twoStars && wholeComponent) {
+                    if (i + 2 < line.size()) { // "**/": the '/' belongs to the token
+                        token.kind = Token::AnyDirs;
+                        i += 2;
+                    } else {
+                        token.kind = Token::DoubleStar;
+                        i += 1;
+                    }
+                } else {
+                    token.kind = Token::Star;
+                    while (i + 1 < line.size() && line[i + 1] == '*') ++i; // "a**b" is just a star
+                }
+                literal = false;
+            } else if (line[i] == '?') {
+                token.kind = Token::AnyChar;
+                literal = false;
+            } else if (line[i] == '[' && parseSet(line, i, token)) {
+                literal = false;
+            }
+            if (token.kind == Token::Char) text += token.c;
+            glob.tokens.push_back(std::move(token));
+        }
+        if (glob.tokens.size() > MAX_TOKENS) return;
+        rules.push_back(rule);
+        if (literal) {
+            (rule.anchored ? literalPaths : literalNames)[text].push_back(index);
+            return;
+        }
+        for (auto it = glob.tokens.rbegin(); it != glob.tokens.rend() && it->kind == Token::Char; ++it) glob.suffix.insert(glob.suffix.begin(), it->c);
+        globs.push_back(std::move(glob));
+    }
+
+    // Parses "[...]" at line[i] into a Set token and moves i to its ']'. False if the bracket is not closed.
+    static bool parseSet(std::string_view line, size_t& i, Token& token) {
+        size_t j = i + 1;
+        const bool negate = j < line.size() && (line[j] == '!' || line[j] == '^');
+        if (negate) ++j;
+        const size_t end = line.find(']', j + 1); // A ']' first in the set is a member, not the end
+        if (end == std::string_view::npos) return false;
+        for (; j < end; ++j) {
+            if (j + 2 < end && line[j + 1] == '-') {
+                for (int c = static_cast<unsigned char>(line[j]); c <= static_cast<unsigned char>(line[j + 2]); ++c) token.set.set(c);
+                j += 2;
+            } else {
+                token.set.set(static_cast<unsigned char>(line[j]));
+            }
+        }
+        if (negate) token.set.flip();
+        token.kind = Token::Set;
+        i = end;
+        return true;
+    }
+};
+
+#endif // IGNORE_RULES_HPP
@@ -0,0 +1,101 @@
+#ifndef LINE_TABLE_HPP
+#define LINE_TABLE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// Interns lines to dense integer IDs (0, 1, 2, ...) so the diff algorithms compare integers only.
+// Lines are stored as views into the caller's buffers (mapped blobs), never copied. The table is an
+// open-addressing hash over one flat slot array; reset() empties it in O(1) by bumping an epoch, so
+// one table serves every file of a diff without freeing or reallocating its storage.
+class LineTable {
+public:
+    // Forgets every line. Views from the previous file may dangle after this; they are never read again.
+    void reset() {
+        entries.clear();
+        if (++epoch == 0) { // Wrapped: stale slots could look current
+            std::fill(slots.begin(), slots.end(), Slot{});
+            epoch = 1;
+        }
+    }
+
+    // Makes room for 'lines' more distinct lines without rehashing.
+    void reserve(size_t lines) {
+        size_t needed = entries.size() + lines;
+        if (needed * 2 > slots.size()) grow(needed * 2);
+        entries.reserve(needed);
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // ID of 'line', assigning the next free one on first sight.
+    uint32_t intern(std::string_view line) {
+        if ((entries.size() + 1) * 2 > slots.size()) grow((entries.size() + 1) * 2);
+        const uint64_t hash = hashLine(line);
+        const size_t mask = slots.size() - 1;
+        for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.epoch != epoch) { // Free in this epoch
+                slot.epoch = epoch;
+                slot.id = static_cast<uint32_t>(entries.size());
+                entries.push_back({hash, line});
+                return slot.id;
+            }
+            const Entry& entry = entries[slot.id];
+            if (entry.hash == hash && entry.text == line) return slot.id;
+        }
+    }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::string_view text;
+    };
+    struct Slot {
+        uint32_t epoch = 0; // Slot is used only if equal to the table's epoch
+        uint32_t id = 0;
+    };
+
+    std::vector<Entry> entries; // ID -> line
+    std::vector<Slot> slots;    // Power-of-two size, at most half full
+    uint32_t epoch = 1;
+
+    void grow(size_t minSlots) {
+        size_t size = slots.empty() ? 1024 : slots.size();
+        while (size < minSlots) size *= 2;
+        slots.assign(size, Slot{});
+        epoch = 1;
+        const size_t mask = size - 1;
+        for (uint32_t id = 0; id < entries.size(); ++id) {
+            size_t i = static_cast<size_t>(entries[id].hash) & mask;
+            while (slots[i].epoch == epoch) i = (i + 1) & mask;
+            slots[i] = {epoch, id};
+        }
+    }
+
+    // 8 bytes per step, finalized with a 64-bit mix so the low bits (the slot index) depend on every byte.
+    static uint64_t hashLine(std::string_view line) {
+        const char* p = line.data();
+        size_t n = line.size();
+        uint64_t h = 0x9e3779b97f4a7c15ULL ^ (n * 0xff51afd7ed558ccdULL);
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            h = (h ^ word) * 0xbf58476d1ce4e5b9ULL;
+            h ^= h >> 31;
+        }
+        if (n > 0) {
+            uint64_t word = 0;
+            std::memcpy(&word, p, n);
+            h = (h ^ word) * 0x94d049bb133111ebULL;
+        }
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        return h ^ (h >> 29);
+    }
+};
+
+#endif // LINE_TABLE_HPP
@@ -0,0 +1,208 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole regular file as one contiguous range.
+// open() memory-maps the file, so its content is never copied; that is only safe for files nobody truncates
+// while they are mapped (objects, packs, files replaced by rename), as touching a page past the new end
+// raises SIGBUS. Working-tree files go through read(), which copies them in fixed-size chunks into an owned
+// buffer, as does open() when mapping fails. Directories, pipes and other special files are never opened.
+class MappedFile {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { moveFrom(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    // Wraps content that already lives in memory (e.g. a decoded object) behind the same interface.
+    static MappedFile fromBuffer(std::string content) {
+        MappedFile file;
+        file.buffer = std::move(content);
+        file.begin = file.buffer.data();
+        file.length = file.buffer.size();
+        file.opened = true;
+        return file;
+    }
+
+    // Opens and maps 'path'. Returns false if the file cannot be read at all.
+    bool open(const std::string& path) {
+        close();
+        if (mapFile(path)) {
+            opened = true;
+        } else if (readChunked(path, buffer)) {
+            begin = buffer.data();
+            length = buffer.size();
+            opened = true;
+        }
+        return opened;
+    }
+
+    // Reads 'path' into an owned buffer without mapping it, for files that may be truncated while in use
+    // (the working tree). Not open if the file cannot be read.
+    static MappedFile read(const std::string& path) {
+        std::string content;
+        if (!readChunked(path, content)) return MappedFile();
+        return fromBuffer(std::move(content));
+    }
+
+    // Reads 'path' in CHUNK_SIZE pieces into 'content'. Returns false (with 'content' empty) if it is not
+    // a regular file, cannot be opened or a read fails.
+    static bool readChunked(const std::string& path, std::string& content) {
+        content.clear();
+        std::ifstream in;
+        if (!openRegular(path, in)) return false;
+        while (in) {
+            size_t oldSize = content.size();
+            content.resize(oldSize + CHUNK_SIZE);
+            in.read(&content[oldSize], static_cast<std::streamsize>(CHUNK_SIZE));
+            content.resize(oldSize + static_cast<size_t>(in.gcount()));
+        }
+        if (in.bad()) { // An I/O error, not the end of the file
+            content.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // Feeds the file's content to consume(const char*, size_t) in CHUNK_SIZE pieces, without mapping it
+    // (see read()). Returns false if it is not a regular file, cannot be opened or a read fails
+    // (the pieces before the failure have been consumed).
+    template <typename Consumer>
+    static bool forEachChunk(const std::string& path, Consumer consume) {
+        std::ifstream in;
+        if (!openRegular(path, in)) return false;
+        std::vector<char> chunk(CHUNK_SIZE);
+        while (in) {
+            in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            if (in.gcount() <= 0) break;
+            consume(chunk.data(), static_cast<size_t>(in.gcount()));
+        }
+        return !in.bad();
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (mappedView) UnmapViewOfFile(mappedView);
+        mappedView = nullptr;
+#else
+        if (mappedView) munmap(mappedView, length);
+        mappedView = nullptr;
+#endif
+        buffer.clear();
+        begin = nullptr;
+        length = 0;
+        opened = false;
+    }
+
+    bool isOpen() const { return opened; }
+    bool isMapped() const { return mappedView != nullptr; }
+    const char* data() const { return begin; }
+    size_t size() const { return length; }
+    std::string_view view() const { return std::string_view(begin ? begin : "", length); }
+
+private:
+    void* mappedView = nullptr;
+    std::string buffer; // Used when the file is not mapped
+    const char* begin = nullptr;
+    size_t length = 0;
+    bool opened = false;
+
+    // ifstream also opens directories (and blocks on FIFOs), so the type is checked first.
+    static bool openRegular(const std::string& path, std::ifstream& in) {
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) return false;
+        in.open(path, std::ios::binary);
+        return in.is_open();
+    }
+
+    void moveFrom(MappedFile& other) {
+        mappedView = other.mappedView;
+        buffer = std::move(other.buffer);
+        length = other.length;
+        opened = other.opened;
+        begin = mappedView ? static_cast<const char*>(mappedView) : buffer.data();
+        other.mappedView = nullptr;
+        other.begin = nullptr;
+        other.length = 0;
+        other.opened = false;
+    }
+
+    bool mapFile(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            return false;
+        }
+        if (fileSize.QuadPart == 0) { // Empty files cannot be mapped, but are trivially readable
+            CloseHandle(file);
+            begin = "";
+            return true;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) return false;
+        mappedView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping); // The view keeps the mapping alive
+        if (!mappedView) return false;
+        length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+        if (st.st_size == 0) { // Empty files cannot be mapped, but are trivially readable
+            ::close(fd);
+            begin = "";
+            return true;
+        }
+        void* address = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping stays valid after the descriptor is closed
+        if (address == MAP_FAILED) return false;
+        mappedView = address;
+        length = static_cast<size_t>(st.st_size);
+#endif
+        begin = static_cast<const char*>(mappedView);
+        return true;
+    }
+};
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,135 @@
+#ifndef MERGE_ENGINE_HPP
+#define MERGE_ENGINE_HPP
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DiffEngine.hpp"
+
+// Line-level three-way merge (diff3 style).
+// Both sides are diffed against the base without context, which yields the base line ranges each side
+// replaced. Ranges that overlap or touch are merged into one region; a region changed by one side only
+// takes that side's lines, a region both sides changed identically takes them once, and anything else
+// becomes a conflict:
+//   <<<<<<< ours label
+//   ...our lines...
+//   =======
+//   ...their lines...
+//   >>>>>>> their label
+class MergeEngine {
+public:
+    struct Result {
+        std::string text;
+        size_t conflicts = 0;
+        bool binary = false; // A side contains NUL bytes: not merged line by line ('text' is empty)
+    };
+
+    explicit MergeEngine(DiffAlgorithm algorithm = DiffAlgorithm::Myers) : algorithm(algorithm) {}
+
+    Result merge(std::string_view base, std::string_view ours, std::string_view theirs,
+                 const std::string& oursLabel, const std::string& theirsLabel) const {
+        Result result;
+        if (isBinary(base) || isBinary(ours) || isBinary(theirs)) {
+            result.binary = true;
+            result.conflicts = 1;
+            return result;
+        }
+        std::vector<Edit> edits = editsOf(base, ours, Side::Ours);
+        std::vector<Edit> theirEdits = editsOf(base, theirs, Side::Theirs);
+        edits.insert(edits.end(), theirEdits.begin(), theirEdits.end());
+        std::stable_sort(edits.begin(), edits.end(), [](const Edit& a, const Edit& b) { return a.begin < b.begin; });
+
+        const std::vector<std::string_view> baseLines = splitLines(base);
+        size_t copied = 0; // Base lines [0, copied) are already emitted
+        for (size_t k = 0; k < edits.size();) {
+            // Collect every edit overlapping or touching the region that starts with edits[k]
+            size_t regionBegin = edits[k].begin, regionEnd = edits[k].end, next = k + 1;
+            bool oursChanged = edits[k].side == Side::Ours, theirsChanged = !oursChanged;
+            while (next < edits.size() && edits[next].begin <= regionEnd) {
+                regionEnd = std::max(regionEnd, edits[next].end);
+                (edits[next].side == Side::Ours ? oursChanged : theirsChanged) = true;
+                ++next;
+            }
+            for (; copied < regionBegin; ++copied) appendLine(result.text, baseLines[copied]);
+            std::vector<std::string_view> oursVersion = applyEdits(baseLines, edits, k, next, Side::Ours, regionBegin, regionEnd);
+            std::vector<std::string_view> theirsVersion = applyEdits(baseLines, edits, k, next, Side::Theirs, regionBegin, regionEnd);
+            if (!theirsChanged || oursVersion == theirsVersion) {
+                for (std::string_view line : oursVersion) appendLine(result.text, line);
+            } else if (!oursChanged) {
+                for (std::string_view line : theirsVersion) appendLine(result.text, line);
+            } else {
+                ++result.conflicts;
+                result.text += "<<<<<<< " + oursLabel + "\n";
+                for (std::string_view line : oursVersion) appendLine(result.text, line);
+                result.text += "=======\n";
+                for (std::string_view line : theirsVersion) appendLine(result.text, line);
+                result.text += ">>>>>>> " + theirsLabel + "\n";
+            }
+            copied = regionEnd;
+            k = next;
+        }
+        for (; copied < baseLines.size(); ++copied) appendLine(result.text, baseLines[copied]);
+
+        // Lines are emitted with '\n'; keep a missing final newline only if neither side added one
+        bool oursNewline = ours.empty() || ours.back() == '\n';
+        bool theirsNewline = theirs.empty() || theirs.back() == '\n';
+        if (!oursNewline && !theirsNewline && !result.text.empty() && result.conflicts == 0) result.text.pop_back();
+        return result;
+    }
+
+private:
+    enum class Side { Ours, Theirs };
+
+    // Base lines [begin, end) replaced by 'lines' on one side.
+    struct Edit {
+        size_t begin = 0;
+        size_t end = 0;
+        Side side = Side::Ours;
+        std::vector<std::string_view> lines;
+    };
+
+    DiffAlgorithm algorithm;
+
+    std::vector<Edit> editsOf(std::string_view base, std::string_view side, Side which) const {
+        DiffEngine engine(algorithm, 0); // No context: every hunk is exactly one changed range
+        std::vector<Edit> edits;
+        for (const DiffEngine::Hunk& hunk : engine.diff(base, side)) {
+            Edit edit;
+            edit.begin = hunk.oldCount > 0 ? hunk.oldStart - 1 : hunk.oldStart; // Empty ranges name the line before
+            edit.end = edit.begin + hunk.oldCount;
+            edit.side = which;
+            for (const DiffEngine::Line& line : hunk.lines) {
+                if (line.op == '+') edit.lines.push_back(line.text);
+            }
+            edits.push_back(std::move(edit));
+        }
+        return edits;
+    }
+
+    // One side's version of base lines [regionBegin, regionEnd), from its edits among edits[first, last).
+    static std::vector<std::string_view> applyEdits(const std::vector<std::string_view>& baseLines, const std::vector<Edit>& edits,
+                                                    size_t first, size_t last, Side side, size_t regionBegin, size_t regionEnd) {
+        std::vector<std::string_view> lines;
+        size_t position = regionBegin;
+        for (size_t k = first; k < last; ++k) {
+            const Edit& edit = edits[k];
+            if (edit.side != side) continue;
+            for (; position < edit.begin; ++position) lines.push_back(baseLines[position]);
+            lines.insert(lines.end(), edit.lines.begin(), edit.lines.end());
+            position = edit.end;
+        }
+        for (; position < regionEnd; ++position) lines.push_back(baseLines[position]);
+        return lines;
+    }
+
+    static void appendLine(std::string& out, std::string_view line) {
+        out.append(line.data(), line.size());
+        out.push_back('\n');
+    }
+
+    static bool isBinary(std::string_view text) { return text.find('\0') != std::string_view::npos; }
+};
+
+#endif // MERGE_ENGINE_HPP
@@ -1,1076 +1,3418 @@
-#ifndef MINIGIT_SYSTEM_HPP
-#define MINIGIT_SYSTEM_HPP
-
-#include <iostream>
-#include <fstream>
-#include <unordered_map>
-#include <unordered_set>
-#include <vector>
-#include <string>
-#include <filesystem>
-#include <chrono>
-#include <ctime>
-#include <sstream>
-#include <iomanip> // For std::put_time
-#include <algorithm> // For std::remove_if
-
-namespace fs = std::filesystem;
-
-class MiniGitSystem {
-private:
-    // --- Data Structures ---
-    struct Commit {
-        std::string hash;
-        std::string message;
-        std::string timestamp;
-        std::vector<std::string> parentHashes;
-        std::unordered_map<std::string, std::string> fileBlobs; // filename -> blob hash
-    };
-
-    // Core data:
-    std::unordered_map<std::string, Commit> commits;       // hash -> Commit object
-    std::unordered_map<std::string, std::string> branches; // branch name -> commit hash
-    std::unordered_map<std::string, std::string> stagingArea; // filename -> blob hash
-
-    // Current state:
-    std::string headBranch = "master";      // The currently active branch (e.g., "master", "feature-a")
-    std::string headCommitHash;             // The hash of the commit HEAD currently points to
-
-    // --- Private Utility Methods ---
-
-    // Generates a formatted timestamp for commits.
-    std::string getCurrentTime() {
-        auto now = std::chrono::system_clock::now();
-        std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&now_time), "%Y-%m-%d %H:%M:%S");
-        return ss.str();
-    }
-
-    // A simple hashing function for content.
-    // In a real VCS, you'd use a cryptographic hash like SHA-1 or SHA-256.
-    std::string hashFileContent(const std::string& content) {
-        std::hash<std::string> hasher;
-        return std::to_string(hasher(content));
-    }
-
-    // Reads the entire content of a file into a string.
-    std::string readFileContent(const std::string& filename) {
-        std::ifstream file(filename, std::ios::binary); // Use binary mode to avoid issues with text conversions
-        if (!file.is_open()) {
-            // std::cerr << "Error: Could not open file for reading: " << filename << "\n"; // Suppress for status
-            return "";
-        }
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return buffer.str();
-    }
-
-    // Writes content to a 'blob' file in the .minigit/objects directory.
-    void saveBlob(const std::string& hash, const std::string& content) {
-        fs::path blobPath = ".minigit/objects/" + hash;
-        std::ofstream out(blobPath, std::ios::binary);
-        if (!out.is_open()) {
-            std::cerr << "Error: Could not save blob to " << blobPath << "\n";
-            return;
-        }
-        out << content;
-        out.close();
-    }
-
-    // Reads content from a 'blob' file.
-    std::string loadBlob(const std::string& hash) {
-        fs::path blobPath = ".minigit/objects/" + hash;
-        std::ifstream in(blobPath, std::ios::binary);
-        if (!in.is_open()) {
-            // std::cerr << "Error: Could not load blob from " << blobPath << "\n"; // Suppress for cases where blob might not exist (e.g. initial diffs)
-            return "";
-        }
-        std::stringstream buffer;
-        buffer << in.rdbuf();
-        return buffer.str();
-    }
-
-    // Writes commit metadata to a file in the .minigit/commits directory.
-    void writeCommitToFile(const Commit& commit) {
-        fs::path commitPath = ".minigit/commits/" + commit.hash;
-        std::ofstream file(commitPath);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not write commit to " << commitPath << "\n";
-            return;
-        }
-        file << "message:" << commit.message << "\n";
-        file << "timestamp:" << commit.timestamp << "\n";
-        file << "parents:";
-        for (const auto& parent : commit.parentHashes) {
-            file << parent << " ";
-        }
-        file << "\n";
-        file << "files:\n";
-        for (const auto& [f, b] : commit.fileBlobs) {
-            file << f << ":" << b << "\n";
-        }
-        file.close();
-    }
-
-    // Loads a commit from its file representation.
-    Commit loadCommitFromFile(const std::string& commitHash) {
-        fs::path commitPath = ".minigit/commits/" + commitHash;
-        std::ifstream file(commitPath);
-        Commit c;
-        c.hash = commitHash;
-
-        if (!file.is_open()) {
-            // std::cerr << "Error: Could not load commit from " << commitPath << "\n";
-            c.hash = ""; // Indicate failure
-            return c;
-        }
-
-        std::string line;
-        while (std::getline(file, line)) {
-            if (line.rfind("message:", 0) == 0) {
-                c.message = line.substr(8);
-            } else if (line.rfind("timestamp:", 0) == 0) {
-                c.timestamp = line.substr(10);
-            } else if (line.rfind("parents:", 0) == 0) {
-                std::string parentsStr = line.substr(8);
-                std::stringstream ss(parentsStr);
-                std::string parentHash;
-                while (ss >> parentHash) {
-                    c.parentHashes.push_back(parentHash);
-                }
-            } else if (line.rfind("files:", 0) == 0) {
-                while (std::getline(file, line) && !line.empty()) {
-                    size_t colonPos = line.find(':');
-                    if (colonPos != std::string::npos) {
-                        std::string filename = line.substr(0, colonPos);
-                        std::string blobHash = line.substr(colonPos + 1);
-                        c.fileBlobs[filename] = blobHash;
-                    }
-                }
-            }
-        }
-        file.close();
-        return c;
-    }
-
-    // Persist current branch state to a file and update HEAD.
-    void saveHeadAndBranchRefs() {
-        // Save current branch's commit hash
-        if (!headBranch.empty() && !headCommitHash.empty()) { // Only save if on a branch and points to a commit
-            fs::create_directories(".minigit/refs/heads");
-            std::ofstream branchRefFile(".minigit/refs/heads/" + headBranch);
-            if (!branchRefFile.is_open()) {
-                std::cerr << "Error: Could not save branch ref for " << headBranch << "\n";
-                return;
-            }
-            branchRefFile << headCommitHash << "\n";
-            branchRefFile.close();
-        }
-
-        // Update .minigit/HEAD
-        std::ofstream headFile(".minigit/HEAD");
-        if (!headFile.is_open()) {
-            std::cerr << "Error: Could not save HEAD file.\n";
-            return;
-        }
-        if (!headBranch.empty()) { // On a branch
-            headFile << "ref: refs/heads/" << headBranch << "\n";
-        } else { // Detached HEAD
-            headFile << headCommitHash << "\n";
-        }
-        headFile.close();
-    }
-
-    // Load branch state from HEAD file and all branch refs.
-    void loadRepoState() {
-        // Load HEAD
-        std::ifstream headFile(".minigit/HEAD");
-        if (headFile.is_open()) {
-            std::string line;
-            std::getline(headFile, line);
-            if (line.rfind("ref: refs/heads/", 0) == 0) {
-                headBranch = line.substr(16);
-                // Load the commit pointed to by the branch
-                std::ifstream branchRef(".minigit/refs/heads/" + headBranch);
-                if (branchRef.is_open()) {
-                    std::getline(branchRef, headCommitHash);
-                    branchRef.close();
-                } else {
-                    headCommitHash = ""; // Branch exists but points to nothing (e.g., brand new repo before first commit)
-                }
-            } else {
-                // Detached HEAD state
-                headBranch = ""; // Indicate detached HEAD
-                headCommitHash = line;
-            }
-            headFile.close();
-        } else {
-            // No HEAD file (first init case)
-            headBranch = "master";
-            headCommitHash = "";
-        }
-
-        // Load all commits
-        if (fs::exists(".minigit/commits")) {
-            for (const auto& entry : fs::directory_iterator(".minigit/commits")) {
-                if (entry.is_regular_file()) {
-                    std::string commitHash = entry.path().filename().string();
-                    commits[commitHash] = loadCommitFromFile(commitHash);
-                }
-            }
-        }
-
-        // Load all branch refs
-        fs::path branchesPath = ".minigit/refs/heads";
-        if (fs::exists(branchesPath)) {
-            for (const auto& entry : fs::directory_iterator(branchesPath)) {
-                if (entry.is_regular_file()) {
-                    std::string branchName = entry.path().filename().string();
-                    std::ifstream branchFile(entry.path());
-                    std::string commitHash;
-                    std::getline(branchFile, commitHash);
-                    branches[branchName] = commitHash;
-                    branchFile.close();
-                }
-            }
-        }
-        // Clear staging area on load, simulating .git/index not being loaded
-        stagingArea.clear();
-    }
-
-
-    // Populate the working directory with files from a given commit snapshot.
-    // Handles creating, updating, and deleting files.
-    void populateWorkingDirectory(const Commit& commit) {
-        // Get list of all files in current working directory (excluding .minigit)
-        std::unordered_set<std::string> wdFiles;
-        for (const auto& entry : fs::directory_iterator(".")) {
-            std::string filename = entry.path().filename().string(); // Corrected: Get filename as string
-            if (entry.is_regular_file() && filename != ".minigit" && filename[0] != '.') { // Corrected: Access first char of string
-                wdFiles.insert(filename);
-            }
-        }
-
-        // 1. Create/Update files from the target commit
-        for (const auto& [filename, blobHash] : commit.fileBlobs) {
-            std::string content = loadBlob(blobHash);
-            if (content.empty() && !fs::exists(".minigit/objects/" + blobHash)) {
-                 std::cerr << "Warning: Blob for " << filename << " (" << blobHash.substr(0,7) << ") not found. Skipping.\n";
-                 continue;
-            }
-
-            std::ofstream outFile(filename, std::ios::binary);
-            if (outFile.is_open()) {
-                outFile << content;
-                outFile.close();
-            } else {
-                std::cerr << "Warning: Could not write file " << filename << ". Skipping.\n";
-            }
-            wdFiles.erase(filename); // Mark as handled
-        }
-
-        // 2. Delete files that are in the working directory but NOT in the target commit
-        for (const std::string& wdFilename : wdFiles) {
-            // Skip .minigit folder itself
-            if (wdFilename == ".minigit" || wdFilename[0] == '.') continue; // Also skip other hidden files potentially
-
-            if (commit.fileBlobs.find(wdFilename) == commit.fileBlobs.end()) {
-                try {
-                    fs::remove(wdFilename);
-                    std::cout << "Removed: " << wdFilename << "\n";
-                } catch (const fs::filesystem_error& e) {
-                    std::cerr << "Error removing file " << wdFilename << ": " << e.what() << "\n";
-                }
-            }
-        }
-        std::cout << "Working directory updated to commit " << commit.hash.substr(0, 7) << ".\n";
-    }
-
-    // Compares working directory files with the current HEAD commit or staging area.
-    // Returns a tuple of (modified, deleted, untracked) files.
-    // This is a helper for status().
-    struct WorkingDirChanges {
-        std::vector<std::string> modified;
-        std::vector<std::string> deleted;
-        std::vector<std::string> untracked;
-    };
-
-    WorkingDirChanges getUnstagedChanges(const Commit* headCommit) {
-        WorkingDirChanges changes;
-        std::unordered_map<std::string, std::string> commitFiles;
-        if (headCommit) {
-            commitFiles = headCommit->fileBlobs;
-        }
-
-        // Files in working directory
-        std::unordered_set<std::string> wdFiles;
-        for (const auto& entry : fs::directory_iterator(".")) {
-            std::string filename = entry.path().filename().string(); // Corrected: Get filename as string
-            // Exclude .minigit directory and other hidden/system files if necessary
-            if (entry.is_regular_file() && filename != ".minigit" && filename[0] != '.') { // Corrected: Access first char of string
-                wdFiles.insert(filename);
-                std::string currentContent = readFileContent(filename);
-                std::string currentHash = hashFileContent(currentContent);
-
-                if (stagingArea.count(filename)) { // File is in staging
-                    // Check if WD content differs from staged content
-                    if (stagingArea.at(filename) != currentHash) {
-                        changes.modified.push_back(filename + " (not staged - staged version differs from WD)");
-                    }
-                    // If content matches staged, it's not an unstaged modification from staged.
-                    // But if staged differs from commit, it would be a staged change.
-                } else if (commitFiles.count(filename)) { // File is tracked by current commit
-                    // Check if WD content differs from committed content
-                    if (commitFiles.at(filename) != currentHash) {
-                        changes.modified.push_back(filename);
-                    }
-                } else { // Not in staging and not in commit -> Untracked
-                    changes.untracked.push_back(filename);
-                }
-            }
-        }
-
-        // Files deleted from working directory (but present in commit or staging)
-        // Check for files that were in the last commit (tracked) but are now missing from WD
-        for (const auto& [filename, blobHash] : commitFiles) {
-            if (!wdFiles.count(filename) && !stagingArea.count(filename)) { // Not in WD and not in staging
-                changes.deleted.push_back(filename);
-            }
-            // If it's in staging but not in WD, it's a staged deletion (handled by getStagedChanges)
-            // If it's in WD but not in staging (and was in commit), it's handled above as a modified/unchanged.
-        }
-
-        return changes;
-    }
-
-    // Checks if there are changes staged for commit.
-    // Returns a tuple of (added, modified, deleted) staged files.
-    struct StagedChanges {
-        std::vector<std::string> added;
-        std::vector<std::string> modified;
-        std::vector<std::string> deleted; // Files removed from tracking and then added to staging (via git rm)
-    };
-
-    StagedChanges getStagedChanges(const Commit* headCommit) {
-        StagedChanges changes;
-        std::unordered_map<std::string, std::string> commitFiles;
-        if (headCommit) {
-            commitFiles = headCommit->fileBlobs;
-        }
-
-        // Check staged files (added/modified)
-        for (const auto& [filename, stagedBlobHash] : stagingArea) {
-            if (commitFiles.count(filename)) {
-                // File exists in both staged and committed, check if content differs
-                if (commitFiles.at(filename) != stagedBlobHash) {
-                    changes.modified.push_back(filename);
-                }
-            } else {
-                // New file added to staging
-                changes.added.push_back(filename);
-            }
-        }
-
-        // Check for files that were in the current commit but are now missing from staging
-        // This implies they were "removed" (like `git rm` but we don't have rm, so implicitly by user deletion + add)
-        for (const auto& [filename, blobHash] : commitFiles) {
-            if (!stagingArea.count(filename)) { // If file was in commit, but not in staging
-                // This means it's either deleted from staging, or it was deleted from WD and never added to staging.
-                // For simplicity, we assume if it's missing from staging, it's considered deleted if it's also missing from WD.
-                // A true `git rm` would stage the deletion.
-                if (!fs::exists(filename)) { // If it's also not in the working directory
-                     changes.deleted.push_back(filename);
-                }
-            }
-        }
-        return changes;
-    }
-
-    // Helper function to compare two strings line by line and print differences
-    // This is a very basic diff, not a sophisticated algorithm like Myers'
-    void displayLineDiff(const std::string& oldContent, const std::string& newContent, const std::string& filename) {
-        std::cout << "--- Diff for: " << filename << " ---\n";
-        std::stringstream oldSs(oldContent);
-        std::stringstream newSs(newContent);
-        std::string oldLine, newLine;
-
-        std::vector<std::string> oldLines, newLines;
-        while (std::getline(oldSs, oldLine)) {
-            oldLines.push_back(oldLine);
-        }
-        while (std::getline(newSs, newLine)) {
-            newLines.push_back(newLine);
-        }
-
-        size_t oldIdx = 0;
-        size_t newIdx = 0;
-
-        // This is a very simple diff, primarily showing additions/deletions for lines that
-        // don't have a direct 1:1 match. It won't handle moved blocks well.
-        // For a more robust diff, a true longest common subsequence (LCS) algorithm is needed.
-        while (oldIdx < oldLines.size() || newIdx < newLines.size()) {
-            bool matched = false;
-            if (oldIdx < oldLines.size() && newIdx < newLines.size()) {
-                if (oldLines[oldIdx] == newLines[newIdx]) {
-                    std::cout << "  " << oldLines[oldIdx] << "\n";
-                    oldIdx++;
-                    newIdx++;
-                    matched = true;
-                }
-            }
-
-            if (!matched) {
-                // Try to find if current oldLine exists later in newLines
-                // or if current newLine exists later in oldLines
-                size_t tempOldIdx = oldIdx;
-                size_t tempNewIdx = newIdx;
-                bool oldFoundInNew = false;
-                bool newFoundInOld = false;
-
-                if (oldIdx < oldLines.size()) {
-                    for (size_t i = newIdx; i < newLines.size(); ++i) {
-                        if (oldLines[oldIdx] == newLines[i]) {
-                            oldFoundInNew = true;
-                            break;
-                        }
-                    }
-                }
-                if (newIdx < newLines.size()) {
-                    for (size_t i = oldIdx; i < oldLines.size(); ++i) {
-                        if (newLines[newIdx] == oldLines[i]) {
-                            newFoundInOld = true;
-                            break;
-                        }
-                    }
-                }
-
-                if (oldIdx < oldLines.size() && !oldFoundInNew) {
-                    std::cout << "- " << oldLines[oldIdx] << "\n";
-                    oldIdx++;
-                } else if (newIdx < newLines.size() && !newFoundInOld) {
-                    std::cout << "+ " << newLines[newIdx] << "\n";
-                    newIdx++;
-                } else { // Fallback for when both might be different or complex sequence
-                    if (oldIdx < oldLines.size() && !newFoundInOld) { // If old line is not found in remaining new, it's a deletion
-                         std::cout << "- " << oldLines[oldIdx] << "\n";
-                         oldIdx++;
-                    }
-                    if (newIdx < newLines.size() && !oldFoundInNew) { // If new line is not found in remaining old, it's an addition
-                         std::cout << "+ " << newLines[newIdx] << "\n";
-                         newIdx++;
-                    }
-                     // If both are still remaining and seem to be a change, prioritize one or the other.
-                     // This simple diff prioritizes printing deletions then additions if ambiguous.
-                }
-            }
-        }
-        std::cout << "---------------------------\n";
-    }
-
-
-public:
-    // --- Public API ---
-
-    // Constructor: Attempts to load existing repository state.
-    MiniGitSystem() {
-        if (fs::exists(".minigit")) {
-            std::cout << "Loading existing MiniGit repository...\n";
-            loadRepoState(); // Consolidate loading logic
-            std::cout << "MiniGit repository loaded.\n";
-        } else {
-            std::cout << "No existing MiniGit repository found. Call 'init' to create one.\n";
-            // Set default initial state for a new repo that hasn't been init'd
-            headBranch = "master";
-            headCommitHash = "";
-            stagingArea.clear();
-            commits.clear();
-            branches.clear();
-        }
-    }
-
-    // Initializes a new MiniGit repository.
-    void init() {
-        if (fs::exists(".minigit")) {
-            std::cout << "MiniGit repository already initialized in .minigit\n";
-            return;
-        }
-        try {
-            fs::create_directory(".minigit");
-            fs::create_directory(".minigit/objects");
-            fs::create_directory(".minigit/commits");
-            fs::create_directories(".minigit/refs/heads"); // For branch pointers
-
-            headBranch = "master";
-            headCommitHash = ""; // No commits yet
-            branches["master"] = ""; // Master points to no commit initially
-            saveHeadAndBranchRefs(); // Create the HEAD file and master ref
-            std::cout << "Initialized empty MiniGit repository in .minigit\n";
-        } catch (const fs::filesystem_error& e) {
-            std::cerr << "Error initializing MiniGit repository: " << e.what() << "\n";
-        }
-    }
-
-    // Adds a file's current content to the staging area.
-    void add(const std::string& filename) {
-        if (!fs::exists(".minigit")) {
-            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
-            return;
-        }
-        if (!fs::exists(filename)) {
-            std::cout << "Error: File does not exist: " << filename << "\n";
-            return;
-        }
-        if (!fs::is_regular_file(filename)) {
-            std::cout << "Error: Not a regular file: " << filename << "\n";
-            return;
-        }
-
-        std::string content = readFileContent(filename);
-        if (content.empty() && !fs::is_empty(filename)) { // Check for read failure on non-empty files
-            std::cerr << "Warning: Could not read content of file: " << filename << ". Not added.\n";
-            return;
-        }
-        std::string hash = hashFileContent(content);
-
-        // Optimization: Don't re-add if content hasn't changed and is already staged
-        if (stagingArea.count(filename) && stagingArea[filename] == hash) {
-            std::cout << "File already up to date in staging: " << filename << "\n";
-            return;
-        }
-
-        stagingArea[filename] = hash;
-        saveBlob(hash, content);
-        std::cout << "Added file to staging: " << filename << " (" << hash.substr(0, 7) << ")\n";
-    }
-
-    // Commits staged changes with a given message.
-    void commit(const std::string& message) {
-        if (!fs::exists(".minigit")) {
-            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
-            return;
-        }
-
-        const Commit* currentHeadCommit = nullptr;
-        if (!headCommitHash.empty()) {
-            // Ensure the head commit is loaded if it wasn't already (e.g. after init/clone)
-            if (commits.find(headCommitHash) == commits.end()) {
-                commits[headCommitHash] = loadCommitFromFile(headCommitHash);
-            }
-            currentHeadCommit = &commits[headCommitHash];
-        }
-
-        // Get staged changes to check if there's anything to commit
-        StagedChanges staged = getStagedChanges(currentHeadCommit);
-
-        // Check if there are any staged changes at all
-        if (staged.added.empty() && staged.modified.empty() && staged.deleted.empty()) {
-            std::cout << "No changes to commit. Staging area is empty or identical to HEAD.\n";
-            stagingArea.clear(); // Ensure staging is clear if no effective changes
-            return;
-        }
-
-
-        Commit newCommit;
-        newCommit.timestamp = getCurrentTime();
-        newCommit.message = message;
-
-        if (!headCommitHash.empty()) {
-            newCommit.parentHashes.push_back(headCommitHash);
-            // Start the new commit's file snapshot by copying from the parent
-            newCommit.fileBlobs = currentHeadCommit->fileBlobs;
-        }
-
-        // Apply staged changes to the new commit's file snapshot
-        for (const auto& [filename, blob] : stagingArea) {
-            // Add or update file in the new commit's snapshot
-            newCommit.fileBlobs[filename] = blob;
-        }
-
-        // Handle explicitly 'removed' files from the commit snapshot
-        // Files marked as 'deleted' in staged changes should be removed from the new commit's snapshot
-        for(const auto& filename : staged.deleted) {
-            newCommit.fileBlobs.erase(filename);
-        }
-
-        // Generate commit hash based on its content (message, timestamp, parent, and file tree hashes)
-        std::string commitContentToHash = newCommit.message + newCommit.timestamp;
-        for (const auto& parent : newCommit.parentHashes) commitContentToHash += parent;
-        for (const auto& [f, b] : newCommit.fileBlobs) commitContentToHash += f + b;
-
-        newCommit.hash = hashFileContent(commitContentToHash);
-
-        commits[newCommit.hash] = newCommit;
-        headCommitHash = newCommit.hash;
-
-        if (!headBranch.empty()) { // Update current branch if not in detached HEAD
-            branches[headBranch] = newCommit.hash;
-        }
-        saveHeadAndBranchRefs(); // Update branch ref file and HEAD file
-
-        writeCommitToFile(newCommit);
-        stagingArea.clear(); // Clear staging area after successful commit
-        std::cout << "Committed as " << newCommit.hash.substr(0, 7) << "\n";
-    }
-
-    // Displays the commit history.
-    void log() {
-        if (!fs::exists(".minigit")) {
-            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
-            return;
-        }
-        if (headCommitHash.empty()) {
-            std::cout << "No commits yet.\n";
-            return;
-        }
-        std::cout << "--- Commit History ---\n";
-        std::string current = headCommitHash;
-        std::unordered_set<std::string> visitedCommits; // To prevent infinite loops in complex graphs
-
-        while (!current.empty() && visitedCommits.find(current) == visitedCommits.end()) {
-            if (commits.find(current) == commits.end()) {
-                // If a commit is referenced but not loaded, try to load it
-                commits[current] = loadCommitFromFile(current);
-                if (commits.find(current) == commits.end() || commits[current].hash.empty()) {
-                    std::cerr << "Error: Corrupt commit reference " << current << ". Stopping log.\n";
-                    break;
-                }
-            }
-            Commit& c = commits[current];
-            std::cout << "Commit: " << c.hash.substr(0, 7);
-            if (!headBranch.empty() && branches[headBranch] == current) {
-                std::cout << " (HEAD -> " << headBranch << ")";
-            } else if (headBranch.empty() && headCommitHash == current) {
-                std::cout << " (HEAD, detached)";
-            }
-            // Also show other branches pointing to this commit
-            for (const auto& [branchName, commitHash] : branches) {
-                if (branchName != headBranch && commitHash == current) {
-                    std::cout << ", " << branchName;
-                }
-            }
-            std::cout << "\n";
-
-            if (!c.parentHashes.empty()) {
-                std::cout << "Parents: ";
-                for (const auto& p : c.parentHashes) {
-                    std::cout << p.substr(0, 7) << " ";
-                }
-                std::cout << "\n";
-            }
-            std::cout << "Date:    " << c.timestamp << "\n";
-            std::cout << "Message: " << c.message << "\n\n";
-            visitedCommits.insert(current);
-            current = c.parentHashes.empty() ? "" : c.parentHashes[0]; // Follow first parent for simplicity
-        }
-        std::cout << "----------------------\n";
-    }
-
-    // Creates a new branch pointing to the current HEAD commit.
-    void branch(const std::string& name) {
-        if (!fs::exists(".minigit")) {
-            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
-            return;
-        }
-        if (headCommitHash.empty()) {
-            std::cout << "Cannot create branch: No commits yet.\n";
-            return;
-        }
-        if (branches.count(name)) {
-            std::cout << "Error: Branch '" << name << "' already exists.\n";
-            return;
-        }
-        branches[name] = headCommitHash;
-        saveHeadAndBranchRefs(); // Persist the new branch reference
-        std::cout << "Created branch: " << name << " pointing to " << headCommitHash.substr(0, 7) << "\n";
-    }
-
-    // Switches between branches or checks out a specific commit.
-    void checkout(const std::string& target) {
-        if (!fs::exists(".minigit")) {
-            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
-            return;
-        }
-
-        // Check for uncommitted changes (both staged and unstaged)
-        const Commit* currentHeadCommit = nullptr;
-        if (!headCommitHash.empty()) {
-            if (commits.find(headCommitHash) == commits.end()) {
-                commits[headCommitHash] = loadCommitFromFile(headCommitHash);
-            }
-            currentHeadCommit = &commits[headCommitHash];
-        }
-        StagedChanges staged = getStagedChanges(currentHeadCommit);
-        WorkingDirChanges unstaged = getUnstagedChanges(currentHeadCommit);
-
-        if (!staged.added.empty() || !staged.modified.empty() || !staged.deleted.empty() ||
-            !unstaged.modified.empty() || !unstaged.deleted.empty() || !unstaged.untracked.empty()) {
-            std::cout << "Error: Your working directory has uncommitted changes. Please commit or stash them before checking out.\n";
-            status(); // Show the user what changes are pending
-            return;
-        }
-
-        std::string targetCommitHash = "";
-        std::string newHeadBranch = "";
-
-        // Try to checkout a branch
-        if (branches.count(target)) {
-            targetCommitHash = branches[target];
-            newHeadBranch = target;
-        } else { // Try to checkout a commit (by its full hash or first 7 chars)
-            std::string resolvedCommitHash = "";
-            if (commits.count(target)) { // Exact match
-                resolvedCommitHash = target;
-            } else { // Try partial match (first 7 chars)
-                for (const auto& pair : commits) {
-                    if (pair.first.rfind(target, 0) == 0 && target.length() >= 4) { // Use at least 4 chars for short hash
-                        resolvedCommitHash = pair.first;
-                        break;
-                    }
-                }
-            }
-            targetCommitHash = resolvedCommitHash;
-            // newHeadBranch remains empty for detached HEAD
-        }
-
-        if (targetCommitHash.empty() && !newHeadBranch.empty()) {
-            // Special case: checking out an empty branch (e.g., master after init, before first commit)
-            if (headBranch == newHeadBranch) {
-                std::cout << "Already on branch '" << newHeadBranch << "'.\n";
-                return;
-            }
-            std::cout << "Switched to branch: " << newHeadBranch << " (empty branch, no files restored).\n";
-            // Clear working directory as there's no snapshot to restore.
-             for (const auto& entry : fs::directory_iterator(".")) {
-                std::string filename = entry.path().filename().string(); // Corrected: Get filename as string
-                if (entry.is_regular_file() && filename != ".minigit" && filename[0] != '.') { // Corrected: Access first char of string
-                    try {
-                        fs::remove(entry.path());
-                    } catch (const fs::filesystem_error& e) {
-                        std::cerr << "Warning: Could not remove file " << filename << " during empty branch checkout: " << e.what() << "\n";
-                    }
-                }
-            }
-            headBranch = newHeadBranch;
-            headCommitHash = targetCommitHash; // Will be empty
-            saveHeadAndBranchRefs();
-            stagingArea.clear();
-            return;
-        }
-
-        if (targetCommitHash.empty()) {
-            std::cout << "Error: Branch or commit not found: " << target << "\n";
-            return;
-        }
-
-        // Ensure the target commit is loaded
-        if (commits.find(targetCommitHash) == commits.end()) {
-            commits[targetCommitHash] = loadCommitFromFile(targetCommitHash);
-            if (commits[targetCommitHash].hash.empty()) {
-                std::cerr << "Error: Target " << target << " points to a corrupt commit. Cannot checkout.\n";
-                return;
-            }
-        }
-
-        // Check if we are already at the target
-        if (headCommitHash == targetCommitHash && ((newHeadBranch.empty() && headBranch.empty()) || (newHeadBranch == headBranch))) {
-            std::cout << "Already on " << (newHeadBranch.empty() ? "commit " + targetCommitHash.substr(0,7) + " (detached HEAD)" : "branch '" + newHeadBranch + "'") << ".\n";
-            return;
-        }
-
-
-        headBranch = newHeadBranch;
-        headCommitHash = targetCommitHash;
-        saveHeadAndBranchRefs(); // Update HEAD file and branch ref (if applicable)
-        populateWorkingDirectory(commits[headCommitHash]);
-        if (newHeadBranch.empty()) {
-            std::cout << "Checked out commit: " << headCommitHash.substr(0, 7) << " (detached HEAD)\n";
-        } else {
-            std::cout << "Switched to branch: " << newHeadBranch << "\n";
-        }
-        stagingArea.clear(); // Clear staging area on checkout
-    }
-
-    // Displays the current status of the repository (staged, unstaged, untracked files).
-    void status() {
-        if (!fs::exists(".minigit")) {
-            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
-            return;
-        }
-        std::cout << "--- MiniGit Status ---\n";
-        std::cout << "On branch " << (headBranch.empty() ? "(detached HEAD)" : headBranch) << "\n";
-        std::cout << "HEAD points to: " << (headCommitHash.empty() ? "No commits yet" : headCommitHash.substr(0, 7)) << "\n\n";
-
-        const Commit* currentHeadCommit = nullptr;
-        if (!headCommitHash.empty()) {
-            if (commits.find(headCommitHash) == commits.end()) {
-                // If commit not in memory, try loading it (should ideally be loaded by loadRepoState)
-                commits[headCommitHash] = loadCommitFromFile(headCommitHash);
-                if (commits[headCommitHash].hash.empty()) {
-                    std::cerr << "Warning: HEAD commit " << headCommitHash.substr(0,7) << " not found/corrupt during status check.\n";
-                    currentHeadCommit = nullptr;
-                } else {
-                    currentHeadCommit = &commits[headCommitHash];
-                }
-            } else {
-                currentHeadCommit = &commits[headCommitHash];
-            }
-        }
-
-        StagedChanges staged = getStagedChanges(currentHeadCommit);
-        if (!staged.added.empty() || !staged.modified.empty() || !staged.deleted.empty()) {
-            std::cout << "Changes to be committed:\n";
-            for (const auto& file : staged.added) {
-                std::cout << "    New file:   " << file << "\n";
-            }
-            for (const auto& file : staged.modified) {
-                std::cout << "    Modified:   " << file << "\n";
-            }
-             for (const auto& file : staged.deleted) {
-                std::cout << "    Deleted:    " << file << "\n";
-            }
-            std::cout << "\n";
-        } else {
-            std::cout << "No changes to be committed.\n\n";
-        }
-
-        WorkingDirChanges unstaged = getUnstagedChanges(currentHeadCommit);
-        bool hasUnstagedChanges = !unstaged.modified.empty() || !unstaged.deleted.empty();
-
-        if (hasUnstagedChanges) {
-            std::cout << "Changes not staged for commit:\n";
-            for (const auto& file : unstaged.modified) {
-                std::cout << "    Modified:   " << file << "\n";
-            }
-            for (const auto& file : unstaged.deleted) {
-                std::cout << "    Deleted:    " << file << "\n";
-            }
-            std::cout << "\n";
-        } else {
-             std::cout << "No changes not staged for commit.\n\n";
-        }
-
-        if (!unstaged.untracked.empty()) {
-            std::cout << "Untracked files:\n";
-            std::cout << "  (use \"minigit add <file>...\" to include in what will be committed)\n";
-            for (const auto& file : unstaged.untracked) {
-                std::cout << "    " << file << "\n";
-            }
-            std::cout << "\n";
-        } else {
-            std::cout << "No untracked files.\n\n";
-        }
-
-        if (staged.added.empty() && staged.modified.empty() && staged.deleted.empty() &&
-            unstaged.modified.empty() && unstaged.deleted.empty() && unstaged.untracked.empty()) {
-            std::cout << "Your working directory is clean.\n";
-        }
-        std::cout << "----------------------\n";
-    }
-
-    // Displays differences between various states (WD, staging, commits).
-    void diff(const std::string& arg1 = "", const std::string& arg2 = "") {
-        if (!fs::exists(".minigit")) {
-            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
-            return;
-        }
-
-        // Helper to resolve short hashes to full hashes
-        auto resolveHash = [&](std::string hash) {
-            if (hash.length() == 40) return hash; // Already full hash
-            for (const auto& pair : commits) {
-                if (pair.first.rfind(hash, 0) == 0 && hash.length() >= 4) { // Match prefix
-                    return pair.first;
-                }
-            }
-            return std::string(""); // Not found
-        };
-
-        // Scenario 1: diff working directory vs staging area (like 'git diff' without arguments)
-        if (arg1.empty() && arg2.empty()) {
-            std::cout << "Diff: Working Directory vs Staging Area (unstaged changes)\n";
-            std::unordered_map<std::string, std::string> compareToFiles = stagingArea; // Compare WD to staged
-
-            bool foundDiff = false;
-            // Iterate through files in working directory
-            for (const auto& entry : fs::directory_iterator(".")) {
-                std::string filename = entry.path().filename().string(); // Corrected: Declare filename here
-                if (entry.is_regular_file() && filename != ".minigit" && filename[0] != '.') {
-                    std::string wdContent = readFileContent(filename);
-                    std::string wdHash = hashFileContent(wdContent);
-
-                    if (compareToFiles.count(filename)) { // File exists in staging
-                        std::string stagedBlobHash = compareToFiles.at(filename);
-                        std::string stagedContent = loadBlob(stagedBlobHash);
-                        if (wdContent != stagedContent) {
-                            displayLineDiff(stagedContent, wdContent, filename);
-                            foundDiff = true;
-                        }
-                    } else { // File in WD, but not in staging (untracked, or deleted from staging)
-                        // If it's a new untracked file, it won't be in staging.
-                        // We only show diffs for files that are 'known' to git in some way (tracked/staged)
-                        // This behavior mimics `git diff` which usually ignores untracked files by default.
-                    }
-                }
-            }
-            // Check for files that were in staging but are no longer in WD (deleted)
-            for (const auto& pair : compareToFiles) {
-                std::string filename = pair.first;
-                if (!fs::exists(filename)) {
-                    displayLineDiff(loadBlob(pair.second), "", filename + " (deleted from WD)");
-                    foundDiff = true;
-                }
-            }
-
-
-            if (!foundDiff) {
-                std::cout << "No differences in working directory compared to staged area.\n";
-            }
-        }
-        // Scenario 2: diff staging area vs HEAD commit (like 'git diff --staged' or 'git diff --cached')
-        else if (arg1 == "--staged" || arg1 == "--cached") {
-            std::cout << "Diff: Staging Area vs HEAD commit (staged changes)\n";
-            if (headCommitHash.empty()) {
-                std::cout << "No HEAD commit to compare against. Use `commit` first.\n";
-                return;
-            }
-            if (commits.find(headCommitHash) == commits.end()) {
-                commits[headCommitHash] = loadCommitFromFile(headCommitHash);
-            }
-            const Commit& headCommit = commits[headCommitHash];
-
-            std::unordered_set<std::string> allFiles;
-            for (const auto& pair : stagingArea) allFiles.insert(pair.first);
-            for (const auto& pair : headCommit.fileBlobs) allFiles.insert(pair.first);
-
-            bool foundDiff = false;
-            for (const std::string& filename : allFiles) {
-                bool inStaging = stagingArea.count(filename);
-                bool inHead = headCommit.fileBlobs.count(filename);
-
-                if (inStaging && inHead) {
-                    std::string stagedContent = loadBlob(stagingArea.at(filename));
-                    std::string headContent = loadBlob(headCommit.fileBlobs.at(filename));
-                    if (stagedContent != headContent) {
-                        displayLineDiff(headContent, stagedContent, filename);
-                        foundDiff = true;
-                    }
-                } else if (inHead && !inStaging) { // Deleted from staging
-                    displayLineDiff(loadBlob(headCommit.fileBlobs.at(filename)), "", filename + " (deleted from staged)");
-                    foundDiff = true;
-                } else if (!inHead && inStaging) { // Added to staging
-                    displayLineDiff("", loadBlob(stagingArea.at(filename)), filename + " (new file staged)");
-                    foundDiff = true;
-                }
-            }
-            if (!foundDiff) {
-                std::cout << "No staged changes to show.\n";
-            }
-        }
-        // Scenario 3: diff two commits (e.g., 'minigit diff <commit1> <commit2>')
-        else if (!arg1.empty() && !arg2.empty()) {
-            std::string commit1Hash = resolveHash(arg1);
-            std::string commit2Hash = resolveHash(arg2);
-
-            if (commit1Hash.empty() || commits.find(commit1Hash) == commits.end() || commits[commit1Hash].hash.empty()) {
-                std::cerr << "Error: Commit " << arg1 << " not found or corrupt.\n";
-                return;
-            }
-            if (commit2Hash.empty() || commits.find(commit2Hash) == commits.end() || commits[commit2Hash].hash.empty()) {
-                std::cerr << "Error: Commit " << arg2 << " not found or corrupt.\n";
-                return;
-            }
-
-            const Commit& c1 = commits[commit1Hash];
-            const Commit& c2 = commits[commit2Hash];
-
-            std::cout << "Diff between " << c1.hash.substr(0, 7) << " and " << c2.hash.substr(0, 7) << "\n";
-
-            std::unordered_set<std::string> allFiles;
-            for (const auto& pair : c1.fileBlobs) allFiles.insert(pair.first);
-            for (const auto& pair : c2.fileBlobs) allFiles.insert(pair.first);
-
-            bool foundDiff = false;
-            for (const std::string& filename : allFiles) {
-                bool inC1 = c1.fileBlobs.count(filename);
-                bool inC2 = c2.fileBlobs.count(filename);
-
-                if (inC1 && inC2) {
-                    if (c1.fileBlobs.at(filename) != c2.fileBlobs.at(filename)) {
-                        // File modified
-                        displayLineDiff(loadBlob(c1.fileBlobs.at(filename)), loadBlob(c2.fileBlobs.at(filename)), filename);
-                        foundDiff = true;
-                    }
-                } else if (inC1 && !inC2) {
-                    // File deleted in c2
-                    displayLineDiff(loadBlob(c1.fileBlobs.at(filename)), "", filename + " (deleted)");
-                    foundDiff = true;
-                } else if (!inC1 && inC2) {
-                    // File added in c2
-                    displayLineDiff("", loadBlob(c2.fileBlobs.at(filename)), filename + " (new file)");
-                    foundDiff = true;
-                }
-            }
-            if (!foundDiff) {
-                std::cout << "No differences between commits.\n";
-            }
-        }
-        // Scenario 4: diff working directory vs a specific commit (e.g., 'minigit diff <commit>')
-        else if (!arg1.empty() && arg2.empty()) {
-            std::string targetCommitHash = resolveHash(arg1);
-            if (targetCommitHash.empty() || commits.find(targetCommitHash) == commits.end() || commits[targetCommitHash].hash.empty()) {
-                std::cerr << "Error: Commit " << arg1 << " not found or corrupt.\n";
-                return;
-            }
-            const Commit& targetCommit = commits[targetCommitHash];
-
-            std::cout << "Diff: Working Directory vs Commit " << targetCommit.hash.substr(0, 7) << "\n";
-
-            std::unordered_set<std::string> allFiles;
-            for (const auto& entry : fs::directory_iterator(".")) {
-                std::string filename = entry.path().filename().string(); // Corrected: Declare filename here
-                if (entry.is_regular_file() && filename != ".minigit" && filename[0] != '.') {
-                    allFiles.insert(filename);
-                }
-            }
-            for (const auto& pair : targetCommit.fileBlobs) {
-                allFiles.insert(pair.first);
-            }
-
-            bool foundDiff = false;
-            for (const std::string& filename : allFiles) {
-                bool inWD = fs::exists(filename) && fs::is_regular_file(filename);
-                bool inCommit = targetCommit.fileBlobs.count(filename);
-
-                if (inWD && inCommit) {
-                    std::string wdContent = readFileContent(filename);
-                    std::string commitContent = loadBlob(targetCommit.fileBlobs.at(filename));
-                    if (wdContent != commitContent) {
-                        displayLineDiff(commitContent, wdContent, filename);
-                        foundDiff = true;
-                    }
-                } else if (inCommit && !inWD) {
-                    // File deleted in WD
-                    displayLineDiff(loadBlob(targetCommit.fileBlobs.at(filename)), "", filename + " (deleted in WD)");
-                    foundDiff = true;
-                } else if (inWD && !inCommit) {
-                    // File added in WD (untracked from commit's perspective)
-                    displayLineDiff("", readFileContent(filename), filename + " (new in WD)");
-                    foundDiff = true;
-                }
-            }
-            if (!foundDiff) {
-                std::cout << "No differences in working directory compared to commit " << targetCommit.hash.substr(0, 7) << ".\n";
-            }
-        }
-        else {
-            std::cout << "Usage:\n";
-            std::cout << "  minigit diff                          # Show diff between working directory and staging\n";
-            std::cout << "  minigit diff --staged (or --cached) # Show diff between staging and HEAD commit\n";
-            std::cout << "  minigit diff <commit>                 # Show diff between working directory and a commit\n";
-            std::cout << "  minigit diff <commit1> <commit2>      # Show diff between two commits\n";
-        }
-    }
-};
-
+#ifndef MINIGIT_SYSTEM_HPP
+#define MINIGIT_SYSTEM_HPP
+
+#include <iostream>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <map>
+#include <queue>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <chrono>
+#include <ctime>
+#include <sstream>
+#include <iomanip> // For std::put_time
+#include <algorithm> // For std::remove_if
+#include <cstdint>
+#include <cstdlib> // For std::atoi
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#ifndef _WIN32
+#include <sys/stat.h> // For stat() in the index stat-cache
+#endif
+
+#include "HashEngine.hpp"
+#include "Encoding.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+#include "DiffEngine.hpp"
+#include "PackFile.hpp"
+#include "Chunker.hpp"
+#include "CommitGraph.hpp"
+#include "ObjectFormat.hpp"
+#include "ObjectNameIndex.hpp"
+#include "RefStore.hpp"
+#include "ObjectWriter.hpp"
+#include "BloomFilter.hpp"
+#include "MergeEngine.hpp"
+#include "Trace.hpp"
+#include "FileTable.hpp"
+#include "BlobPrefetcher.hpp"
+#include "IgnoreRules.hpp"
+#include "ObjectSource.hpp"
+
+namespace fs = std::filesystem;
+
+class MiniGitSystem {
+private:
+    // --- Data Structures ---
+    struct Commit {
+        std::string hash;
+        std::string message;
+        std::string timestamp;
+        std::vector<std::string> parentHashes;
+        std::string treeHash; // Root tree object; empty for commits written before tree objects existed
+        // path -> blob hash, shared by every commit with the same tree. For tree commits this is built from
+        // the tree on first use (see filesOf()); commits without a tree carry it from their commit file.
+        mutable std::shared_ptr<const FileTable> files;
+    };
+
+    // A tree object lists one directory: entries sorted by name, each either a blob or a subtree.
+    struct TreeEntry {
+        std::string name;
+        std::string hash;
+        bool isTree = false;
+    };
+    using Tree = std::vector<TreeEntry>;
+
+    // One path that differs between two snapshots. An empty hash means the path is absent on that side.
+    struct FileChange {
+        std::string path;
+        std::string oldBlob;
+        std::string newBlob;
+    };
+
+    // Core data:
+    std::unordered_map<std::string, Commit> commits;       // hash -> Commit object
+    ObjectNameIndex commitIds;                              // Sorted IDs of every commit file, for abbreviations
+    bool commitIdsLoaded = false;
+    std::unordered_map<std::string, Tree> trees;           // hash -> parsed tree object (cache)
+    std::shared_ptr<PathTable> pathTable = std::make_shared<PathTable>(); // Every path of every loaded snapshot, once
+    std::unordered_map<std::string, std::shared_ptr<const FileTable>> fileTables; // root tree hash -> flattened files
+    std::unordered_map<std::string, std::string> branches; // branch name -> commit hash
+    RefStore refStore;                                      // packed-refs + loose refs under .minigit/refs/heads
+    std::unordered_map<std::string, std::string> stagingArea; // filename -> blob hash
+
+    // Stat-cache persisted in .minigit/index alongside the staging area.
+    // If a file's stat data still matches its entry, its cached hash is reused instead of re-reading the file.
+    struct IndexEntry {
+        std::string blobHash;  // Hash of the working directory content when it was stat'ed
+        int64_t mtimeNs = 0;
+        uint64_t size = 0;
+        uint64_t inode = 0;
+    };
+    std::unordered_map<std::string, IndexEntry> statCache; // filename -> last known stat data and hash
+    bool indexDirty = false;                                // True when statCache/stagingArea differ from .minigit/index
+
+    // Working-tree snapshot of a long-running process (daemon mode). A file watcher reports changed paths
+    // through markWorkingPathsDirty(); listWorkingFiles() and hashWorkingFiles() then only revisit those
+    // paths instead of walking, stat'ing and hashing the whole tree on every query.
+    struct WorkingTreeCache {
+        bool enabled = false;
+        bool valid = false;                                  // False until the first full scan (or after lost events)
+        std::set<std::string> files;
+        std::unordered_map<std::string, std::string> hashes; // path -> content hash of files unchanged since hashed
+        std::unordered_set<std::string> dirty;               // Paths (files or directories) changed since the last query
+    };
+    WorkingTreeCache workingTree;
+
+    // .minigitignore at the repository root, re-read whenever its stat data changes (see ignoreRules()).
+    static constexpr const char* IGNORE_PATH = ".minigitignore";
+    struct IgnoreState {
+        IgnoreRules rules;
+        IndexEntry stat; // Of the file when it was read; zero if it did not exist
+        bool loaded = false;
+    };
+    IgnoreState ignore;
+
+    unsigned int jobs = 1; // Worker threads for working-tree scans and checkout writeback (0 = one per hardware thread)
+    bool jobsGiven = false; // 'jobs' was asked for (--jobs): blob prefetching stays within it as well
+    static constexpr size_t PARALLEL_WRITEBACK_MIN_FILES = 32; // Smaller checkouts are written serially
+    static constexpr unsigned int PREFETCH_THREADS = 8; // Blob reads kept in flight by checkout and commit diffs (I/O-bound)
+    static constexpr size_t PREFETCH_WINDOW = 64;       // Blobs loaded ahead of their consumer at most
+    static constexpr size_t PREFETCH_BYTES = 64 << 20;  // Bytes of loaded blobs waiting for their consumer at most
+
+    DiffAlgorithm diffAlgorithm = DiffAlgorithm::Myers; // Line diff algorithm used by 'diff'
+    size_t diffContextLines = 3;                        // Unchanged lines shown around each hunk
+
+    // Repository format (.minigit/config). Repositories without a config file are format 1 and use std::hash IDs.
+    // Format 3 stores loose objects compressed (LOOSE_OBJECT_MAGIC + envelope); formats 1 and 2 store them raw.
+    // Format 4 writes commits and trees in the binary encodings of ObjectFormat.hpp; older text objects stay readable.
+    // Format 5 shards loose objects and commits into fanout directories (see storePath()); 'upgrade' migrates older repositories.
+    static constexpr int REPO_FORMAT_VERSION = 5;
+    static constexpr std::string_view LOOSE_OBJECT_MAGIC = "MGZ1";
+    static constexpr std::string_view CHUNK_MANIFEST_MAGIC = "MGC1"; // Loose blob stored as chunks (see saveChunkedBlob())
+    int repoFormatVersion = 1;
+    HashAlgorithm hashAlgorithm = HashAlgorithm::LegacyStdHash;
+    uint64_t chunkThreshold = 0; // Files at least this large are stored as deduplicated chunks (0 = never)
+    bool fanoutMigrationPending = false; // An 'upgrade' to format 5 was interrupted: files may still be at flat paths
+
+    CommitGraph commitGraph; // Mapped .minigit/commit-graph; history walks use it before parsing commit files
+
+    ObjectWriter objectWriter; // Blobs, trees and commits staged for the next durable batch write
+
+    // Packfiles in .minigit/objects/pack, opened the first time an object is not found loose.
+    std::vector<std::unique_ptr<PackFile>> packs;
+    bool packsLoaded = false;
+
+    // Partial and shallow clones (see clone()). Commits and objects the clone omitted are fetched from the
+    // object source (.minigit/config "object_source") the first time they are needed and kept as loose files.
+    static constexpr const char* SHALLOW_PATH = ".minigit/shallow";   // Boundary commits whose parents were not cloned
+    static constexpr const char* OMITTED_PATH = ".minigit/omitted";   // Sorted IDs the source had and the clone did not copy
+    std::string objectSourcePath;             // Empty for complete repositories
+    ObjectSource objectSource;                // Opened on the first fetch, under objectSourceMutex
+    bool objectSourceFailed = false;          // Opening failed once: not retried (or reported) again
+    std::vector<std::string> omittedIds;      // OMITTED_PATH, loaded when a fetch fails
+    bool omittedLoaded = false;
+    std::mutex objectSourceMutex;             // Fetches run on prefetch workers too
+    std::unordered_set<std::string> shallowCommits; // SHALLOW_PATH: history walks end at these commits
+    ObjectNameIndex sourceCommitIds;          // Every commit of the source, for abbreviations of omitted commits
+    bool sourceCommitIdsLoaded = false;
+
+    // What hasObject() knows without asking the filesystem (see loadObjectCache()).
+    struct ObjectCache {
+        bool loaded = false;
+        bool listed = false;                   // 'loose' holds every loose object: the directory was listed
+        std::unordered_set<std::string> loose; // Loose objects known to exist
+        BloomFilter filter;                    // Every object ID, persisted in OBJECT_FILTER_PATH
+    };
+    ObjectCache objectCache;
+    static constexpr const char* OBJECT_FILTER_PATH = ".minigit/object-filter";
+
+    // Current state:
+    std::string headBranch = "master";      // The currently active branch (e.g., "master", "feature-a")
+    std::string headCommitHash;             // The hash of the commit HEAD currently points to
+
+    // --- Private Utility Methods ---
+
+    // Generates a formatted timestamp for commits.
+    std::string getCurrentTime() {
+        auto now = std::chrono::system_clock::now();
+        std::time_t now_time = std::chrono::system_clock::to_time_t(now);
+        std::stringstream ss;
+        ss << std::put_time(std::localtime(&now_time), "%Y-%m-%d %H:%M:%S");
+        return ss.str();
+    }
+
+    // Hashes content with the repository's hash engine (see HashEngine.hpp).
+    std::string hashFileContent(std::string_view content) {
+        TRACE_SCOPE("hashFileContent");
+        TRACE_COUNT(TraceCounter::BytesHashed, content.size());
+        std::unique_ptr<Hasher> hasher = makeHasher(hashAlgorithm);
+        hasher->update(content.data(), content.size());
+        return hasher->finalize();
+    }
+
+    // Hashes a file in fixed-size chunks (read(), never mapped: it may be truncated meanwhile),
+    // so it is never copied into a std::string. An unreadable file hashes like empty content.
+    std::string hashFile(const std::string& filename) {
+        TRACE_SCOPE("hashFile");
+        std::unique_ptr<Hasher> hasher = makeHasher(hashAlgorithm);
+        MappedFile::forEachChunk(filename, [&](const char* data, size_t size) {
+            TRACE_COUNT(TraceCounter::BytesHashed, size);
+            hasher->update(data, size);
+        });
+        return hasher->finalize();
+    }
+
+    // Reads .minigit/config ("key=value" lines). A missing file means a format 1 (legacy) repository.
+    void loadRepoConfig() {
+        repoFormatVersion = 1;
+        hashAlgorithm = HashAlgorithm::LegacyStdHash;
+        chunkThreshold = 0;
+        fanoutMigrationPending = false;
+        objectSourcePath.clear();
+        std::ifstream config(".minigit/config");
+        if (!config.is_open()) return;
+
+        std::string line;
+        while (std::getline(config, line)) {
+            size_t eqPos = line.find('=');
+            if (eqPos == std::string::npos) continue;
+            std::string key = line.substr(0, eqPos);
+            std::string value = line.substr(eqPos + 1);
+            if (key == "format_version") {
+                repoFormatVersion = std::atoi(value.c_str());
+            } else if (key == "hash" && !parseHashAlgorithm(value, hashAlgorithm)) {
+                std::cerr << "Warning: Unknown hash algorithm '" << value << "' in .minigit/config.\n";
+            } else if (key == "chunk_threshold") {
+                chunkThreshold = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (key == "fanout_migration") {
+                fanoutMigrationPending = value == "1";
+            } else if (key == "object_source") {
+                objectSourcePath = value;
+            }
+        }
+        if (repoFormatVersion > REPO_FORMAT_VERSION) {
+            std::cerr << "Warning: Repository format version " << repoFormatVersion
+                      << " is newer than this MiniGit supports (" << REPO_FORMAT_VERSION << ").\n";
+        }
+    }
+
+    void writeRepoConfig() {
+        std::string config = "format_version=" + std::to_string(repoFormatVersion) + "\n";
+        config += "hash=" + std::string(hashAlgorithmName(hashAlgorithm)) + "\n";
+        if (chunkThreshold > 0) {
+            config += "chunk_threshold=" + std::to_string(chunkThreshold) + "\n";
+        }
+        if (fanoutMigrationPending) {
+            config += "fanout_migration=1\n";
+        }
+        if (!objectSourcePath.empty()) {
+            config += "object_source=" + objectSourcePath + "\n";
+        }
+        if (!RefStore::writeFileAtomic(".minigit/config", config)) {
+            std::cerr << "Error: Could not write .minigit/config\n";
+        }
+    }
+
+    // --- Loose Object Store ---
+    // Loose objects (.minigit/objects) and commits (.minigit/commits) are one file per hash. From format 5 on
+    // they are sharded by the first two hex digits ("objects/ab/cdef..."), so no directory holds more than
+    // about 1/256 of the store; older formats keep them flat.
+
+    static constexpr size_t FANOUT_WIDTH = 2; // Hex digits of the fanout directory name
+
+    std::string storePath(const std::string& dir, const std::string& hash) const {
+        if (repoFormatVersion >= 5 && hash.size() > FANOUT_WIDTH) {
+            return dir + "/" + hash.substr(0, FANOUT_WIDTH) + "/" + hash.substr(FANOUT_WIDTH);
+        }
+        return dir + "/" + hash;
+    }
+
+    std::string objectPath(const std::string& hash) const { return storePath(".minigit/objects", hash); }
+    std::string commitFilePath(const std::string& hash) const { return storePath(".minigit/commits", hash); }
+
+    // Maps a loose object or commit file. While a fanout migration is pending it may still be at its flat path.
+    MappedFile openStoreFile(const std::string& dir, const std::string& hash) const {
+        MappedFile file(storePath(dir, hash));
+        if (!file.isOpen() && fanoutMigrationPending) file.open(dir + "/" + hash);
+        return file;
+    }
+
+    // Regular files only: a name of FANOUT_WIDTH characters or fewer would otherwise match a fanout directory.
+    bool storeFileExists(const std::string& dir, const std::string& hash) const {
+        std::error_code ec;
+        return fs::is_regular_file(storePath(dir, hash), ec) || (fanoutMigrationPending && fs::is_regular_file(dir + "/" + hash, ec));
+    }
+
+    // Hashes of every file in a store: flat files and files in two-character fanout directories.
+    static std::vector<std::string> listStore(const std::string& dir) {
+        std::vector<std::string> hashes;
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+            std::error_code typeEc;
+            std::string name = it->path().filename().string();
+            if (it->is_directory(typeEc)) {
+                if (name.size() != 2) continue; // objects/pack
+                std::error_code subEc;
+                for (auto sub = fs::directory_iterator(it->path(), subEc); !subEc && sub != fs::directory_iterator(); sub.increment(subEc)) {
+                    if (sub->is_regular_file(typeEc)) hashes.push_back(name + sub->path().filename().string());
+                }
+            } else if (it->is_regular_file(typeEc) && it->path().extension() != ".tmp") {
+                hashes.push_back(std::move(name));
+            }
+        }
+        return hashes;
+    }
+
+    // Moves the flat files of a store into fanout directories. Returns the number of files moved.
+    size_t moveToFanout(const std::string& dir) {
+        size_t moved = 0;
+        std::vector<std::string> flat;
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+            std::error_code typeEc;
+            if (it->is_regular_file(typeEc) && it->path().extension() != ".tmp") flat.push_back(it->path().filename().string());
+        }
+        for (const std::string& hash : flat) {
+            const std::string target = storePath(dir, hash);
+            fs::create_directories(fs::path(target).parent_path(), ec);
+            fs::rename(dir + "/" + hash, target, ec);
+            if (ec) {
+                std::cerr << "Error: Could not move " << dir << "/" << hash << ": " << ec.message() << "\n";
+                continue;
+            }
+            ++moved;
+        }
+        return moved;
+    }
+
+    // Finishes (or starts) the move to format 5. The pending move is recorded in .minigit/config first,
+    // so readers also try the flat paths until it is complete, and an interrupted run can simply be repeated.
+    size_t migrateToFanout() {
+        repoFormatVersion = std::max(repoFormatVersion, 5);
+        fanoutMigrationPending = true;
+        writeRepoConfig();
+        size_t moved = moveToFanout(".minigit/objects") + moveToFanout(".minigit/commits");
+        fanoutMigrationPending = false;
+        writeRepoConfig();
+        return moved;
+    }
+
+    // Reads the entire content of a (working-tree) file into a string.
+    std::string readFileContent(const std::string& filename) {
+        TRACE_SCOPE("readFileContent");
+        TRACE_COUNT(TraceCounter::FilesRead, 1);
+        std::string content;
+        if (!MappedFile::readChunked(filename, content)) {
+            // std::cerr << "Error: Could not open file for reading: " << filename << "\n"; // Suppress for status
+            return "";
+        }
+        return content;
+    }
+
+    // Stages content as a 'blob' file in the .minigit/objects directory (compressed from format 3 on).
+    // It is published by the next objectWriter.flush() (see ObjectWriter.hpp).
+    void saveBlob(const std::string& hash, std::string_view content) {
+        const std::string blobPath = objectPath(hash);
+        bool ok = repoFormatVersion >= 3 ? objectWriter.stage(blobPath, LOOSE_OBJECT_MAGIC, encodeEnvelope(content))
+                                         : objectWriter.stage(blobPath, "", content);
+        if (!ok) std::cerr << "Error: Could not save blob to " << blobPath << "\n";
+    }
+
+    // Stores a large blob as its content-defined chunks (see Chunker.hpp) plus a manifest under the
+    // blob's own hash: CHUNK_MANIFEST_MAGIC + envelope of "<chunk hash> <size>" lines.
+    // Chunks already in the object store are not written again, so revisions that change a small
+    // part of a large file only add the chunks covering the change.
+    // Safe to call from several threads: 'claim' (if given) is asked before a new chunk is written and must
+    // return true for only one caller per chunk hash; boundaries, hashing and writing run unlocked.
+    void saveChunkedBlob(const std::string& hash, std::string_view content,
+                         const std::function<bool(const std::string&)>& claim = nullptr) {
+        std::string manifest;
+        size_t start = 0;
+        for (size_t end : chunkBoundaries(content)) {
+            std::string_view chunk = content.substr(start, end - start);
+            std::string chunkHash = hashFileContent(chunk);
+            if (!hasObject(chunkHash) && (!claim || claim(chunkHash))) {
+                saveBlob(chunkHash, chunk);
+            }
+            manifest += chunkHash + " " + std::to_string(chunk.size()) + "\n";
+            start = end;
+        }
+        const std::string manifestPath = objectPath(hash);
+        if (!objectWriter.stage(manifestPath, CHUNK_MANIFEST_MAGIC, encodeEnvelope(manifest))) {
+            std::cerr << "Error: Could not save blob to " << manifestPath << "\n";
+        }
+    }
+
+    // Concatenates the chunks listed in a manifest. Returns false if a chunk is missing or has the wrong size.
+    bool assembleChunks(const std::string& manifest, std::string& content) {
+        std::istringstream lines(manifest);
+        std::string chunkHash;
+        size_t chunkSize = 0;
+        content.clear();
+        while (lines >> chunkHash >> chunkSize) {
+            MappedFile chunk = mapBlob(chunkHash);
+            if (!chunk.isOpen() || chunk.size() != chunkSize) return false;
+            content.append(chunk.data(), chunk.size());
+        }
+        return true;
+    }
+
+    // Opens every packfile in .minigit/objects/pack (once).
+    void loadPacks() {
+        if (packsLoaded) return;
+        packsLoaded = true;
+        if (!fs::exists(".minigit/objects/pack")) return;
+        for (const auto& entry : fs::directory_iterator(".minigit/objects/pack")) {
+            if (entry.path().extension() != ".idx") continue;
+            fs::path packPath = entry.path();
+            packPath.replace_extension(".pack");
+            auto pack = std::make_unique<PackFile>();
+            if (pack->open(packPath.string(), entry.path().string())) {
+                packs.push_back(std::move(pack));
+            } else {
+                std::cerr << "Warning: Ignoring unreadable pack " << entry.path() << "\n";
+            }
+        }
+    }
+
+    bool readPackedObject(const std::string& hash, std::string& content) {
+        loadPacks();
+        for (const auto& pack : packs) {
+            if (pack->read(hash, content)) return true;
+        }
+        return false;
+    }
+
+    // Prepares hasObject(): opens the packs and loads .minigit/object-filter. Without a usable filter the
+    // loose objects are listed once (one directory read instead of a stat per lookup) and a filter is
+    // built from the listing for the next process.
+    void loadObjectCache() {
+        if (objectCache.loaded) return;
+        objectCache.loaded = true;
+        loadPacks();
+        if (!objectCache.filter.load(OBJECT_FILTER_PATH)) rebuildObjectFilter();
+    }
+
+    // Lists every loose and packed object and writes a new filter sized for twice as many.
+    void rebuildObjectFilter() {
+        loadPacks();
+        objectCache.loose.clear();
+        for (std::string& name : listStore(".minigit/objects")) objectCache.loose.insert(std::move(name));
+        objectCache.listed = true;
+        std::vector<std::string> packed;
+        for (const auto& pack : packs) {
+            for (std::string& name : pack->names()) packed.push_back(std::move(name));
+        }
+        objectCache.filter.reset(2 * (objectCache.loose.size() + packed.size()));
+        for (const std::string& name : objectCache.loose) objectCache.filter.add(name);
+        for (const std::string& name : packed) objectCache.filter.add(name);
+        persistObjectFilter();
+    }
+
+    // Replaces OBJECT_FILTER_PATH with the filter if IDs were added (a failure only costs redundant writes later).
+    void persistObjectFilter() {
+        if (!objectCache.filter.isDirty()) return;
+        if (RefStore::writeFileAtomic(OBJECT_FILTER_PATH, objectCache.filter.serialize())) objectCache.filter.markClean();
+    }
+
+    // True if the object is stored loose or in a pack, or is staged to be written.
+    // Packs are searched in memory; a loose object is only stat'ed if the filter cannot rule it out.
+    // Thread-safe once loadObjectCache() has run.
+    bool hasObject(const std::string& hash) {
+        if (objectWriter.isStaged(objectPath(hash))) return true;
+        loadObjectCache();
+        if (objectCache.loose.count(hash)) return true;
+        for (const auto& pack : packs) {
+            if (pack->contains(hash)) return true;
+        }
+        if (objectCache.listed || !objectCache.filter.mayContain(hash)) return false;
+        return storeFileExists(".minigit/objects", hash);
+    }
+
+    // Publishes the staged objects (see ObjectWriter.hpp) and records the new ones in the object cache and filter.
+    bool flushObjects() {
+        TRACE_SCOPE("flushObjects");
+        std::vector<std::string> published;
+        bool ok = objectWriter.flush(&published);
+        if (published.empty()) return ok;
+        loadObjectCache();
+        const std::string objectsDir = ".minigit/objects/";
+        for (const std::string& path : published) {
+            if (path.compare(0, objectsDir.size(), objectsDir) != 0) continue; // Commit files are not objects
+            std::string name = path.substr(objectsDir.size());
+            name.erase(std::remove(name.begin(), name.end(), '/'), name.end()); // Fanout directory + file name
+            objectCache.filter.add(name);
+            objectCache.loose.insert(std::move(name));
+        }
+        if (objectCache.filter.size() > 2 * objectCache.filter.capacity()) {
+            rebuildObjectFilter(); // Saturated: false positives would send most lookups to the filesystem again
+        } else {
+            persistObjectFilter();
+        }
+        return ok;
+    }
+
+    // Maps a 'blob' file for zero-copy reading. Compressed and packed objects are decoded into memory.
+    // The result is not open if the blob does not exist.
+    MappedFile mapBlob(const std::string& hash) {
+        TRACE_SCOPE("loadBlob");
+        MappedFile blob = openBlob(hash);
+        if (blob.isOpen()) {
+            TRACE_COUNT(TraceCounter::BlobsLoaded, 1);
+            TRACE_COUNT(TraceCounter::BlobBytesLoaded, blob.size());
+        }
+        return blob;
+    }
+
+    // Loads 'hashes' in order on a thread pool, ahead of the caller (see BlobPrefetcher.hpp). Empty hashes yield
+    // empty files. Used where the blobs of a whole change set are known up front.
+    std::unique_ptr<BlobPrefetcher> prefetchBlobs(std::vector<std::string> hashes) {
+        loadPacks(); // Packs are opened here, not lazily from the worker threads
+        unsigned int threads = ThreadPool::resolveJobs(jobs);
+        if (!jobsGiven) threads = std::max(threads, PREFETCH_THREADS); // Reads wait on I/O, not on cores
+        return std::make_unique<BlobPrefetcher>([this](const std::string& hash) { return mapBlob(hash); },
+                                                std::move(hashes), threads, PREFETCH_WINDOW, PREFETCH_BYTES);
+    }
+
+    // mapBlob() without the instrumentation.
+    MappedFile openBlob(const std::string& hash) {
+        MappedFile loose = openStoreFile(".minigit/objects", hash);
+        if (loose.isOpen()) return decodeLooseObject(hash, std::move(loose));
+        std::string content;
+        if (readPackedObject(hash, content)) {
+            return MappedFile::fromBuffer(std::move(content));
+        }
+        return fetchObject(hash);
+    }
+
+    // The content of a stored loose object: raw, compressed (LOOSE_OBJECT_MAGIC) or a chunk manifest.
+    MappedFile decodeLooseObject(const std::string& hash, MappedFile loose) {
+        std::string_view magic = loose.view().substr(0, LOOSE_OBJECT_MAGIC.size());
+        if (repoFormatVersion < 3 || (magic != LOOSE_OBJECT_MAGIC && magic != CHUNK_MANIFEST_MAGIC)) {
+            // Stored raw: nothing in the file tells a truncated object from a complete one, but its name does
+            if (hashFileContent(loose.view()) == hash) return loose;
+            std::cerr << "Error: Object " << hash << " is corrupt (content does not match its hash).\n";
+            return MappedFile();
+        }
+        std::string content;
+        if (decodeEnvelope(loose.view().substr(magic.size()), content)) {
+            if (magic == LOOSE_OBJECT_MAGIC) return MappedFile::fromBuffer(std::move(content));
+            std::string assembled;
+            if (assembleChunks(content, assembled)) return MappedFile::fromBuffer(std::move(assembled));
+        }
+        std::cerr << "Error: Object " << hash << " is corrupt.\n";
+        return MappedFile();
+    }
+
+    // The object source of a partial clone, opened on first use; nullptr for complete repositories or if it
+    // cannot be opened. Thread-safe.
+    const ObjectSource* openObjectSource() {
+        if (objectSourcePath.empty()) return nullptr;
+        std::lock_guard<std::mutex> lock(objectSourceMutex);
+        if (!objectSource.isOpen() && !objectSourceFailed && !objectSource.open(objectSourcePath)) {
+            objectSourceFailed = true;
+            std::cerr << "Warning: Object source " << objectSourcePath << " is not available; objects this clone omitted cannot be fetched.\n";
+        }
+        return objectSource.isOpen() ? &objectSource : nullptr;
+    }
+
+    // Fetches an object a partial clone omitted from its object source. The stored file is kept as a loose object
+    // (published with the next flush, see ObjectWriter.hpp), so each object is fetched at most once per clone.
+    // Not open if there is no source or it does not have the object. Thread-safe (prefetch workers call it).
+    MappedFile fetchObject(const std::string& hash) {
+        const ObjectSource* source = openObjectSource();
+        if (!source) {
+            reportOmitted(hash);
+            return MappedFile();
+        }
+        TRACE_SCOPE("fetchObject");
+        MappedFile stored = source->looseObject(hash);
+        if (stored.isOpen()) {
+            // Kept as stored (chunk manifests stay manifests), unless this clone predates compressed objects
+            std::string copy(stored.view());
+            MappedFile object = decodeLooseObject(hash, std::move(stored));
+            if (!object.isOpen()) return object;
+            bool ok = repoFormatVersion >= 3 ? objectWriter.stage(objectPath(hash), "", copy)
+                                             : objectWriter.stage(objectPath(hash), "", object.view());
+            if (!ok) std::cerr << "Warning: Could not keep fetched object " << hash << "\n";
+            TRACE_COUNT(TraceCounter::ObjectsFetched, 1);
+            return object;
+        }
+        std::string content;
+        if (!source->packedObject(hash, content)) {
+            reportOmitted(hash);
+            return MappedFile();
+        }
+        saveBlob(hash, content);
+        TRACE_COUNT(TraceCounter::ObjectsFetched, 1);
+        return MappedFile::fromBuffer(std::move(content));
+    }
+
+    // A missing object is only an error worth naming if the clone left it out on purpose. Thread-safe.
+    void reportOmitted(const std::string& hash) {
+        if (objectSourcePath.empty()) return;
+        std::lock_guard<std::mutex> lock(objectSourceMutex);
+        if (!omittedLoaded) {
+            omittedLoaded = true;
+            std::ifstream in(OMITTED_PATH);
+            for (std::string line; std::getline(in, line);) {
+                if (!line.empty()) omittedIds.push_back(std::move(line));
+            }
+        }
+        if (std::binary_search(omittedIds.begin(), omittedIds.end(), hash)) {
+            std::cerr << "Error: Object " << hash.substr(0, 7) << " was omitted from this partial clone and " << objectSourcePath
+                      << " cannot provide it.\n";
+        }
+    }
+
+    // Reads content from a 'blob' file.
+    std::string loadBlob(const std::string& hash) {
+        MappedFile blob = mapBlob(hash);
+        if (!blob.isOpen()) {
+            // std::cerr << "Error: Could not load blob from " << hash << "\n"; // Suppress for cases where blob might not exist (e.g. initial diffs)
+            return "";
+        }
+        return std::string(blob.view());
+    }
+
+    // Stages commit metadata as a file in the .minigit/commits directory; it is published by the next
+    // objectWriter.flush(). Format 4 repositories use the binary CommitView encoding, older ones the
+    // line-based text format. Returns false if the file could not be written.
+    bool writeCommitToFile(const Commit& commit) {
+        const std::string commitPath = commitFilePath(commit.hash);
+        std::string encoded;
+        if (repoFormatVersion >= 4) {
+            std::vector<std::pair<std::string_view, std::string_view>> files; // Only commits without a tree carry a flat table
+            std::vector<std::string> blobs;
+            if (commit.treeHash.empty()) {
+                const FileTable& table = filesOf(commit);
+                blobs.reserve(table.size()); // No reallocation: 'files' keeps views into it
+                for (const auto& entry : table) {
+                    blobs.push_back(entry.blob.toString());
+                    files.emplace_back(table.path(entry), blobs.back());
+                }
+            }
+            encoded = CommitView::encode(commit.message, commit.timestamp, commit.treeHash, commit.parentHashes, files);
+        } else {
+            encoded = "message:" + commit.message + "\n";
+            encoded += "timestamp:" + commit.timestamp + "\n";
+            encoded += "parents:";
+            for (const auto& parent : commit.parentHashes) {
+                encoded += parent + " ";
+            }
+            encoded += "\n";
+            encoded += "tree:" + commit.treeHash + "\n";
+        }
+        if (!objectWriter.stage(commitPath, "", encoded)) {
+            std::cerr << "Error: Could not write commit to " << commitPath << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Loads a commit from its file representation (binary or text).
+    Commit loadCommitFromFile(const std::string& commitHash) {
+        TRACE_SCOPE("loadCommit");
+        TRACE_COUNT(TraceCounter::CommitsParsed, 1);
+        MappedFile file = openStoreFile(".minigit/commits", commitHash);
+        if (!file.isOpen()) file = fetchCommitFile(commitHash);
+        Commit c;
+        c.hash = commitHash;
+
+        if (!file.isOpen()) {
+            c.hash = ""; // Indicate failure
+            return c;
+        }
+
+        if (CommitView::isBinary(file.view())) {
+            CommitView view;
+            if (!view.parse(file.view())) {
+                std::cerr << "Warning: Commit " << commitHash.substr(0, 7) << " is corrupt.\n";
+                c.hash = "";
+                return c;
+            }
+            c.message = std::string(view.message);
+            c.timestamp = std::string(view.timestamp);
+            c.parentHashes.assign(view.parents.begin(), view.parents.end());
+            c.treeHash = std::string(view.tree);
+            if (c.treeHash.empty()) {
+                std::unordered_map<std::string, std::string> flat;
+                for (size_t i = 0; i < view.fileCount(); ++i) {
+                    std::string_view path, blob;
+                    if (view.file(i, path, blob)) flat.emplace(path, blob);
+                }
+                c.files = FileTable::build(flat, pathTable);
+            }
+            return c;
+        }
+
+        std::stringstream text{std::string(file.view())};
+        std::string line;
+        std::unordered_map<std::string, std::string> flat;
+        while (std::getline(text, line)) {
+            if (line.rfind("message:", 0) == 0) {
+                c.message = line.substr(8);
+            } else if (line.rfind("timestamp:", 0) == 0) {
+                c.timestamp = line.substr(10);
+            } else if (line.rfind("parents:", 0) == 0) {
+                std::string parentsStr = line.substr(8);
+                std::stringstream ss(parentsStr);
+                std::string parentHash;
+                while (ss >> parentHash) {
+                    c.parentHashes.push_back(parentHash);
+                }
+            } else if (line.rfind("tree:", 0) == 0) {
+                c.treeHash = line.substr(5);
+            } else if (line.rfind("files:", 0) == 0) { // Flat file table of commits made before tree objects
+                while (std::getline(text, line) && !line.empty()) {
+                    size_t colonPos = line.find(':');
+                    if (colonPos != std::string::npos) {
+                        std::string filename = line.substr(0, colonPos);
+                        std::string blobHash = line.substr(colonPos + 1);
+                        flat[filename] = blobHash;
+                    }
+                }
+            }
+        }
+        if (c.treeHash.empty()) c.files = FileTable::build(flat, pathTable);
+        return c;
+    }
+
+    // A commit file a partial clone omitted, from its object source; kept like a fetched object (see fetchObject()).
+    MappedFile fetchCommitFile(const std::string& commitHash) {
+        const ObjectSource* source = openObjectSource();
+        if (!source) return MappedFile();
+        MappedFile file = source->commitFile(commitHash);
+        if (file.isOpen() && !objectWriter.stage(commitFilePath(commitHash), "", file.view())) {
+            std::cerr << "Warning: Could not keep fetched commit " << commitHash << "\n";
+        }
+        return file;
+    }
+
+    // --- Tree Objects ---
+    // Stored in .minigit/objects like blobs, entries sorted by name: the binary TreeView encoding in format 4,
+    // one "<blob|tree> <hash> <name>" line per entry before that.
+    // Identical directories hash identically, so comparing two tree hashes tells whether anything below differs.
+
+    // Returns the parsed tree with the given hash (cached). An empty or missing hash yields an empty tree.
+    const Tree& loadTree(const std::string& treeHash) {
+        static const Tree emptyTree;
+        if (treeHash.empty()) return emptyTree;
+        auto it = trees.find(treeHash);
+        if (it != trees.end()) return it->second;
+
+        TRACE_SCOPE("loadTree");
+        TRACE_COUNT(TraceCounter::TreesParsed, 1);
+        Tree tree;
+        MappedFile object = mapBlob(treeHash);
+        if (!object.isOpen()) {
+            std::cerr << "Warning: Tree object " << treeHash.substr(0, 7) << " not found.\n";
+        }
+        if (TreeView::isBinary(object.view())) {
+            TreeView view;
+            if (!view.parse(object.view())) {
+                std::cerr << "Warning: Tree object " << treeHash.substr(0, 7) << " is corrupt.\n";
+            }
+            TreeView::Entry entry;
+            for (size_t i = 0; i < view.size() && view.entry(i, entry); ++i) {
+                tree.push_back({std::string(entry.name), std::string(entry.hash), entry.isTree});
+            }
+            return trees[treeHash] = std::move(tree);
+        }
+        std::stringstream ss{std::string(object.view())};
+        std::string line;
+        while (std::getline(ss, line)) {
+            size_t typeEnd = line.find(' ');
+            size_t hashEnd = typeEnd == std::string::npos ? std::string::npos : line.find(' ', typeEnd + 1);
+            if (hashEnd == std::string::npos) continue;
+            TreeEntry entry;
+            entry.isTree = line.compare(0, typeEnd, "tree") == 0;
+            entry.hash = line.substr(typeEnd + 1, hashEnd - typeEnd - 1);
+            entry.name = line.substr(hashEnd + 1);
+            tree.push_back(std::move(entry));
+        }
+        return trees[treeHash] = std::move(tree);
+    }
+
+    // Writes the tree objects for a flat path -> blob map, bottom-up, and returns the root tree hash.
+    // Subtrees that already exist in the object store (unchanged directories) are not rewritten.
+    std::string writeTree(const std::unordered_map<std::string, std::string>& files) {
+        std::map<std::string, std::string> sortedFiles(files.begin(), files.end());
+        return writeTreeLevel(sortedFiles, "");
+    }
+
+    std::string writeTreeLevel(const std::map<std::string, std::string>& files, const std::string& prefix) {
+        Tree tree;
+        std::map<std::string, std::map<std::string, std::string>> subdirs; // dir name -> files below it
+        auto it = files.lower_bound(prefix);
+        for (; it != files.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+            std::string rest = it->first.substr(prefix.size());
+            size_t slash = rest.find('/');
+            if (slash == std::string::npos) {
+                tree.push_back({rest, it->second, false});
+            } else {
+                subdirs[rest.substr(0, slash)].insert(*it);
+            }
+        }
+        for (const auto& [dirName, dirFiles] : subdirs) {
+            tree.push_back({dirName, writeTreeLevel(dirFiles, prefix + dirName + "/"), true});
+        }
+        std::sort(tree.begin(), tree.end(), [](const TreeEntry& a, const TreeEntry& b) { return a.name < b.name; });
+
+        std::string serialized;
+        if (repoFormatVersion >= 4) {
+            std::vector<TreeView::Entry> entries;
+            entries.reserve(tree.size());
+            for (const TreeEntry& entry : tree) entries.push_back({entry.isTree, entry.hash, entry.name});
+            serialized = TreeView::encode(entries);
+        } else {
+            for (const TreeEntry& entry : tree) {
+                serialized += (entry.isTree ? "tree " : "blob ") + entry.hash + " " + entry.name + "\n";
+            }
+        }
+        std::string treeHash = hashFileContent(serialized);
+        if (!hasObject(treeHash)) {
+            saveBlob(treeHash, serialized);
+        }
+        trees[treeHash] = std::move(tree);
+        return treeHash;
+    }
+
+    // Appends every file below 'treeHash' to 'out' as "<prefix><path>" -> blob hash.
+    void flattenTree(const std::string& treeHash, const std::string& prefix,
+                     std::unordered_map<std::string, std::string>& out) {
+        for (const TreeEntry& entry : loadTree(treeHash)) {
+            if (entry.isTree) {
+                flattenTree(entry.hash, prefix + entry.name + "/", out);
+            } else {
+                out[prefix + entry.name] = entry.hash;
+            }
+        }
+    }
+
+    // Returns the full path -> blob table of a commit. A tree is flattened once per process: every commit
+    // with the same root tree (reverts, merges, branches pointing at equal snapshots) shares its table.
+    const FileTable& filesOf(const Commit& commit) {
+        if (!commit.files) {
+            if (commit.treeHash.empty()) return FileTable::empty();
+            std::shared_ptr<const FileTable>& shared = fileTables[commit.treeHash];
+            if (!shared) {
+                std::unordered_map<std::string, std::string> flat;
+                flattenTree(commit.treeHash, "", flat);
+                shared = FileTable::build(flat, pathTable);
+            }
+            commit.files = shared;
+        }
+        return *commit.files;
+    }
+
+    // Lists the files that differ between two trees, sorted by path.
+    // Subtrees with equal hashes are skipped without being read, so the cost follows the size of the change.
+    void diffTrees(const std::string& oldTree, const std::string& newTree, const std::string& prefix,
+                   std::vector<FileChange>& out) {
+        if (oldTree == newTree) return;
+        const Tree& a = loadTree(oldTree);
+        const Tree& b = loadTree(newTree);
+        size_t i = 0, j = 0;
+        while (i < a.size() || j < b.size()) {
+            if (j >= b.size() || (i < a.size() && a[i].name < b[j].name)) { // Only in old
+                diffTreeEntry(&a[i], nullptr, prefix, out);
+                ++i;
+            } else if (i >= a.size() || b[j].name < a[i].name) { // Only in new
+                diffTreeEntry(nullptr, &b[j], prefix, out);
+                ++j;
+            } else { // In both
+                diffTreeEntry(&a[i], &b[j], prefix, out);
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    void diffTreeEntry(const TreeEntry* oldEntry, const TreeEntry* newEntry, const std::string& prefix,
+                       std::vector<FileChange>& out) {
+        const std::string& name = oldEntry ? oldEntry->name : newEntry->name;
+        std::string oldBlob = (oldEntry && !oldEntry->isTree) ? oldEntry->hash : "";
+        std::string newBlob = (newEntry && !newEntry->isTree) ? newEntry->hash : "";
+        if (oldBlob != newBlob) {
+            out.push_back({prefix + name, oldBlob, newBlob});
+        }
+        std::string oldSubtree = (oldEntry && oldEntry->isTree) ? oldEntry->hash : "";
+        std::string newSubtree = (newEntry && newEntry->isTree) ? newEntry->hash : "";
+        if (!oldSubtree.empty() || !newSubtree.empty()) {
+            diffTrees(oldSubtree, newSubtree, prefix + name + "/", out);
+        }
+    }
+
+    // Lists the files that differ between two commits (either may be null, meaning an empty snapshot).
+    std::vector<FileChange> diffCommits(const Commit* oldCommit, const Commit* newCommit) {
+        std::vector<FileChange> changes;
+        bool oldHasTree = !oldCommit || !oldCommit->treeHash.empty();
+        bool newHasTree = !newCommit || !newCommit->treeHash.empty();
+        if (oldHasTree && newHasTree) {
+            diffTrees(oldCommit ? oldCommit->treeHash : "", newCommit ? newCommit->treeHash : "", "", changes);
+            std::sort(changes.begin(), changes.end(),
+                      [](const FileChange& x, const FileChange& y) { return x.path < y.path; });
+            return changes;
+        }
+
+        // At least one side predates tree objects: merge-join the two sorted file tables.
+        const FileTable& oldFiles = oldCommit ? filesOf(*oldCommit) : FileTable::empty();
+        const FileTable& newFiles = newCommit ? filesOf(*newCommit) : FileTable::empty();
+        auto oldIt = oldFiles.begin(), newIt = newFiles.begin();
+        while (oldIt != oldFiles.end() || newIt != newFiles.end()) {
+            int order = oldIt == oldFiles.end() ? 1 : newIt == newFiles.end() ? -1
+                      : oldFiles.path(*oldIt).compare(newFiles.path(*newIt));
+            if (order < 0) {
+                changes.push_back({oldFiles.path(*oldIt), oldIt->blob.toString(), ""});
+                ++oldIt;
+            } else if (order > 0) {
+                changes.push_back({newFiles.path(*newIt), "", newIt->blob.toString()});
+                ++newIt;
+            } else {
+                if (oldIt->blob != newIt->blob) {
+                    changes.push_back({oldFiles.path(*oldIt), oldIt->blob.toString(), newIt->blob.toString()});
+                }
+                ++oldIt;
+                ++newIt;
+            }
+        }
+        return changes;
+    }
+
+    // --- Merge ---
+    // .minigit/MERGE_HEAD exists while a merge waits for its commit: the merged commit on the first line,
+    // then one line per path that still has conflicts. commit() records it as the second parent.
+    static constexpr const char* MERGE_HEAD_PATH = ".minigit/MERGE_HEAD";
+
+    bool readMergeHead(std::string& mergeHead, std::vector<std::string>& conflicts) {
+        conflicts.clear();
+        std::stringstream ss(readFileContent(MERGE_HEAD_PATH));
+        if (!std::getline(ss, mergeHead) || mergeHead.empty()) return false;
+        std::string path;
+        while (std::getline(ss, path)) {
+            if (!path.empty()) conflicts.push_back(path);
+        }
+        return true;
+    }
+
+    // Newest common ancestor of two commits, or "" if their histories are disjoint.
+    // Commits are visited in decreasing generation order, so every descendant of a commit is popped
+    // before it: the first commit reached from both sides is a best common ancestor, and nothing
+    // below its generation is ever read. Without a graph entry (generation 0) the order falls back to timestamps.
+    std::string mergeBase(const std::string& a, const std::string& b) {
+        uint32_t position;
+        if (!commitGraph.find(a, position) || !commitGraph.find(b, position)) {
+            writeCommitGraph(allCommitGraphEntries()); // e.g. commits made by an older MiniGit
+        }
+        struct Node {
+            uint32_t generation;
+            int64_t timestamp;
+            std::string hash;
+            bool operator<(const Node& other) const {
+                if (generation != other.generation) return generation < other.generation;
+                return timestamp < other.timestamp;
+            }
+        };
+        std::priority_queue<Node> queue;
+        std::unordered_map<std::string, int> reachedFrom; // hash -> 1 (from a) | 2 (from b)
+        auto push = [&](const std::string& hash, int side) {
+            int& flags = reachedFrom[hash];
+            bool queued = flags != 0;
+            flags |= side;
+            if (queued) return; // Flags of queued commits are read when they are popped
+            std::vector<std::string> parents;
+            Node node{0, 0, hash};
+            if (commitNode(hash, parents, node.timestamp, node.generation)) queue.push(std::move(node));
+        };
+        push(a, 1);
+        push(b, 2);
+        while (!queue.empty()) {
+            Node node = queue.top();
+            queue.pop();
+            int flags = reachedFrom[node.hash];
+            if (flags == 3) return node.hash;
+            std::vector<std::string> parents;
+            int64_t timestamp;
+            uint32_t generation;
+            if (!commitNode(node.hash, parents, timestamp, generation)) continue;
+            for (const std::string& parent : parents) push(parent, flags);
+        }
+        return "";
+    }
+
+    // One path the other side changed: blobs on the base, our and their side ("" = absent).
+    // base == ours means only they changed it.
+    struct MergeChange {
+        std::string path;
+        std::string base;
+        std::string ours;
+        std::string theirs;
+    };
+
+    static void addMergeChange(const std::string& path, const std::string& base, const std::string& ours,
+                               const std::string& theirs, std::vector<MergeChange>& out) {
+        if (ours == theirs || base == theirs) return; // Nothing to take from their side
+        out.push_back({path, base, ours, theirs});
+    }
+
+    // Lists the paths their side changed relative to the base, sorted by path (base may be null).
+    std::vector<MergeChange> mergeChanges(const Commit* base, const Commit& ours, const Commit& theirs) {
+        std::vector<MergeChange> changes;
+        if ((!base || !base->treeHash.empty()) && !ours.treeHash.empty() && !theirs.treeHash.empty()) {
+            mergeTrees(base ? base->treeHash : "", ours.treeHash, theirs.treeHash, "", changes);
+        } else { // A side predates tree objects: compare the flat file maps
+            const FileTable& baseFiles = base ? filesOf(*base) : FileTable::empty();
+            const FileTable& ourFiles = filesOf(ours);
+            const FileTable& theirFiles = filesOf(theirs);
+            std::set<std::string> paths;
+            for (const FileTable* files : {&baseFiles, &ourFiles, &theirFiles}) {
+                for (const auto& entry : *files) paths.insert(files->path(entry));
+            }
+            for (const std::string& path : paths) {
+                addMergeChange(path, baseFiles.blob(path), ourFiles.blob(path), theirFiles.blob(path), changes);
+            }
+        }
+        std::sort(changes.begin(), changes.end(), [](const MergeChange& x, const MergeChange& y) { return x.path < y.path; });
+        return changes;
+    }
+
+    // Three-way walk of the base, our and their trees. A subtree whose hash is equal on their side and
+    // on the base (or on ours) is skipped unread, and a subtree only they changed is a plain diffTrees(),
+    // so the cost follows the size of their changes, not the size of the tree.
+    void mergeTrees(const std::string& base, const std::string& ours, const std::string& theirs,
+                    const std::string& prefix, std::vector<MergeChange>& out) {
+        if (ours == theirs || base == theirs) return;
+        if (base == ours) { // Only they changed anything below here
+            std::vector<FileChange> theirChanges;
+            diffTrees(ours, theirs, prefix, theirChanges);
+            for (const FileChange& change : theirChanges) out.push_back({change.path, change.oldBlob, change.oldBlob, change.newBlob});
+            return;
+        }
+        const Tree* sides[3] = {&loadTree(base), &loadTree(ours), &loadTree(theirs)};
+        std::set<std::string> names;
+        for (const Tree* tree : sides) {
+            for (const TreeEntry& entry : *tree) names.insert(entry.name);
+        }
+        for (const std::string& name : names) {
+            std::string blobs[3], subtrees[3];
+            for (int side = 0; side < 3; ++side) {
+                const Tree& tree = *sides[side];
+                auto it = std::lower_bound(tree.begin(), tree.end(), name,
+                                           [](const TreeEntry& entry, const std::string& key) { return entry.name < key; });
+                if (it == tree.end() || it->name != name) continue;
+                (it->isTree ? subtrees : blobs)[side] = it->hash;
+            }
+            addMergeChange(prefix + name, blobs[0], blobs[1], blobs[2], out);
+            if (!subtrees[0].empty() || !subtrees[1].empty() || !subtrees[2].empty()) {
+                mergeTrees(subtrees[0], subtrees[1], subtrees[2], prefix + name + "/", out);
+            }
+        }
+    }
+
+    // Writes a merge result to the working directory and records its stat data. Returns false on failure.
+    bool writeMergedFile(const std::string& path, std::string_view content, const std::string& blobHash) {
+        std::error_code ec;
+        fs::path parent = fs::path(path).parent_path();
+        if (!parent.empty()) fs::create_directories(parent, ec);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        out.close();
+        if (!out) return false;
+        IndexEntry entry;
+        if (!blobHash.empty() && statFile(path, entry)) {
+            entry.blobHash = blobHash;
+            rememberStat(path, entry);
+        }
+        return true;
+    }
+
+    // Persist current branch state to its ref and update HEAD. Both files are replaced atomically.
+    void saveHeadAndBranchRefs() {
+        // Save current branch's commit hash
+        if (!headBranch.empty() && !headCommitHash.empty()) { // Only save if on a branch and points to a commit
+            RefStore::Transaction refs = refStore.transaction();
+            refs.update(headBranch, headCommitHash);
+            if (!refs.commit()) {
+                std::cerr << "Error: Could not save branch ref for " << headBranch << "\n";
+                return;
+            }
+        }
+
+        // Update .minigit/HEAD
+        std::string head = headBranch.empty() ? headCommitHash + "\n" : "ref: refs/heads/" + headBranch + "\n"; // Detached or on a branch
+        if (readFileContent(".minigit/HEAD") == head) return; // Unchanged (e.g. a commit on the current branch): no rewrite, no fsync
+        if (!RefStore::writeFileAtomic(".minigit/HEAD", head)) {
+            std::cerr << "Error: Could not save HEAD file.\n";
+        }
+    }
+
+    // Load branch state from HEAD file and all branch refs.
+    void loadRepoState() {
+        TRACE_SCOPE("loadRepoState");
+        loadRepoConfig();
+
+        // Load HEAD
+        std::ifstream headFile(".minigit/HEAD");
+        if (headFile.is_open()) {
+            std::string line;
+            std::getline(headFile, line);
+            if (line.rfind("ref: refs/heads/", 0) == 0) {
+                headBranch = line.substr(16); // Its commit is looked up once the refs are loaded
+            } else {
+                // Detached HEAD state
+                headBranch = ""; // Indicate detached HEAD
+                headCommitHash = line;
+            }
+            headFile.close();
+        } else {
+            // No HEAD file (first init case)
+            headBranch = "master";
+            headCommitHash = "";
+        }
+
+        // Commits are no longer loaded here: they are parsed on demand by findCommit(),
+        // so startup cost only depends on the number of refs, not on history length.
+        commits.clear();
+
+        // Load all branch refs: packed-refs in one read, then the (few) loose refs on top
+        branches = refStore.load();
+        if (!headBranch.empty()) {
+            auto head = branches.find(headBranch);
+            headCommitHash = head == branches.end() ? "" : head->second; // Empty: branch has no commits yet
+        }
+        commitGraph.open(".minigit/commit-graph"); // Optional: missing in repositories that never committed
+        shallowCommits.clear();
+        std::ifstream shallow(SHALLOW_PATH); // Only shallow clones have one
+        for (std::string line; std::getline(shallow, line);) {
+            if (!line.empty()) shallowCommits.insert(line);
+        }
+
+        // Restore the staging area and stat-cache saved by the previous command
+        loadIndex();
+    }
+
+    // --- Commit Graph (.minigit/commit-graph, see CommitGraph.hpp) ---
+
+    // Parses a commit timestamp ("YYYY-MM-DD HH:MM:SS", local time) into seconds since the epoch.
+    static int64_t parseTimestamp(const std::string& timestamp) {
+        std::tm tm = {};
+        std::istringstream ss(timestamp);
+        ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+        if (ss.fail()) return 0;
+        tm.tm_isdst = -1;
+        return static_cast<int64_t>(std::mktime(&tm));
+    }
+
+    // Graph entries for every commit file (used when the graph is missing or incomplete).
+    std::vector<CommitGraph::Entry> allCommitGraphEntries() {
+        std::vector<CommitGraph::Entry> entries;
+        for (const std::string& hash : listStore(".minigit/commits")) {
+            const Commit* c = findCommit(hash);
+            if (!c) continue;
+            entries.push_back({c->hash, c->parentHashes, parseTimestamp(c->timestamp)});
+            if (isShallow(hash)) entries.back().parents.clear(); // Even if a parent was fetched since
+        }
+        return entries;
+    }
+
+    void writeCommitGraph(std::vector<CommitGraph::Entry> entries) {
+        commitGraph.close(); // Unmap before the file is replaced
+        if (!CommitGraph::write(".minigit/commit-graph", std::move(entries))) {
+            std::cerr << "Warning: Could not write .minigit/commit-graph\n";
+        }
+        commitGraph.open(".minigit/commit-graph");
+    }
+
+    // Adds a new commit to the graph by appending it to the graph's tail; gc folds the tail into the main file.
+    // The graph is rebuilt from the commit files when it is missing
+    // or does not know one of the parents (e.g. commits made by an older MiniGit).
+    void addToCommitGraph(const Commit& newCommit) {
+        bool complete = commitGraph.isOpen();
+        for (const std::string& parent : newCommit.parentHashes) {
+            uint32_t position;
+            if (!commitGraph.find(parent, position)) complete = false;
+        }
+        CommitGraph::Entry entry{newCommit.hash, newCommit.parentHashes, parseTimestamp(newCommit.timestamp)};
+        if (complete && commitGraph.append(entry)) return;
+        std::vector<CommitGraph::Entry> entries = allCommitGraphEntries();
+        entries.push_back(std::move(entry));
+        writeCommitGraph(std::move(entries));
+    }
+
+    // True for the boundary commits of a shallow clone: history walks treat them as root commits.
+    bool isShallow(const std::string& hash) const { return !shallowCommits.empty() && shallowCommits.count(hash) != 0; }
+
+    // Parents, timestamp and generation of a commit: from the graph when it has the commit,
+    // otherwise from the commit file (generation 0 = unknown). Returns false if the commit does not exist.
+    // The boundary commits of a shallow clone have no parents.
+    bool commitNode(const std::string& hash, std::vector<std::string>& parents, int64_t& timestamp, uint32_t& generation) {
+        uint32_t position;
+        if (commitGraph.find(hash, position)) {
+            parents.clear();
+            for (uint32_t parent : commitGraph.parents(position)) parents.emplace_back(commitGraph.id(parent));
+            timestamp = commitGraph.timestamp(position);
+            generation = commitGraph.generation(position);
+            return true;
+        }
+        const Commit* c = findCommit(hash);
+        if (!c) return false;
+        parents = c->parentHashes;
+        if (isShallow(hash)) parents.clear();
+        timestamp = parseTimestamp(c->timestamp);
+        generation = 0;
+        return true;
+    }
+
+    // --- Index (.minigit/index) ---
+    // Binary layout, little-endian (writeLE()/readLE(), see Encoding.hpp):
+    //   "MGIX" | u32 version | u32 entryCount
+    //   entry: u16 pathLen, path | u8 len, staged hash (empty if not staged) | u8 len, cached hash
+    //          | i64 mtime (ns) | u64 size | u64 inode
+    static constexpr uint32_t INDEX_VERSION = 1;
+
+    static bool readBytes(std::istream& in, std::string& out, size_t length) {
+        out.resize(length);
+        return length == 0 || static_cast<bool>(in.read(&out[0], static_cast<std::streamsize>(length)));
+    }
+
+    void loadIndex() {
+        TRACE_SCOPE("loadIndex");
+        stagingArea.clear();
+        statCache.clear();
+        indexDirty = false;
+
+        std::ifstream in(".minigit/index", std::ios::binary);
+        if (!in.is_open()) return; // No index yet: nothing staged
+
+        std::string magic;
+        uint64_t version = 0, count = 0;
+        if (!readBytes(in, magic, 4) || magic != "MGIX" || !readLE(in, version, 4) || version != INDEX_VERSION ||
+            !readLE(in, count, 4)) {
+            std::cerr << "Warning: Ignoring unreadable index file .minigit/index.\n";
+            return;
+        }
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t pathLen = 0, stagedLen = 0, cachedLen = 0, mtime = 0;
+            std::string path, stagedHash;
+            IndexEntry entry;
+            if (!readLE(in, pathLen, 2) || !readBytes(in, path, pathLen) ||
+                !readLE(in, stagedLen, 1) || !readBytes(in, stagedHash, stagedLen) ||
+                !readLE(in, cachedLen, 1) || !readBytes(in, entry.blobHash, cachedLen) ||
+                !readLE(in, mtime, 8) || !readLE(in, entry.size, 8) || !readLE(in, entry.inode, 8)) {
+                std::cerr << "Warning: Index file .minigit/index is truncated.\n";
+                break;
+            }
+            entry.mtimeNs = static_cast<int64_t>(mtime);
+            if (!stagedHash.empty()) stagingArea[path] = stagedHash;
+            if (!entry.blobHash.empty()) statCache[path] = entry;
+        }
+    }
+
+    // Writes the staging area and stat-cache to .minigit/index (via a temp file so a crash never leaves half an index).
+    void writeIndex() {
+        TRACE_SCOPE("writeIndex");
+        std::set<std::string> paths; // Sorted for a deterministic file
+        for (const auto& pair : stagingArea) paths.insert(pair.first);
+        for (const auto& pair : statCache) paths.insert(pair.first);
+
+        const std::string tmpPath = ".minigit/index.tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                std::cerr << "Error: Could not write index file.\n";
+                return;
+            }
+            out.write("MGIX", 4);
+            writeLE(out, INDEX_VERSION, 4);
+            writeLE(out, paths.size(), 4);
+            for (const std::string& path : paths) {
+                auto staged = stagingArea.find(path);
+                auto cached = statCache.find(path);
+                const std::string stagedHash = staged != stagingArea.end() ? staged->second : "";
+                const IndexEntry entry = cached != statCache.end() ? cached->second : IndexEntry{};
+                writeLE(out, path.size(), 2);
+                out.write(path.data(), static_cast<std::streamsize>(path.size()));
+                writeLE(out, stagedHash.size(), 1);
+                out.write(stagedHash.data(), static_cast<std::streamsize>(stagedHash.size()));
+                writeLE(out, entry.blobHash.size(), 1);
+                out.write(entry.blobHash.data(), static_cast<std::streamsize>(entry.blobHash.size()));
+                writeLE(out, static_cast<uint64_t>(entry.mtimeNs), 8);
+                writeLE(out, entry.size, 8);
+                writeLE(out, entry.inode, 8);
+            }
+            if (!out) {
+                std::cerr << "Error: Could not write index file.\n";
+                return;
+            }
+        }
+        std::error_code ec;
+        fs::rename(tmpPath, ".minigit/index", ec);
+        if (ec) {
+            std::cerr << "Error: Could not replace index file: " << ec.message() << "\n";
+            return;
+        }
+        indexDirty = false;
+    }
+
+    void saveIndexIfDirty() {
+        if (indexDirty) writeIndex();
+    }
+
+    // Reads the stat data used by the stat-cache. Returns false if the file cannot be stat'ed.
+    static bool statFile(const std::string& filename, IndexEntry& entry) {
+        TRACE_COUNT(TraceCounter::FilesStated, 1);
+#ifndef _WIN32
+        struct stat st;
+        if (::stat(filename.c_str(), &st) != 0) return false;
+#ifdef __APPLE__
+        entry.mtimeNs = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+        entry.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+        entry.size = static_cast<uint64_t>(st.st_size);
+        entry.inode = static_cast<uint64_t>(st.st_ino);
+#else
+        std::error_code ec;
+        auto size = fs::file_size(filename, ec);
+        if (ec) return false;
+        auto mtime = fs::last_write_time(filename, ec);
+        if (ec) return false;
+        entry.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+        entry.size = static_cast<uint64_t>(size);
+        entry.inode = 0; // Not available through std::filesystem
+#endif
+        return true;
+    }
+
+    // True if 'current' stat data matches the cached entry for 'filename' (so its cached hash is still valid).
+    bool statCacheHit(const std::string& filename, const IndexEntry& current) const {
+        auto it = statCache.find(filename);
+        return it != statCache.end() && it->second.mtimeNs == current.mtimeNs &&
+               it->second.size == current.size && it->second.inode == current.inode;
+    }
+
+    // Returns the content hash of a working directory file, reusing the stat-cache when the file is unchanged.
+    std::string hashWorkingFile(const std::string& filename) {
+        IndexEntry current;
+        if (!statFile(filename, current)) {
+            return hashFile(filename);
+        }
+        if (statCacheHit(filename, current)) {
+            return statCache.at(filename).blobHash;
+        }
+        current.blobHash = hashFile(filename);
+        rememberStat(filename, current);
+        return current.blobHash;
+    }
+
+    // Hashes many working directory files on 'jobs' threads; result i is the hash of filenames[i].
+    // Workers only read the stat-cache; new entries are recorded afterwards in input order,
+    // so the index and all output are identical to a serial scan.
+    std::vector<std::string> hashWorkingFiles(const std::vector<std::string>& filenames) {
+        if (workingTree.enabled) { // Only files changed since they were last hashed are read
+            // Ignored directories are not watched, so tracked files in them are always stat'ed (and never cached)
+            const IgnoreRules& rules = ignoreRules();
+            std::vector<bool> watched(filenames.size(), true);
+            std::vector<std::string> hashes(filenames.size()), stale;
+            std::vector<size_t> stalePositions;
+            for (size_t i = 0; i < filenames.size(); ++i) {
+                if (!rules.empty()) watched[i] = !rules.excluded(filenames[i], false);
+                auto it = watched[i] ? workingTree.hashes.find(filenames[i]) : workingTree.hashes.end();
+                if (it != workingTree.hashes.end()) {
+                    hashes[i] = it->second;
+                } else {
+                    stale.push_back(filenames[i]);
+                    stalePositions.push_back(i);
+                }
+            }
+            std::vector<std::string> fresh = scanWorkingFiles(stale);
+            for (size_t k = 0; k < stale.size(); ++k) {
+                if (watched[stalePositions[k]]) workingTree.hashes[stale[k]] = fresh[k];
+                hashes[stalePositions[k]] = std::move(fresh[k]);
+            }
+            return hashes;
+        }
+        return scanWorkingFiles(filenames);
+    }
+
+    std::vector<std::string> scanWorkingFiles(const std::vector<std::string>& filenames) {
+        TRACE_SCOPE("scanWorkingFiles");
+        struct ScanResult {
+            IndexEntry stat;
+            bool statOk = false;
+            bool cached = false;
+        };
+        std::vector<ScanResult> results(filenames.size());
+        ThreadPool::parallelFor(filenames.size(), jobs, [&](size_t i) {
+            ScanResult& result = results[i];
+            result.statOk = statFile(filenames[i], result.stat);
+            if (result.statOk && statCacheHit(filenames[i], result.stat)) {
+                result.stat.blobHash = statCache.at(filenames[i]).blobHash;
+                result.cached = true;
+            } else {
+                result.stat.blobHash = hashFile(filenames[i]);
+            }
+        });
+
+        std::vector<std::string> hashes;
+        hashes.reserve(filenames.size());
+        for (size_t i = 0; i < filenames.size(); ++i) {
+            if (results[i].statOk && !results[i].cached) {
+                rememberStat(filenames[i], results[i].stat);
+            }
+            hashes.push_back(std::move(results[i].stat.blobHash));
+        }
+        return hashes;
+    }
+
+    // Lists the regular files of the working tree as '/'-separated paths relative to the repository root,
+    // in directory order. Hidden files and directories (including .minigit) and paths matched by .minigitignore
+    // are skipped and never descended into; tracked files are listed even if they are ignored.
+    // With the working-tree cache enabled the listing is sorted and only dirty paths are re-examined.
+    std::vector<std::string> listWorkingFiles() {
+        std::vector<std::string> files;
+        if (workingTree.enabled) {
+            refreshWorkingTree();
+            files.assign(workingTree.files.begin(), workingTree.files.end());
+        } else {
+            files = walkWorkingFiles(".");
+        }
+        const IgnoreRules& rules = ignoreRules();
+        if (rules.empty()) return files;
+        auto addIfIgnored = [&](const std::string& path) {
+            std::error_code ec;
+            if (rules.excluded(path, false) && fs::is_regular_file(path, ec)) files.push_back(path);
+        };
+        const Commit* headCommit = findCommit(headCommitHash);
+        if (headCommit) {
+            const FileTable& tracked = filesOf(*headCommit);
+            for (const auto& entry : tracked) addIfIgnored(tracked.path(entry));
+        }
+        for (const auto& [path, blob] : stagingArea) {
+            if (!headCommit || !filesOf(*headCommit).contains(path)) addIfIgnored(path);
+        }
+        return files;
+    }
+
+    // Lists the regular files below 'dir' (see listWorkingFiles()); nothing if 'dir' itself is ignored.
+    std::vector<std::string> walkWorkingFiles(const std::string& dir) {
+        TRACE_SCOPE("walkWorkingFiles");
+        std::vector<std::string> files;
+        const IgnoreRules& rules = ignoreRules();
+        if (dir != "." && rules.excluded(fs::path(dir).lexically_normal().generic_string(), true)) return files;
+        for (auto it = fs::recursive_directory_iterator(dir); it != fs::recursive_directory_iterator(); ++it) {
+            TRACE_COUNT(TraceCounter::DirectoryEntries, 1);
+            std::string filename = it->path().filename().string();
+            if (filename[0] == '.') {
+                if (it->is_directory()) it.disable_recursion_pending();
+                continue;
+            }
+            const bool isDirectory = it->is_directory();
+            if (!isDirectory && !it->is_regular_file()) continue;
+            std::string path = it->path().lexically_relative(".").generic_string();
+            if (rules.ignored(path, isDirectory)) { // Parents were checked before they were entered
+                if (isDirectory) it.disable_recursion_pending();
+                continue;
+            }
+            if (!isDirectory) files.push_back(std::move(path));
+        }
+        return files;
+    }
+
+    // The compiled .minigitignore rules. The file is stat'ed on every call and re-read when it changed;
+    // a change also invalidates the working-tree cache, whose listing depends on the rules.
+    const IgnoreRules& ignoreRules() {
+        IndexEntry current;
+        if (!statFile(IGNORE_PATH, current)) current = IndexEntry{};
+        if (ignore.loaded && current.mtimeNs == ignore.stat.mtimeNs && current.size == ignore.stat.size &&
+            current.inode == ignore.stat.inode) {
+            return ignore.rules;
+        }
+        ignore.rules.load(IGNORE_PATH); // No file: no rules
+        if (ignore.loaded) workingTree.valid = false;
+        ignore.stat = current;
+        ignore.loaded = true;
+        return ignore.rules;
+    }
+
+    // Brings the working-tree cache up to date: a full walk the first time, afterwards only the dirty paths.
+    // Dirty paths that are ignored only drop their cached hashes (they may be tracked files, see listWorkingFiles()).
+    void refreshWorkingTree() {
+        const IgnoreRules& rules = ignoreRules(); // May invalidate the cache
+        if (!workingTree.valid) {
+            std::vector<std::string> files = walkWorkingFiles(".");
+            workingTree.files = std::set<std::string>(files.begin(), files.end());
+            workingTree.hashes.clear();
+            workingTree.dirty.clear();
+            workingTree.valid = true;
+            return;
+        }
+        for (const std::string& path : workingTree.dirty) {
+            // Whatever was at or below 'path' is forgotten, then whatever is there now is added back
+            workingTree.hashes.erase(path);
+            workingTree.files.erase(path);
+            const std::string prefix = path + "/";
+            for (auto it = workingTree.files.lower_bound(prefix);
+                 it != workingTree.files.end() && it->compare(0, prefix.size(), prefix) == 0;) {
+                workingTree.hashes.erase(*it);
+                it = workingTree.files.erase(it);
+            }
+            std::error_code ec;
+            if (rules.excluded(path, fs::is_directory(path, ec))) continue;
+            if (fs::is_regular_file(path, ec)) {
+                workingTree.files.insert(path);
+            } else if (fs::is_directory(path, ec)) {
+                for (const std::string& file : walkWorkingFiles(path)) workingTree.files.insert(file);
+            }
+        }
+        workingTree.dirty.clear();
+    }
+
+    // Normalizes a user-supplied path to the form used in commits ("dir/file.txt").
+    // Returns an empty string for paths outside the working tree or inside .minigit.
+    static std::string normalizeRepoPath(const std::string& path) {
+        std::string normalized = fs::path(path).lexically_normal().generic_string();
+        if (normalized.rfind("./", 0) == 0) normalized = normalized.substr(2);
+        if (normalized.empty() || normalized == "." || normalized.rfind("..", 0) == 0 ||
+            fs::path(normalized).is_absolute() || normalized == ".minigit" || normalized.rfind(".minigit/", 0) == 0) {
+            return "";
+        }
+        return normalized;
+    }
+
+    static bool isGlobPattern(const std::string& pathspec) {
+        return pathspec.find_first_of("*?[") != std::string::npos;
+    }
+
+    // Matches a path against a glob: '*' matches any run of characters (including '/'), '?' one character
+    // and '[...]' one character of a set ("[a-z]", "[!0-9]"). Backtracks to the last '*' only, so it is linear
+    // in practice.
+    static bool globMatch(std::string_view pattern, std::string_view path) {
+        size_t p = 0, s = 0, starP = std::string_view::npos, starS = 0;
+        while (s < path.size()) {
+            if (p < pattern.size() && pattern[p] == '*') {
+                starP = p++;
+                starS = s;
+                continue;
+            }
+            if (p < pattern.size() && matchGlobChar(pattern, p, path[s])) {
+                ++s;
+                continue;
+            }
+            if (starP == std::string_view::npos) return false;
+            p = starP + 1; // Let the last '*' absorb one more character
+            s = ++starS;
+        }
+        while (p < pattern.size() && pattern[p] == '*') ++p;
+        return p == pattern.size();
+    }
+
+    // Matches one character at pattern[p] ('?', a '[...]' set or a literal) and advances p past it.
+    static bool matchGlobChar(std::string_view pattern, size_t& p, char c) {
+        if (pattern[p] == '?') {
+            ++p;
+            return true;
+        }
+        if (pattern[p] == '[') {
+            size_t i = p + 1;
+            bool negate = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+            if (negate) ++i;
+            size_t end = pattern.find(']', i + 1); // A ']' first in the set is a member, not the end
+            if (end != std::string_view::npos) {
+                bool member = false;
+                for (; i < end; ++i) {
+                    if (i + 2 < end && pattern[i + 1] == '-') {
+                        member = member || (c >= pattern[i] && c <= pattern[i + 2]);
+                        i += 2;
+                    } else {
+                        member = member || c == pattern[i];
+                    }
+                }
+                if (member == negate) return false;
+                p = end + 1;
+                return true;
+            }
+        }
+        return pattern[p++] == c;
+    }
+
+    // Expands 'add' pathspecs into the sorted, de-duplicated list of files to stage.
+    // Prints an error and returns false if a pathspec is outside the repository or matches nothing.
+    bool expandPathspecs(const std::vector<std::string>& pathspecs, std::vector<std::string>& files) {
+        std::set<std::string> matched;
+        std::vector<std::string> workingFiles;
+        bool listed = false;
+        // Directories and globs expand over the listing, which keeps tracked files that are now ignored
+        auto listing = [&]() -> const std::vector<std::string>& {
+            if (!listed) {
+                workingFiles = listWorkingFiles();
+                listed = true;
+            }
+            return workingFiles;
+        };
+        for (const std::string& pathspec : pathspecs) {
+            const bool root = fs::path(pathspec).lexically_normal() == "." || fs::path(pathspec).lexically_normal() == "./";
+            const std::string filename = root ? "" : normalizeRepoPath(pathspec);
+            if (!root && filename.empty()) {
+                std::cout << "Error: Path is outside the repository: " << pathspec << "\n";
+                return false;
+            }
+            std::error_code ec;
+            if (root || fs::is_directory(filename, ec)) {
+                std::string prefix = root ? "" : filename;
+                if (!prefix.empty() && prefix.back() != '/') prefix += '/';
+                for (const std::string& file : listing()) {
+                    if (file.compare(0, prefix.size(), prefix) == 0) matched.insert(file);
+                }
+            } else if (fs::is_regular_file(filename, ec)) {
+                matched.insert(filename);
+            } else if (fs::exists(filename, ec)) {
+                std::cout << "Error: Not a regular file: " << filename << "\n";
+                return false;
+            } else if (isGlobPattern(filename)) {
+                bool any = false;
+                for (const std::string& file : listing()) {
+                    if (globMatch(filename, file)) {
+                        matched.insert(file);
+                        any = true;
+                    }
+                }
+                if (!any) {
+                    std::cout << "Error: Pathspec '" << pathspec << "' did not match any files\n";
+                    return false;
+                }
+            } else {
+                std::cout << "Error: File does not exist: " << filename << "\n";
+                return false;
+            }
+        }
+        files.assign(matched.begin(), matched.end());
+        return true;
+    }
+
+    // Removes the now-empty parent directories of a deleted file, up to the repository root.
+    static void removeEmptyParents(const std::string& path) {
+        std::error_code ec;
+        for (fs::path dir = fs::path(path).parent_path(); !dir.empty(); dir = dir.parent_path()) {
+            if (!fs::is_directory(dir, ec) || !fs::is_empty(dir, ec) || !fs::remove(dir, ec)) break;
+        }
+    }
+
+    static constexpr int64_t FINE_RACY_WINDOW_NS = 20000000; // 20 ms
+
+    static int64_t racyWindowNs(const IndexEntry& entry) {
+        return entry.mtimeNs % 1000000000LL != 0 ? FINE_RACY_WINDOW_NS : 1000000000LL;
+    }
+
+    // Now, in the epoch and unit of IndexEntry::mtimeNs.
+    static int64_t fileClockNs() {
+#ifndef _WIN32
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count(); // Same epoch as st_mtim
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            fs::file_time_type::clock::now().time_since_epoch()).count(); // Same epoch as fs::last_write_time
+#endif
+    }
+
+    // Records a freshly computed hash in the stat-cache.
+    // Files modified within the timestamp granularity are not cached: a second write in the same
+    // tick would otherwise go unnoticed ("racy" entries). A sub-second mtime shows a filesystem with
+    // (at worst clock-tick, ~10 ms) fine timestamps; whole seconds may be all it stores, so those wait 1 s.
+    void rememberStat(const std::string& filename, const IndexEntry& entry) {
+        if (fileClockNs() - entry.mtimeNs < racyWindowNs(entry)) {
+            if (statCache.erase(filename)) indexDirty = true;
+            return;
+        }
+        statCache[filename] = entry;
+        indexDirty = true;
+    }
+
+
+    // --- Lazy Commit Store ---
+    // 'commits' is a cache of the commits parsed so far in this process.
+
+    // Returns the commit with the given full hash, parsing it from .minigit/commits on first use.
+    // Returns nullptr if the commit does not exist or is corrupt.
+    const Commit* findCommit(const std::string& commitHash) {
+        if (commitHash.empty()) return nullptr;
+        auto it = commits.find(commitHash);
+        if (it != commits.end()) {
+            return &it->second;
+        }
+        Commit c = loadCommitFromFile(commitHash);
+        if (c.hash.empty()) return nullptr;
+        return &(commits[commitHash] = std::move(c));
+    }
+
+    // Sorted index of every commit ID, built from one listing of .minigit/commits on first use.
+    const ObjectNameIndex& commitNameIndex() {
+        if (!commitIdsLoaded) {
+            commitIds.assign(listStore(".minigit/commits"));
+            commitIdsLoaded = true;
+        }
+        return commitIds;
+    }
+
+    // Expands a full or abbreviated (at least 4 characters) commit hash; empty if unknown or ambiguous.
+    // For an ambiguous abbreviation, 'why' (if given) receives an error listing the commits it matches.
+    // In a partial clone, commits the clone omitted are looked up in the object source as well.
+    std::string resolveCommitHash(const std::string& hash, std::string* why = nullptr) {
+        if (hash.empty()) return "";
+        const bool exactLookup = hash.size() > FANOUT_WIDTH; // Shorter names are never commit IDs
+        if (exactLookup && (commits.count(hash) || storeFileExists(".minigit/commits", hash))) return hash; // Exact match
+        std::string fullHash;
+        ObjectNameIndex::Match match = lookUpCommit(commitNameIndex(), hash, fullHash, why);
+        const ObjectSource* source = match == ObjectNameIndex::Match::None ? openObjectSource() : nullptr;
+        if (source) {
+            if (exactLookup && source->commitFile(hash).isOpen()) return hash; // Full hash of an omitted commit: no listing needed
+            match = lookUpCommit(sourceCommitNameIndex(), hash, fullHash, why);
+        }
+        return match == ObjectNameIndex::Match::Unique ? fullHash : ""; // Empty: not found
+    }
+
+    // One lookup of resolveCommitHash(). Abbreviations shorter than 4 characters never match.
+    ObjectNameIndex::Match lookUpCommit(const ObjectNameIndex& index, const std::string& hash, std::string& fullHash,
+                                        std::string* why) {
+        std::vector<std::string> candidates;
+        ObjectNameIndex::Match match = index.lookup(hash, fullHash, &candidates);
+        if (hash.length() < 4 && fullHash != hash) return ObjectNameIndex::Match::None;
+        if (match == ObjectNameIndex::Match::Ambiguous && why) {
+            *why = "Error: Abbreviated hash " + hash + " is ambiguous. Candidates:";
+            for (const std::string& candidate : candidates) {
+                const Commit* c = findCommit(candidate);
+                *why += "\n  " + candidate.substr(0, 12) + (c ? " " + c->message : "");
+            }
+        }
+        return match;
+    }
+
+    // Sorted index of the object source's commits, from one listing of its store on first use.
+    const ObjectNameIndex& sourceCommitNameIndex() {
+        const ObjectSource* source = openObjectSource();
+        if (!sourceCommitIdsLoaded && source) {
+            sourceCommitIds.assign(listStore(source->directory() + "/commits"));
+            sourceCommitIdsLoaded = true;
+        }
+        return sourceCommitIds;
+    }
+
+    // Resolves a commit-ish argument: "HEAD", a branch name, or a full/abbreviated commit hash.
+    // Branch names win over hash prefixes, like in checkout. 'why' is as for resolveCommitHash().
+    std::string resolveCommitish(const std::string& name, std::string* why = nullptr) {
+        if (name == "HEAD") return headCommitHash;
+        auto branch = branches.find(name);
+        if (branch != branches.end()) return branch->second;
+        return resolveCommitHash(name, why);
+    }
+
+    // Updates the working directory from 'fromCommit' (what is checked out now, may be null) to 'commit'.
+    // Only paths whose blob hash differs are touched (unchanged subtrees are skipped by tree hash),
+    // so unchanged files keep their mtimes. Updates of PARALLEL_WRITEBACK_MIN_FILES files or more are written on 'jobs' threads;
+    // smaller ones (and every update with a single job) are written in order as their prefetched blobs arrive.
+    // The stat data of every written file goes to the stat-cache, so the next status does not hash them again.
+    // Returns false (after printing why) if a file could not be written.
+    bool populateWorkingDirectory(const Commit* fromCommit, const Commit& commit) {
+        TRACE_SCOPE("populateWorkingDirectory");
+        std::vector<FileChange> writes;
+        for (const FileChange& change : diffCommits(fromCommit, &commit)) {
+            const std::string& filename = change.path;
+            if (!change.newBlob.empty()) {
+                // Skip files that already hold the target content (known from the stat-cache)
+                IndexEntry current;
+                if (statFile(filename, current) && statCacheHit(filename, current) &&
+                    statCache.at(filename).blobHash == change.newBlob) {
+                    continue;
+                }
+                writes.push_back(change);
+                continue;
+            }
+            // Delete files that are in the current snapshot but NOT in the target commit
+            try {
+                fs::remove(filename);
+                removeEmptyParents(filename);
+                std::cout << "Removed: " << filename << "\n";
+            } catch (const fs::filesystem_error& e) {
+                std::cerr << "Error removing file " << filename << ": " << e.what() << "\n";
+            }
+        }
+
+        // Parent directories are created up front so each writer only touches its own file.
+        std::error_code ec;
+        for (const FileChange& change : writes) {
+            fs::path parent = fs::path(change.path).parent_path();
+            if (!parent.empty()) fs::create_directories(parent, ec);
+        }
+        loadPacks(); // Packs are opened here, not lazily from the worker threads
+
+        std::vector<std::string> warnings(writes.size());
+        std::vector<IndexEntry> written(writes.size()); // Stat data of each written file (no hash: not written)
+        unsigned int writers = writes.size() >= PARALLEL_WRITEBACK_MIN_FILES ? ThreadPool::resolveJobs(jobs) : 1;
+        if (writers > 1) {
+            ThreadPool::parallelFor(writes.size(), writers, [&](size_t i) {
+                warnings[i] = writeWorkingFile(writes[i], mapBlob(writes[i].newBlob), written[i]);
+            });
+        } else {
+            std::vector<std::string> blobs;
+            for (const FileChange& change : writes) blobs.push_back(change.newBlob);
+            std::unique_ptr<BlobPrefetcher> prefetch = prefetchBlobs(std::move(blobs));
+            for (size_t i = 0; i < writes.size(); ++i) warnings[i] = writeWorkingFile(writes[i], prefetch->next(), written[i]);
+        }
+        // Files written in the last few milliseconds would be racy (see rememberStat()): waiting that out once
+        // is cheaper than hashing them all again on the next status. Whole-second filesystems are not waited for.
+        int64_t newest = 0;
+        for (const IndexEntry& entry : written) {
+            if (!entry.blobHash.empty() && racyWindowNs(entry) == FINE_RACY_WINDOW_NS) newest = std::max(newest, entry.mtimeNs);
+        }
+        int64_t wait = newest + FINE_RACY_WINDOW_NS - fileClockNs();
+        if (newest > 0 && wait > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(std::min(wait, FINE_RACY_WINDOW_NS)));
+        size_t failed = 0;
+        for (size_t i = 0; i < writes.size(); ++i) {
+            if (!warnings[i].empty()) std::cerr << warnings[i];
+            if (written[i].blobHash.empty()) {
+                ++failed;
+                if (statCache.erase(writes[i].path)) indexDirty = true;
+            } else {
+                rememberStat(writes[i].path, written[i]);
+            }
+        }
+        if (failed > 0) {
+            std::cerr << "Error: " << failed << " file(s) could not be written; the working directory does not match commit "
+                      << commit.hash.substr(0, 7) << ".\n";
+            return false;
+        }
+        std::cout << "Working directory updated to commit " << commit.hash.substr(0, 7) << ".\n";
+        return true;
+    }
+
+    // Writes one file of a checkout and fills 'written' with its stat data and blob hash.
+    // Returns a warning instead of printing it, since it may run on a worker thread; a file whose write failed
+    // (e.g. full disk) is removed rather than left truncated.
+    std::string writeWorkingFile(const FileChange& change, const MappedFile& blob, IndexEntry& written) {
+        if (!blob.isOpen()) {
+            return "Warning: Blob for " + change.path + " (" + change.newBlob.substr(0, 7) + ") not found. Skipping.\n";
+        }
+        std::ofstream outFile(change.path, std::ios::binary);
+        if (!outFile.is_open()) {
+            return "Warning: Could not write file " + change.path + ". Skipping.\n";
+        }
+        outFile.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+        outFile.close();
+        if (!outFile) {
+            std::error_code ec;
+            fs::remove(change.path, ec);
+            return "Error: Could not write file " + change.path + " (disk full?). It was removed.\n";
+        }
+        if (statFile(change.path, written)) written.blobHash = change.newBlob;
+        return "";
+    }
+
+    // Compares working directory files with the current HEAD commit or staging area.
+    // Returns a tuple of (modified, deleted, untracked) files.
+    // This is a helper for status().
+    struct WorkingDirChanges {
+        std::vector<std::string> modified;
+        std::vector<std::string> modifiedSinceStaged; // Staged, then changed again in the working directory
+        std::vector<std::string> deleted;
+        std::vector<std::string> untracked;
+    };
+
+    WorkingDirChanges getUnstagedChanges(const Commit* headCommit) {
+        WorkingDirChanges changes;
+        const FileTable& commitFiles = headCommit ? filesOf(*headCommit) : FileTable::empty();
+
+        // Files in working directory (excluding .minigit and other hidden files), hashed in parallel
+        std::vector<std::string> wdFileList = listWorkingFiles();
+        std::vector<std::string> wdHashes = hashWorkingFiles(wdFileList);
+        std::unordered_set<std::string> wdFiles(wdFileList.begin(), wdFileList.end());
+        for (size_t i = 0; i < wdFileList.size(); ++i) {
+            const std::string& filename = wdFileList[i];
+            const std::string& currentHash = wdHashes[i];
+
+            if (stagingArea.count(filename)) { // File is in staging
+                // Check if WD content differs from staged content
+                if (stagingArea.at(filename) != currentHash) {
+                    changes.modifiedSinceStaged.push_back(filename);
+                }
+                // If content matches staged, it's not an unstaged modification from staged.
+                // But if staged differs from commit, it would be a staged change.
+            } else if (const FileTable::Entry* committed = commitFiles.find(filename)) { // File is tracked by current commit
+                // Check if WD content differs from committed content
+                if (committed->blob.toString() != currentHash) {
+                    changes.modified.push_back(filename);
+                }
+            } else { // Not in staging and not in commit -> Untracked
+                changes.untracked.push_back(filename);
+            }
+        }
+
+        // Files deleted from working directory (but present in commit or staging)
+        // Check for files that were in the last commit (tracked) but are now missing from WD
+        for (const auto& entry : commitFiles) {
+            const std::string& filename = commitFiles.path(entry);
+            if (!wdFiles.count(filename) && !stagingArea.count(filename)) { // Not in WD and not in staging
+                changes.deleted.push_back(filename);
+            }
+            // If it's in staging but not in WD, it's a staged deletion (handled by getStagedChanges)
+            // If it's in WD but not in staging (and was in commit), it's handled above as a modified/unchanged.
+        }
+
+        return changes;
+    }
+
+    // Checks if there are changes staged for commit.
+    // Returns a tuple of (added, modified, deleted) staged files.
+    struct StagedChanges {
+        std::vector<std::string> added;
+        std::vector<std::string> modified;
+        std::vector<std::string> deleted; // Files removed from tracking and then added to staging (via git rm)
+    };
+
+    StagedChanges getStagedChanges(const Commit* headCommit) {
+        StagedChanges changes;
+        const FileTable& commitFiles = headCommit ? filesOf(*headCommit) : FileTable::empty();
+
+        // Check staged files (added/modified)
+        for (const auto& [filename, stagedBlobHash] : stagingArea) {
+            if (const FileTable::Entry* committed = commitFiles.find(filename)) {
+                // File exists in both staged and committed, check if content differs
+                if (committed->blob.toString() != stagedBlobHash) {
+                    changes.modified.push_back(filename);
+                }
+            } else {
+                // New file added to staging
+                changes.added.push_back(filename);
+            }
+        }
+
+        // Check for files that were in the current commit but are now missing from staging
+        // This implies they were "removed" (like `git rm` but we don't have rm, so implicitly by user deletion + add)
+        for (const auto& entry : commitFiles) {
+            const std::string& filename = commitFiles.path(entry);
+            if (!stagingArea.count(filename)) { // If file was in commit, but not in staging
+                // This means it's either deleted from staging, or it was deleted from WD and never added to staging.
+                // For simplicity, we assume if it's missing from staging, it's considered deleted if it's also missing from WD.
+                // A true `git rm` would stage the deletion.
+                if (!fs::exists(filename)) { // If it's also not in the working directory
+                     changes.deleted.push_back(filename);
+                }
+            }
+        }
+        return changes;
+    }
+
+public:
+    // --- Result Model ---
+    // Queries return data instead of printing it; main.cpp formats the results for the terminal.
+
+    // Snapshot of the repository state, as computed by getStatus(). Paths are relative to the repository root.
+    struct StatusResult {
+        std::string branch;     // Empty when HEAD is detached
+        std::string headCommit; // Full hash; empty before the first commit
+        std::vector<std::string> stagedAdded;
+        std::vector<std::string> stagedModified;
+        std::vector<std::string> stagedDeleted;
+        std::vector<std::string> modified;            // Tracked, not staged, content differs from HEAD
+        std::vector<std::string> modifiedSinceStaged; // Staged, then changed again in the working directory
+        std::vector<std::string> deleted;
+        std::vector<std::string> untracked;
+        std::string mergeHead;                        // Commit being merged while a merge awaits its commit
+        std::vector<std::string> unmerged;            // Conflicted paths of that merge not yet resolved
+        std::vector<std::string> warnings;            // Problems met while computing it, one message each
+
+        bool hasStagedChanges() const { return !stagedAdded.empty() || !stagedModified.empty() || !stagedDeleted.empty(); }
+        bool hasUnstagedChanges() const { return !modified.empty() || !modifiedSinceStaged.empty() || !deleted.empty(); }
+        bool clean() const { return !hasStagedChanges() && !hasUnstagedChanges() && untracked.empty(); }
+    };
+
+    // One commit produced by a log walk.
+    struct LogEntry {
+        std::string hash;
+        std::string message;
+        std::string timestamp;
+        std::vector<std::string> parents;
+        bool shallow = false; // Boundary of a shallow clone: the history before it was not cloned
+    };
+
+    // One saved 'stash' state. Both trees are ordinary tree objects outside the commit history.
+    struct StashEntry {
+        std::string base;      // Commit HEAD pointed to when the state was saved
+        std::string indexTree; // The staging area
+        std::string workTree;  // The working directory: every tracked file plus the untracked ones
+        std::string message;
+    };
+
+private:
+    // --- Stash ---
+    // .minigit/refs/stash is the stash stack, newest entry first, one "<base> <index tree> <work tree> <message>"
+    // line per entry. Only the changed files' blobs are new (staged blobs and unchanged files are in the store
+    // already), and stashes never add to .minigit/commits, so they cost nothing when the repository is loaded.
+    static constexpr const char* STASH_PATH = ".minigit/refs/stash";
+
+    std::vector<StashEntry> readStash() {
+        std::vector<StashEntry> entries;
+        std::stringstream ss(readFileContent(STASH_PATH));
+        std::string line;
+        while (std::getline(ss, line)) {
+            std::stringstream fields(line);
+            StashEntry entry;
+            if (!(fields >> entry.base >> entry.indexTree >> entry.workTree)) continue;
+            std::getline(fields >> std::ws, entry.message);
+            entries.push_back(std::move(entry));
+        }
+        return entries;
+    }
+
+    // Replaces the stash stack atomically; an empty stack removes the file.
+    bool writeStash(const std::vector<StashEntry>& entries) {
+        if (entries.empty()) {
+            std::error_code ec;
+            fs::remove(STASH_PATH, ec);
+            return !ec;
+        }
+        std::string content;
+        for (const StashEntry& entry : entries) {
+            content += entry.base + " " + entry.indexTree + " " + entry.workTree + " " + entry.message + "\n";
+        }
+        return RefStore::writeFileAtomic(STASH_PATH, content);
+    }
+
+    // Makes 'path' hold 'blobHash' (or removes it for an empty hash). Returns false on failure.
+    bool restoreWorkingFile(const std::string& path, const std::string& blobHash) {
+        if (blobHash.empty()) {
+            std::error_code ec;
+            fs::remove(path, ec);
+            removeEmptyParents(path);
+            return !ec;
+        }
+        MappedFile blob = mapBlob(blobHash);
+        return blob.isOpen() && writeMergedFile(path, blob.view(), blobHash);
+    }
+
+    // State of one log walk, shared by the copies of its LogIterator.
+    // Commits are visited newest first by (timestamp, generation), so children come before their parents
+    // even when both were committed in the same second. The walk runs on the commit-graph;
+    // a commit file is only read when its entry is produced. Corrupt commits are reported in 'warnings'.
+    class LogWalk {
+    public:
+        LogWalk(MiniGitSystem& repository, const std::string& start, bool firstParent,
+                std::shared_ptr<std::vector<std::string>> problems)
+            : repo(repository), firstParentOnly(firstParent), warnings(std::move(problems)) {
+            enqueue(start);
+        }
+
+        // Produces the next commit; false when the walk is over.
+        bool next(LogEntry& entry) {
+            if (queue.empty()) return false;
+            std::string current = queue.top().hash;
+            queue.pop();
+            const Commit* c = repo.findCommit(current);
+            if (!c) {
+                warnings->push_back("Error: Corrupt commit reference " + current + ". Stopping log.");
+                queue = {};
+                return false;
+            }
+            entry.hash = c->hash;
+            entry.message = c->message;
+            entry.timestamp = c->timestamp;
+            entry.parents = c->parentHashes;
+            entry.shallow = repo.isShallow(c->hash);
+            if (entry.shallow) return true; // Its parents were not cloned: this path of the walk ends here
+            if (firstParentOnly) {
+                if (!c->parentHashes.empty()) enqueue(c->parentHashes[0]);
+            } else {
+                for (const std::string& parent : c->parentHashes) enqueue(parent);
+            }
+            return true;
+        }
+
+    private:
+        struct QueuedCommit {
+            int64_t timestamp;
+            uint32_t generation;
+            std::string hash;
+            bool operator<(const QueuedCommit& other) const {
+                if (timestamp != other.timestamp) return timestamp < other.timestamp;
+                if (generation != other.generation) return generation < other.generation;
+                return hash < other.hash;
+            }
+        };
+
+        MiniGitSystem& repo;
+        bool firstParentOnly;
+        std::shared_ptr<std::vector<std::string>> warnings; // Shared with the LogRange that started the walk
+        std::priority_queue<QueuedCommit> queue;
+        std::unordered_set<std::string> visited; // Each commit is produced once, however many paths reach it
+
+        void enqueue(const std::string& hash) {
+            std::vector<std::string> parents;
+            int64_t timestamp = 0;
+            uint32_t generation = 0;
+            if (!visited.insert(hash).second) return;
+            if (!repo.commitNode(hash, parents, timestamp, generation)) {
+                warnings->push_back("Error: Corrupt commit reference " + hash + ". Skipping.");
+                return;
+            }
+            queue.push({timestamp, generation, hash});
+        }
+    };
+
+public:
+    // Input iterator over a log walk. Each increment reads one more commit, so a caller that
+    // stops early never pays for the rest of the history.
+    class LogIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = LogEntry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const LogEntry*;
+        using reference = const LogEntry&;
+
+        LogIterator() = default; // End of the walk
+        explicit LogIterator(std::shared_ptr<LogWalk> state) : walk(std::move(state)) { ++*this; }
+
+        reference operator*() const { return current; }
+        pointer operator->() const { return &current; }
+        LogIterator& operator++() {
+            if (walk && !walk->next(current)) walk.reset();
+            return *this;
+        }
+        bool operator==(const LogIterator& other) const { return walk == other.walk; }
+        bool operator!=(const LogIterator& other) const { return walk != other.walk; }
+
+    private:
+        std::shared_ptr<LogWalk> walk;
+        LogEntry current;
+    };
+
+    // The commits reachable from one start commit, for range-for loops. Nothing is read until begin().
+    // Corrupt commits met on the way are skipped (or end the walk) and listed by warnings() afterwards.
+    class LogRange {
+    public:
+        LogRange(MiniGitSystem& repository, std::string startCommit, bool firstParent)
+            : repo(&repository), start(std::move(startCommit)), firstParentOnly(firstParent) {}
+
+        LogIterator begin() const {
+            if (start.empty()) return LogIterator();
+            return LogIterator(std::make_shared<LogWalk>(*repo, start, firstParentOnly, problems));
+        }
+        LogIterator end() const { return LogIterator(); }
+
+        // One message per problem, in the order the walks met them.
+        const std::vector<std::string>& warnings() const { return *problems; }
+
+    private:
+        MiniGitSystem* repo;
+        std::string start;
+        bool firstParentOnly;
+        std::shared_ptr<std::vector<std::string>> problems = std::make_shared<std::vector<std::string>>();
+    };
+
+    // The two sides a diff() compares.
+    enum class DiffMode { WorkingTreeVsIndex, IndexVsHead, WorkingTreeVsCommit, CommitVsCommit };
+
+    struct FileDiff {
+        enum class Kind { Modified, Added, Deleted };
+        std::string path;
+        Kind kind = Kind::Modified;
+    };
+
+    // Receives a diff while it is computed, one file at a time. Returning false from fileStart()
+    // or hunk() stops the diff: the remaining files are neither read nor compared.
+    class DiffVisitor {
+    public:
+        virtual ~DiffVisitor() = default;
+        // Called once before any file; commit hashes are empty for the staging area and working directory.
+        virtual void begin(DiffMode /*mode*/, const std::string& /*oldCommit*/, const std::string& /*newCommit*/) {}
+        virtual bool fileStart(const FileDiff& /*file*/) { return true; }
+        virtual bool hunk(const FileDiff& /*file*/, const DiffEngine::Hunk& /*hunk*/) { return true; }
+        virtual void fileEnd(const FileDiff& /*file*/) {}
+    };
+
+    struct DiffResult {
+        std::string error;       // Why the diff could not run; nothing was visited
+        size_t filesChanged = 0; // Files passed to the visitor
+        bool stopped = false;    // The visitor ended the diff early
+        bool ok() const { return error.empty(); }
+    };
+
+    bool isRepository() const { return fs::exists(".minigit"); }
+    const std::string& currentBranch() const { return headBranch; } // Empty when HEAD is detached
+    const std::string& headCommit() const { return headCommitHash; }
+    const std::unordered_map<std::string, std::string>& branchRefs() const { return branches; }
+
+    // --- Public API ---
+
+    // Sets the number of threads used to hash working directory files in status/diff and to write files in checkout (0 = all cores).
+    // A count the user gave ('given') also caps the blob prefetch threads, which otherwise use at least PREFETCH_THREADS.
+    void setJobs(unsigned int jobCount, bool given = true) {
+        jobs = jobCount;
+        jobsGiven = given;
+    }
+
+    // Selects the line diff algorithm and the number of context lines around each hunk.
+    void setDiffOptions(DiffAlgorithm algorithm, size_t contextLines) {
+        diffAlgorithm = algorithm;
+        diffContextLines = contextLines;
+    }
+
+    // --- Long-running processes (daemon mode) ---
+
+    // Keeps the working-tree listing and content hashes in memory between queries (see WorkingTreeCache).
+    // The caller must then report every change through markWorkingPathsDirty() or invalidateWorkingTree().
+    void enableWorkingTreeCache() {
+        workingTree = WorkingTreeCache();
+        workingTree.enabled = true;
+    }
+
+    // Paths are relative to the repository root; a directory stands for everything below it.
+    void markWorkingPathsDirty(const std::vector<std::string>& paths) {
+        workingTree.dirty.insert(paths.begin(), paths.end());
+    }
+
+    // True if the working-tree directory 'dir' is excluded by .minigitignore (the file watcher does not watch those).
+    bool isIgnoredDirectory(const std::string& dir) { return ignoreRules().excluded(dir, true); }
+
+    // Forces a full rescan on the next query (e.g. after the file watcher lost events).
+    void invalidateWorkingTree() { workingTree.valid = false; }
+
+    // Re-reads config, HEAD, refs, index and commit-graph after another process changed them.
+    // Cached trees and working-tree hashes stay valid: they are keyed by content.
+    void reloadRepoState() {
+        if (!fs::exists(".minigit")) return;
+        commitGraph.close();
+        packs.clear(); // gc may have replaced them
+        packsLoaded = false;
+        objectCache = ObjectCache();
+        commitIdsLoaded = false;
+        branches.clear();
+        loadRepoState();
+    }
+
+    // Constructor: Attempts to load existing repository state. Reports nothing; see isRepository().
+    MiniGitSystem() {
+        if (fs::exists(".minigit")) {
+            loadRepoState(); // Consolidate loading logic
+        } else {
+            // Set default initial state for a new repo that hasn't been init'd
+            headBranch = "master";
+            headCommitHash = "";
+            stagingArea.clear();
+            commits.clear();
+            branches.clear();
+        }
+    }
+
+    // Initializes a new MiniGit repository using the given hash engine ("sha256" or "blake3").
+    // Files of at least 'chunkThresholdBytes' are stored as deduplicated chunks (0 disables chunking).
+    void init(const std::string& hashName = "sha256", uint64_t chunkThresholdBytes = 0) {
+        if (fs::exists(".minigit")) {
+            std::cout << "MiniGit repository already initialized in .minigit\n";
+            return;
+        }
+        HashAlgorithm algorithm;
+        if (!parseHashAlgorithm(hashName, algorithm) || algorithm == HashAlgorithm::LegacyStdHash) {
+            std::cout << "Error: Unsupported hash algorithm: " << hashName << " (use sha256 or blake3)\n";
+            return;
+        }
+        try {
+            fs::create_directory(".minigit");
+            fs::create_directory(".minigit/objects");
+            fs::create_directory(".minigit/commits");
+            fs::create_directories(".minigit/refs/heads"); // For branch pointers
+            repoFormatVersion = REPO_FORMAT_VERSION;
+            hashAlgorithm = algorithm;
+            chunkThreshold = chunkThresholdBytes;
+            writeRepoConfig();
+
+            headBranch = "master";
+            headCommitHash = ""; // No commits yet
+            branches["master"] = ""; // Master points to no commit initially
+            saveHeadAndBranchRefs(); // Create the HEAD file and master ref
+            std::cout << "Initialized empty MiniGit repository in .minigit (" << hashAlgorithmName(hashAlgorithm) << ")\n";
+        } catch (const fs::filesystem_error& e) {
+            std::cerr << "Error initializing MiniGit repository: " << e.what() << "\n";
+        }
+    }
+
+    // Clones the repository at 'sourcePath' into the current (empty) directory as a shallow, partial clone:
+    // the refs, the commits within 'depth' of each branch tip (0 = all of them) and the objects of HEAD's tree,
+    // which is checked out. The commits at the depth boundary are recorded in .minigit/shallow and every other
+    // commit and object of the source in .minigit/omitted. The source stays configured as the clone's object
+    // source, so 'log' ends at the boundary and whatever else needs an omitted object (a diff or checkout of
+    // an older commit, another branch) fetches it on first use. Returns false if nothing was cloned.
+    bool clone(const std::string& sourcePath, size_t depth = 1) {
+        TRACE_SCOPE("clone");
+        std::error_code ec;
+        if (fs::exists(".minigit") || fs::directory_iterator(".", ec) != fs::directory_iterator()) {
+            std::cout << "Error: Clone into an empty directory (this one is not empty).\n";
+            return false;
+        }
+        const std::string sourceRoot = fs::absolute(sourcePath, ec).lexically_normal().generic_string();
+        ObjectSource source;
+        if (ec || !source.open(sourceRoot)) {
+            std::cout << "Error: " << sourcePath << " is not a MiniGit repository.\n";
+            return false;
+        }
+        try {
+            fs::create_directories(".minigit/objects");
+            fs::create_directory(".minigit/commits");
+            fs::create_directories(".minigit/refs/heads");
+        } catch (const fs::filesystem_error& e) {
+            std::cerr << "Error initializing MiniGit repository: " << e.what() << "\n";
+            return false;
+        }
+
+        // Same format and hash engine as the source, so fetched files can be kept as they are stored there
+        std::string config = readFileContent(source.directory() + "/config");
+        std::string head = readFileContent(source.directory() + "/HEAD");
+        if (!RefStore::writeFileAtomic(".minigit/config", config) ||
+            !RefStore::writeFileAtomic(".minigit/HEAD", head.empty() ? "ref: refs/heads/master\n" : head)) {
+            std::cerr << "Error: Could not write .minigit/config and .minigit/HEAD\n";
+            return false;
+        }
+        loadRepoConfig();
+        objectSourcePath = sourceRoot;
+        fanoutMigrationPending = false; // Whatever the source is in the middle of, this clone writes fanout paths
+        writeRepoConfig();
+        RefStore::Transaction refs = refStore.transaction();
+        for (const auto& [name, hash] : RefStore(source.directory()).load()) {
+            if (!hash.empty()) refs.update(name, hash);
+        }
+        if (!refs.commit()) {
+            std::cerr << "Error: Could not write the branch refs.\n";
+            return false;
+        }
+        loadRepoState();
+
+        // Commits breadth-first from every tip, so a commit reached on several paths counts at its shortest distance
+        std::vector<std::string> level;
+        for (const auto& [name, hash] : branches) level.push_back(hash);
+        if (headBranch.empty()) level.push_back(headCommitHash);
+        std::unordered_set<std::string> cloned;
+        std::vector<std::string> boundary;
+        for (size_t distance = 1; !level.empty(); ++distance) {
+            std::vector<std::string> next;
+            for (const std::string& hash : level) {
+                if (hash.empty() || !cloned.insert(hash).second) continue;
+                const Commit* c = findCommit(hash); // Fetched from the source
+                if (!c) {
+                    std::cerr << "Warning: Commit " << hash.substr(0, 7) << " could not be read from " << sourcePath << ".\n";
+                    continue;
+                }
+                if (depth == 0 || distance < depth) {
+                    next.insert(next.end(), c->parentHashes.begin(), c->parentHashes.end());
+                } else if (!c->parentHashes.empty()) {
+                    boundary.push_back(hash);
+                }
+            }
+            level = std::move(next);
+        }
+        std::sort(boundary.begin(), boundary.end());
+        std::string shallow;
+        for (const std::string& hash : boundary) shallow += hash + "\n";
+        if (!boundary.empty() && !RefStore::writeFileAtomic(SHALLOW_PATH, shallow)) {
+            std::cerr << "Error: Could not write " << SHALLOW_PATH << "\n";
+            return false;
+        }
+        shallowCommits.insert(boundary.begin(), boundary.end());
+
+        // The tip tree: checking it out fetches its trees and blobs (in parallel, see prefetchBlobs())
+        const Commit* headCommit = findCommit(headCommitHash);
+        bool populated = !headCommit || populateWorkingDirectory(nullptr, *headCommit);
+        if (!flushObjects()) {
+            std::cerr << "Error: Could not write the cloned objects.\n";
+            return false;
+        }
+        stagingArea.clear();
+        writeIndex();
+        writeCommitGraph(allCommitGraphEntries());
+
+        // Everything else the source has is omitted
+        std::vector<std::string> local = listStore(".minigit/objects");
+        const size_t objectCount = local.size();
+        for (std::string& hash : listStore(".minigit/commits")) local.push_back(std::move(hash));
+        std::sort(local.begin(), local.end());
+        std::vector<std::string> omitted = listStore(source.directory() + "/objects");
+        for (std::string& hash : source.packedNames()) omitted.push_back(std::move(hash));
+        for (std::string& hash : listStore(source.directory() + "/commits")) omitted.push_back(std::move(hash));
+        std::sort(omitted.begin(), omitted.end());
+        omitted.erase(std::unique(omitted.begin(), omitted.end()), omitted.end());
+        std::string omittedList;
+        size_t omittedCount = 0;
+        for (const std::string& hash : omitted) {
+            if (std::binary_search(local.begin(), local.end(), hash)) continue;
+            omittedList += hash + "\n";
+            ++omittedCount;
+        }
+        if (!RefStore::writeFileAtomic(OMITTED_PATH, omittedList)) {
+            std::cerr << "Error: Could not write " << OMITTED_PATH << "\n";
+            return false;
+        }
+        std::cout << "Cloned " << sourcePath << ": " << local.size() - objectCount << " commits";
+        if (depth > 0) std::cout << " (depth " << depth << ")";
+        std::cout << " and " << objectCount << " objects; " << omittedCount << " omitted objects and commits are fetched on demand.\n";
+        return populated; // Otherwise the repository is complete, but some working-tree files are missing
+    }
+
+    // Adds a file's current content to the staging area. The file may be in a subdirectory.
+    // Returns false if the file could not be staged.
+    bool add(const std::string& path) {
+        return add(std::vector<std::string>{path});
+    }
+
+    // Stages every file matched by 'pathspecs': file paths, directories (every file below them, "." for all)
+    // and glob patterns ('*', '?', '[...]'; '*' also matches '/') over the working tree. With 'all' (-A)
+    // the whole working tree is staged and staged files that no longer exist are unstaged.
+    // Files are hashed and new blobs written on 'jobs' threads; blobs already in the object store are
+    // not rewritten, and the index is written once at the end.
+    // Returns false, staging nothing, if a pathspec matches no file.
+    bool add(const std::vector<std::string>& pathspecs, bool all = false) {
+        TRACE_SCOPE("add");
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return false;
+        }
+        std::vector<std::string> filenames;
+        if (!expandPathspecs(all ? std::vector<std::string>{"."} : pathspecs, filenames)) return false;
+
+        struct AddResult {
+            std::string hash;
+            IndexEntry stat;
+            bool statOk = false;
+            bool cached = false; // Hash taken from the stat-cache, file not read
+            bool readOk = false;
+        };
+        std::vector<AddResult> results(filenames.size());
+        loadObjectCache(); // Workers only query the object store, so it must be fully loaded first
+        std::mutex objectsMutex;
+        std::unordered_set<std::string> claimed; // Blobs being written, so duplicate contents are written once
+        ThreadPool::parallelFor(filenames.size(), jobs, [&](size_t i) {
+            AddResult& result = results[i];
+            result.statOk = statFile(filenames[i], result.stat);
+            if (result.statOk && statCacheHit(filenames[i], result.stat)) {
+                result.hash = statCache.at(filenames[i]).blobHash;
+                result.cached = result.readOk = hasObject(result.hash);
+                if (result.readOk) return;
+            }
+            MappedFile content = MappedFile::read(filenames[i]); // Hashed and stored from one read, without a copy
+            if (!content.isOpen()) return;
+            result.readOk = true;
+            result.cached = false;
+            result.hash = hashFileContent(content.view());
+            result.stat.blobHash = result.hash;
+            if (hasObject(result.hash)) return;
+            auto claim = [&](const std::string& hash) {
+                std::lock_guard<std::mutex> lock(objectsMutex);
+                return claimed.insert(hash).second;
+            };
+            if (!claim(result.hash)) return;
+            if (chunkThreshold > 0 && content.size() >= chunkThreshold) {
+                saveChunkedBlob(result.hash, content.view(), claim); // Chunks may be shared between files
+            } else {
+                saveBlob(result.hash, content.view());
+            }
+        });
+
+        if (!flushObjects()) { // Blobs are durable before the index refers to them
+            std::cerr << "Error: Could not write the object files. Nothing was staged.\n";
+            return false;
+        }
+
+        // Index updates and messages in path order, as if the files had been added one by one
+        const bool verbose = filenames.size() == 1;
+        size_t added = 0, upToDate = 0, unreadable = 0;
+        bool stagingChanged = false;
+        for (size_t i = 0; i < filenames.size(); ++i) {
+            const std::string& filename = filenames[i];
+            const AddResult& result = results[i];
+            if (!result.readOk) {
+                std::cerr << "Warning: Could not read content of file: " << filename << ". Not added.\n";
+                ++unreadable;
+                continue;
+            }
+            if (result.statOk && !result.cached) rememberStat(filename, result.stat);
+            auto staged = stagingArea.find(filename);
+            if (staged != stagingArea.end() && staged->second == result.hash) {
+                ++upToDate;
+                if (verbose) std::cout << "File already up to date in staging: " << filename << "\n";
+                continue;
+            }
+            stagingArea[filename] = result.hash;
+            stagingChanged = true;
+            ++added;
+            std::cout << "Added file to staging: " << filename << " (" << result.hash.substr(0, 7) << ")\n";
+        }
+        if (all) {
+            for (auto it = stagingArea.begin(); it != stagingArea.end();) {
+                if (fs::exists(it->first)) {
+                    ++it;
+                    continue;
+                }
+                std::cout << "Removed from staging: " << it->first << "\n";
+                it = stagingArea.erase(it);
+                stagingChanged = true;
+            }
+        }
+        if (stagingChanged) {
+            writeIndex();
+        } else {
+            saveIndexIfDirty();
+        }
+        if (!verbose) {
+            std::cout << "Staged " << added << " file" << (added == 1 ? "" : "s") << " (" << upToDate << " already up to date)\n";
+        }
+        return unreadable == 0;
+    }
+
+    // Commits staged changes with a given message.
+    void commit(const std::string& message) {
+        TRACE_SCOPE("commit");
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return;
+        }
+
+        const Commit* currentHeadCommit = findCommit(headCommitHash);
+        if (!headCommitHash.empty() && !currentHeadCommit) {
+            std::cerr << "Error: HEAD commit " << headCommitHash.substr(0, 7) << " not found or corrupt. Cannot commit.\n";
+            return;
+        }
+
+        // Get staged changes to check if there's anything to commit
+        StagedChanges staged = getStagedChanges(currentHeadCommit);
+
+        // A pending merge (see merge()) becomes the second parent once its conflicts are resolved
+        std::string mergeHead;
+        std::vector<std::string> conflicts;
+        bool merging = readMergeHead(mergeHead, conflicts);
+        std::vector<std::string> unresolved;
+        for (const std::string& path : conflicts) {
+            if (!stagingArea.count(path) && fs::exists(path)) unresolved.push_back(path);
+        }
+        if (!unresolved.empty()) {
+            std::cout << "Error: Unresolved merge conflicts. Edit these files and 'add' them (or delete them) first:\n";
+            for (const std::string& path : unresolved) std::cout << "    " << path << "\n";
+            return;
+        }
+
+        // Check if there are any staged changes at all
+        if (!merging && staged.added.empty() && staged.modified.empty() && staged.deleted.empty()) {
+            std::cout << "No changes to commit. Staging area is empty or identical to HEAD.\n";
+            stagingArea.clear(); // Ensure staging is clear if no effective changes
+            writeIndex();
+            return;
+        }
+
+
+        Commit newCommit;
+        newCommit.timestamp = getCurrentTime();
+        newCommit.message = message;
+
+        std::unordered_map<std::string, std::string> snapshot; // path -> blob hash of the new commit
+        if (!headCommitHash.empty()) {
+            newCommit.parentHashes.push_back(headCommitHash);
+            // Start the new commit's file snapshot by copying from the parent
+            snapshot = filesOf(*currentHeadCommit).toMap();
+        }
+        if (merging) newCommit.parentHashes.push_back(mergeHead);
+
+        // Apply staged changes to the new commit's file snapshot
+        for (const auto& [filename, blob] : stagingArea) {
+            // Add or update file in the new commit's snapshot
+            snapshot[filename] = blob;
+        }
+
+        // Handle explicitly 'removed' files from the commit snapshot
+        // Files marked as 'deleted' in staged changes should be removed from the new commit's snapshot
+        for(const auto& filename : staged.deleted) {
+            snapshot.erase(filename);
+        }
+
+        // Store the snapshot as tree objects; directories unchanged since the parent keep their tree hash
+        newCommit.treeHash = writeTree(snapshot);
+        std::shared_ptr<const FileTable>& shared = fileTables[newCommit.treeHash];
+        if (!shared) shared = FileTable::build(snapshot, pathTable);
+        newCommit.files = shared;
+
+        // Generate commit hash based on its content (message, timestamp, parent, and root tree hash)
+        std::string commitContentToHash = newCommit.message + newCommit.timestamp;
+        for (const auto& parent : newCommit.parentHashes) commitContentToHash += parent;
+        commitContentToHash += "tree" + newCommit.treeHash;
+
+        newCommit.hash = hashFileContent(commitContentToHash);
+
+        // Trees and the commit become durable (one sync) before the ref update publishes the commit,
+        // so a crash can never leave a branch pointing at a missing or truncated object
+        if (!writeCommitToFile(newCommit) || !flushObjects()) {
+            std::cerr << "Error: Could not write the commit objects. Nothing was committed.\n";
+            return;
+        }
+        commits[newCommit.hash] = newCommit;
+        headCommitHash = newCommit.hash;
+
+        if (!headBranch.empty()) { // Update current branch if not in detached HEAD
+            branches[headBranch] = newCommit.hash;
+        }
+        saveHeadAndBranchRefs(); // Update branch ref file and HEAD file
+
+        if (commitIdsLoaded) commitIds.insert(newCommit.hash);
+        addToCommitGraph(newCommit);
+        if (merging) fs::remove(MERGE_HEAD_PATH);
+        stagingArea.clear(); // Clear staging area after successful commit
+        writeIndex();
+        std::cout << "Committed as " << newCommit.hash.substr(0, 7) << "\n";
+    }
+
+    // The commit history: every commit reachable from HEAD, newest first
+    // (or only the first-parent chain with 'firstParentOnly'). The range is lazy (see LogIterator).
+    LogRange walkLog(bool firstParentOnly = false) {
+        return LogRange(*this, isRepository() ? headCommitHash : "", firstParentOnly);
+    }
+
+    // Creates new branches pointing to the current HEAD commit, all in one ref transaction.
+    void branch(const std::vector<std::string>& names) {
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return;
+        }
+        if (headCommitHash.empty()) {
+            std::cout << "Cannot create branch: No commits yet.\n";
+            return;
+        }
+        RefStore::Transaction refs = refStore.transaction();
+        for (const std::string& name : names) {
+            if (branches.count(name)) {
+                std::cout << "Error: Branch '" << name << "' already exists.\n";
+                return;
+            }
+            refs.update(name, headCommitHash);
+        }
+        if (!refs.commit()) {
+            std::cerr << "Error: Could not save branch refs.\n";
+            return;
+        }
+        for (const std::string& name : names) {
+            branches[name] = headCommitHash;
+            std::cout << "Created branch: " << name << " pointing to " << headCommitHash.substr(0, 7) << "\n";
+        }
+    }
+
+    // Switches between branches or checks out a specific commit.
+    void checkout(const std::string& target) {
+        TRACE_SCOPE("checkout");
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return;
+        }
+
+        // Check for uncommitted changes (both staged and unstaged)
+        const Commit* currentHeadCommit = findCommit(headCommitHash);
+        StatusResult pending = getStatus();
+        if (!pending.clean()) {
+            std::cout << "Error: Your working directory has uncommitted changes. Please commit or stash them before checking out.\n";
+            // Show the user what changes are pending
+            for (const std::vector<std::string>* paths : {&pending.stagedAdded, &pending.stagedModified, &pending.stagedDeleted,
+                                                          &pending.modifiedSinceStaged, &pending.modified, &pending.deleted, &pending.untracked}) {
+                for (const std::string& path : *paths) std::cout << "    " << path << "\n";
+            }
+            return;
+        }
+
+        std::string targetCommitHash = "";
+        std::string newHeadBranch = "";
+        std::string notFound;
+
+        // Try to checkout a branch
+        if (branches.count(target)) {
+            targetCommitHash = branches[target];
+            newHeadBranch = target;
+        } else { // Try to checkout a commit (by its full hash or an abbreviation of at least 4 chars)
+            targetCommitHash = resolveCommitHash(target, &notFound);
+            // newHeadBranch remains empty for detached HEAD
+        }
+
+        if (targetCommitHash.empty() && !newHeadBranch.empty()) {
+            // Special case: checking out an empty branch (e.g., master after init, before first commit)
+            if (headBranch == newHeadBranch) {
+                std::cout << "Already on branch '" << newHeadBranch << "'.\n";
+                return;
+            }
+            std::cout << "Switched to branch: " << newHeadBranch << " (empty branch, no files restored).\n";
+            // Clear working directory as there's no snapshot to restore.
+            for (const std::string& filename : listWorkingFiles()) {
+                try {
+                    fs::remove(filename);
+                    removeEmptyParents(filename);
+                } catch (const fs::filesystem_error& e) {
+                    std::cerr << "Warning: Could not remove file " << filename << " during empty branch checkout: " << e.what() << "\n";
+                }
+            }
+            headBranch = newHeadBranch;
+            headCommitHash = targetCommitHash; // Will be empty
+            saveHeadAndBranchRefs();
+            stagingArea.clear();
+            writeIndex();
+            return;
+        }
+
+        if (targetCommitHash.empty()) {
+            if (!notFound.empty()) std::cerr << notFound << "\n";
+            std::cout << "Error: Branch or commit not found: " << target << "\n";
+            return;
+        }
+
+        // Ensure the target commit is loaded
+        const Commit* targetCommit = findCommit(targetCommitHash);
+        if (!targetCommit) {
+            std::cerr << "Error: Target " << target << " points to a corrupt commit. Cannot checkout.\n";
+            return;
+        }
+
+        // Check if we are already at the target
+        if (headCommitHash == targetCommitHash && ((newHeadBranch.empty() && headBranch.empty()) || (newHeadBranch == headBranch))) {
+            std::cout << "Already on " << (newHeadBranch.empty() ? "commit " + targetCommitHash.substr(0,7) + " (detached HEAD)" : "branch '" + newHeadBranch + "'") << ".\n";
+            return;
+        }
+
+
+        const Commit* previousCommit = currentHeadCommit; // The working directory matches it (checked above)
+        headBranch = newHeadBranch;
+        headCommitHash = targetCommitHash;
+        saveHeadAndBranchRefs(); // Update HEAD file and branch ref (if applicable)
+        populateWorkingDirectory(previousCommit, *targetCommit);
+        if (newHeadBranch.empty()) {
+            std::cout << "Checked out commit: " << headCommitHash.substr(0, 7) << " (detached HEAD)\n";
+        } else {
+            std::cout << "Switched to branch: " << newHeadBranch << "\n";
+        }
+        stagingArea.clear(); // Clear staging area on checkout
+        writeIndex();
+    }
+
+    // Merges a branch (or any commit-ish) into the current branch.
+    // The merge base is found over the commit graph (see mergeBase()). Files whose blob hash only changed
+    // on one side are resolved from the trees alone; only files both sides changed are merged line by
+    // line (MergeEngine.hpp). A clean merge is committed with both heads as parents; otherwise the
+    // conflicts are left in the working directory and the next commit completes the merge.
+    void merge(const std::string& target) {
+        TRACE_SCOPE("merge");
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return;
+        }
+        if (fs::exists(MERGE_HEAD_PATH)) {
+            std::cout << "Error: A merge is already in progress. Resolve its conflicts and commit first.\n";
+            return;
+        }
+        const Commit* ourCommit = findCommit(headCommitHash);
+        if (!ourCommit) {
+            std::cout << "Error: Cannot merge: No commits yet.\n";
+            return;
+        }
+        std::string notFound;
+        std::string theirHash = resolveCommitish(target, &notFound);
+        if (theirHash.empty()) {
+            if (!notFound.empty()) std::cerr << notFound << "\n";
+            std::cout << "Error: Branch or commit not found: " << target << "\n";
+            return;
+        }
+        const Commit* theirCommit = findCommit(theirHash);
+        if (!theirCommit) {
+            std::cerr << "Error: " << target << " points to a corrupt commit. Cannot merge.\n";
+            return;
+        }
+        StatusResult pending = getStatus();
+        if (!pending.clean()) {
+            std::cout << "Error: Your working directory has uncommitted changes. Please commit them before merging.\n";
+            return;
+        }
+
+        std::string baseHash = mergeBase(headCommitHash, theirHash);
+        if (baseHash == theirHash) {
+            std::cout << "Already up to date.\n";
+            return;
+        }
+        if (baseHash == headCommitHash) { // Nothing of ours to keep: move the branch forward
+            std::cout << "Fast-forward " << headCommitHash.substr(0, 7) << ".." << theirHash.substr(0, 7) << "\n";
+            headCommitHash = theirHash;
+            if (!headBranch.empty()) branches[headBranch] = theirHash;
+            saveHeadAndBranchRefs();
+            populateWorkingDirectory(ourCommit, *theirCommit);
+            stagingArea.clear();
+            writeIndex();
+            return;
+        }
+        const Commit* baseCommit = baseHash.empty() ? nullptr : findCommit(baseHash);
+        if (!baseHash.empty() && !baseCommit) {
+            std::cerr << "Error: Merge base " << baseHash.substr(0, 7) << " is corrupt. Cannot merge.\n";
+            return;
+        }
+
+        const std::string ourLabel = headBranch.empty() ? "HEAD" : headBranch;
+        MergeEngine engine(diffAlgorithm);
+        std::vector<std::string> conflicts;
+        bool failed = false;
+        for (const MergeChange& change : mergeChanges(baseCommit, *ourCommit, *theirCommit)) {
+            const std::string& path = change.path;
+            if (change.base == change.ours) { // Only they changed it: take their version
+                if (change.theirs.empty()) {
+                    std::error_code ec;
+                    fs::remove(path, ec);
+                    removeEmptyParents(path);
+                    std::cout << "Removed: " << path << "\n";
+                    continue;
+                }
+                MappedFile blob = mapBlob(change.theirs);
+                if (!blob.isOpen() || !writeMergedFile(path, blob.view(), change.theirs)) {
+                    std::cerr << "Error: Could not update " << path << "\n";
+                    failed = true;
+                    continue;
+                }
+                stagingArea[path] = change.theirs;
+                continue;
+            }
+            if (change.ours.empty() || change.theirs.empty()) { // Deleted on one side, modified on the other
+                std::cout << "CONFLICT (modify/delete): " << path << " deleted in "
+                          << (change.ours.empty() ? ourLabel + " and modified in " + target : target + " and modified in " + ourLabel) << "\n";
+                if (change.ours.empty()) {
+                    MappedFile blob = mapBlob(change.theirs);
+                    if (!blob.isOpen() || !writeMergedFile(path, blob.view(), change.theirs)) failed = true;
+                }
+                conflicts.push_back(path);
+                continue;
+            }
+            MappedFile baseBlob = change.base.empty() ? MappedFile() : mapBlob(change.base);
+            MappedFile ourBlob = mapBlob(change.ours);
+            MappedFile theirBlob = mapBlob(change.theirs);
+            if ((!change.base.empty() && !baseBlob.isOpen()) || !ourBlob.isOpen() || !theirBlob.isOpen()) {
+                std::cerr << "Error: Missing blob while merging " << path << "\n";
+                failed = true;
+                continue;
+            }
+            MergeEngine::Result merged = engine.merge(baseBlob.view(), ourBlob.view(), theirBlob.view(), ourLabel, target);
+            if (merged.binary) {
+                std::cout << "CONFLICT (binary): " << path << " changed on both sides (our version kept)\n";
+                conflicts.push_back(path);
+                continue;
+            }
+            if (merged.conflicts > 0) {
+                std::cout << "CONFLICT (content): Merge conflict in " << path << "\n";
+                if (!writeMergedFile(path, merged.text, "")) failed = true;
+                conflicts.push_back(path);
+                continue;
+            }
+            std::string hash = hashFileContent(merged.text);
+            if (!hasObject(hash)) saveBlob(hash, merged.text);
+            if (!writeMergedFile(path, merged.text, hash)) {
+                failed = true;
+                continue;
+            }
+            stagingArea[path] = hash;
+            std::cout << "Auto-merging " << path << "\n";
+        }
+        if (!flushObjects()) {
+            std::cerr << "Error: Could not write the merged objects.\n";
+            failed = true;
+        }
+
+        std::string mergeHead = theirHash + "\n";
+        for (const std::string& path : conflicts) mergeHead += path + "\n";
+        if (!RefStore::writeFileAtomic(MERGE_HEAD_PATH, mergeHead)) {
+            std::cerr << "Error: Could not write " << MERGE_HEAD_PATH << "\n";
+            failed = true;
+        }
+        writeIndex();
+        if (failed || !conflicts.empty()) {
+            std::cout << "Automatic merge failed; fix the conflicts, 'add' the files and then commit the result.\n";
+            return;
+        }
+        commit(branches.count(target) ? "Merge branch '" + target + "' into " + ourLabel
+                                      : "Merge commit " + theirHash.substr(0, 7) + " into " + ourLabel);
+    }
+
+    // Saves the staged changes, the unstaged changes and the untracked files on the stash stack, then resets the
+    // working directory and the staging area to HEAD. Only files that differ from HEAD are looked at again
+    // (status has just hashed them through the stat-cache) and only their blobs can be new.
+    void stash(const std::string& message = "") {
+        TRACE_SCOPE("stash");
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return;
+        }
+        if (fs::exists(MERGE_HEAD_PATH)) {
+            std::cout << "Error: A merge is in progress. Resolve its conflicts and commit first.\n";
+            return;
+        }
+        const Commit* headCommit = findCommit(headCommitHash);
+        if (!headCommit) {
+            std::cout << "Error: Cannot stash: No commits yet.\n";
+            return;
+        }
+        StatusResult pending = getStatus();
+        if (pending.clean()) {
+            std::cout << "No local changes to save.\n";
+            return;
+        }
+
+        // The working directory as a snapshot: HEAD, overlaid with the staged files and the changed working copies
+        const FileTable& headFiles = filesOf(*headCommit);
+        std::unordered_map<std::string, std::string> work = headFiles.toMap();
+        std::set<std::string> touched; // Paths that may differ from HEAD in the working directory
+        for (const auto& [path, blob] : stagingArea) {
+            if (fs::exists(path)) work[path] = blob;
+            else work.erase(path);
+            touched.insert(path);
+        }
+        for (const std::vector<std::string>* paths : {&pending.deleted, &pending.stagedDeleted}) {
+            for (const std::string& path : *paths) {
+                work.erase(path);
+                touched.insert(path);
+            }
+        }
+        std::vector<std::string> changed;
+        for (const std::vector<std::string>* paths : {&pending.modified, &pending.modifiedSinceStaged, &pending.untracked}) {
+            changed.insert(changed.end(), paths->begin(), paths->end());
+        }
+        std::vector<std::string> hashes = hashWorkingFiles(changed);
+        loadObjectCache();
+        for (size_t i = 0; i < changed.size(); ++i) {
+            const std::string& path = changed[i];
+            work[path] = hashes[i];
+            touched.insert(path);
+            if (hasObject(hashes[i])) continue;
+            MappedFile content = MappedFile::read(path);
+            if (!content.isOpen()) {
+                std::cerr << "Error: Could not read " << path << ". Nothing was stashed.\n";
+                return;
+            }
+            if (chunkThreshold > 0 && content.size() >= chunkThreshold) {
+                saveChunkedBlob(hashes[i], content.view());
+            } else {
+                saveBlob(hashes[i], content.view());
+            }
+        }
+
+        StashEntry entry;
+        entry.base = headCommitHash;
+        entry.indexTree = writeTree(stagingArea);
+        entry.workTree = writeTree(work);
+        const std::string where = headBranch.empty() ? "(no branch)" : headBranch;
+        entry.message = message.empty() ? "WIP on " + where + ": " + headCommitHash.substr(0, 7) + " " + headCommit->message
+                                        : "On " + where + ": " + message;
+        std::replace(entry.message.begin(), entry.message.end(), '\n', ' '); // One line per entry
+        std::vector<StashEntry> entries = readStash();
+        entries.insert(entries.begin(), entry);
+        // Objects are durable before the stash refers to them, and the stash before the working directory is reset
+        if (!flushObjects() || !writeStash(entries)) {
+            std::cerr << "Error: Could not save the stash. Nothing was changed.\n";
+            return;
+        }
+
+        for (const std::string& path : touched) {
+            const std::string headBlob = headFiles.blob(path);
+            auto current = work.find(path);
+            if (!headBlob.empty() && current != work.end() && current->second == headBlob) continue; // Already as in HEAD
+            if (!restoreWorkingFile(path, headBlob)) std::cerr << "Error: Could not reset " << path << "\n";
+        }
+        stagingArea.clear();
+        writeIndex();
+        std::cout << "Saved working directory and index state " << entry.message << "\n";
+    }
+
+    // Applies the newest stash entry to the working directory and the staging area, then drops it.
+    // On a HEAD other than the one it was saved on, the entry is applied as a three-way merge against its base
+    // (see mergeChanges()); if a path changed on both sides nothing is touched and the entry is kept.
+    void stashPop() {
+        TRACE_SCOPE("stash");
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return;
+        }
+        std::vector<StashEntry> entries = readStash();
+        if (entries.empty()) {
+            std::cout << "No stash entries found.\n";
+            return;
+        }
+        const StashEntry entry = entries.front();
+        const Commit* headCommit = findCommit(headCommitHash);
+        const Commit* baseCommit = findCommit(entry.base);
+        if (!headCommit || !baseCommit) {
+            std::cerr << "Error: Commit " << (baseCommit ? headCommitHash : entry.base).substr(0, 7)
+                      << " is missing or corrupt. Cannot apply the stash.\n";
+            return;
+        }
+        if (!getStatus().clean()) {
+            std::cout << "Error: Your working directory has uncommitted changes. Please commit or stash them before applying a stash.\n";
+            return;
+        }
+
+        Commit saved;
+        saved.treeHash = entry.workTree;
+        std::vector<MergeChange> changes = mergeChanges(baseCommit, *headCommit, saved);
+        std::unordered_map<std::string, std::string> staged;
+        flattenTree(entry.indexTree, "", staged);
+        if (entry.base != headCommitHash) {
+            bool conflicted = false;
+            for (const MergeChange& change : changes) {
+                if (change.base == change.ours) continue;
+                std::cout << "CONFLICT: " << change.path << " changed both in the stash and since " << entry.base.substr(0, 7) << "\n";
+                conflicted = true;
+            }
+            if (conflicted) {
+                std::cout << "Error: The stash was not applied and is kept. Commit or check out " << entry.base.substr(0, 7) << " first.\n";
+                return;
+            }
+            // Staged files that were as in the base would undo what HEAD changed since; only real changes stay staged
+            const FileTable& baseFiles = filesOf(*baseCommit);
+            for (auto it = staged.begin(); it != staged.end();) {
+                it = baseFiles.blob(it->first) == it->second ? staged.erase(it) : std::next(it);
+            }
+        }
+
+        bool ok = true;
+        for (const MergeChange& change : changes) {
+            if (!restoreWorkingFile(change.path, change.theirs)) {
+                std::cerr << "Error: Could not restore " << change.path << "\n";
+                ok = false;
+            } else if (change.theirs.empty()) {
+                std::cout << "Removed: " << change.path << "\n";
+            }
+        }
+        for (auto& [path, blob] : staged) stagingArea[path] = std::move(blob);
+        writeIndex();
+        if (!ok) {
+            std::cerr << "Error: The stash could not be applied completely and is kept.\n";
+            return;
+        }
+        entries.erase(entries.begin());
+        if (!writeStash(entries)) {
+            std::cerr << "Error: Could not update " << STASH_PATH << "; the applied entry is still listed.\n";
+            return;
+        }
+        std::cout << "Restored " << entry.message << "\n";
+        std::cout << "Dropped stash@{0} (" << entry.workTree.substr(0, 7) << ")\n";
+    }
+
+    // The stash stack, newest entry (stash@{0}) first.
+    std::vector<StashEntry> listStash() {
+        return readStash();
+    }
+
+    // Computes the current status of the repository (staged, unstaged, untracked files).
+    StatusResult getStatus() {
+        TRACE_SCOPE("status");
+        StatusResult result;
+        if (!fs::exists(".minigit")) return result;
+        result.branch = headBranch;
+        result.headCommit = headCommitHash;
+
+        const Commit* currentHeadCommit = findCommit(headCommitHash);
+        if (!headCommitHash.empty() && !currentHeadCommit) {
+            result.warnings.push_back("Warning: HEAD commit " + headCommitHash.substr(0, 7) + " not found/corrupt during status check.");
+        }
+
+        StagedChanges staged = getStagedChanges(currentHeadCommit);
+        result.stagedAdded = std::move(staged.added);
+        result.stagedModified = std::move(staged.modified);
+        result.stagedDeleted = std::move(staged.deleted);
+        WorkingDirChanges unstaged = getUnstagedChanges(currentHeadCommit);
+        result.modified = std::move(unstaged.modified);
+        result.modifiedSinceStaged = std::move(unstaged.modifiedSinceStaged);
+        result.deleted = std::move(unstaged.deleted);
+        result.untracked = std::move(unstaged.untracked);
+        std::vector<std::string> conflicts;
+        if (readMergeHead(result.mergeHead, conflicts)) {
+            for (const std::string& path : conflicts) {
+                if (!stagingArea.count(path) && fs::exists(path)) result.unmerged.push_back(path);
+            }
+        }
+        saveIndexIfDirty(); // Persist hashes computed during the scan for the next status
+        return result;
+    }
+
+    // Computes differences between two states and streams them file by file to 'visitor':
+    //   ("", "")              working directory vs staging area (unstaged changes)
+    //   ("--staged", "")      staging area vs HEAD commit (also "--cached")
+    //   (<commit>, "")        working directory vs a commit
+    //   (<commit>, <commit>)  two commits
+    // A <commit> is anything resolveCommitish() accepts.
+    DiffResult diff(const std::string& arg1, const std::string& arg2, DiffVisitor& visitor) {
+        TRACE_SCOPE("diff");
+        DiffResult result;
+        if (!fs::exists(".minigit")) {
+            result.error = "Not a MiniGit repository. Please run 'init' first.";
+            return result;
+        }
+        DiffEngine engine(diffAlgorithm, diffContextLines);
+        // Hands one changed file to the visitor; false once the visitor asked to stop.
+        auto visitFile = [&](const std::string& path, FileDiff::Kind kind, std::string_view oldContent, std::string_view newContent) {
+            TRACE_SCOPE("diffFile");
+            FileDiff file{path, kind};
+            ++result.filesChanged;
+            if (!visitor.fileStart(file)) return !(result.stopped = true);
+            for (const DiffEngine::Hunk& hunk : engine.diff(oldContent, newContent)) {
+                if (!visitor.hunk(file, hunk)) return !(result.stopped = true);
+            }
+            visitor.fileEnd(file);
+            return true;
+        };
+
+        // Scenario 1: diff working directory vs staging area (like 'git diff' without arguments)
+        if (arg1.empty() && arg2.empty()) {
+            visitor.begin(DiffMode::WorkingTreeVsIndex, "", "");
+            // Only files known to the staging area are compared; untracked files are ignored,
+            // mimicking `git diff`. Their hashes are computed in parallel, then diffs are visited in directory order.
+            std::vector<std::string> stagedWdFiles;
+            for (const std::string& filename : listWorkingFiles()) {
+                if (stagingArea.count(filename)) stagedWdFiles.push_back(filename);
+            }
+            std::vector<std::string> wdHashes = hashWorkingFiles(stagedWdFiles);
+            bool go = true;
+            for (size_t i = 0; go && i < stagedWdFiles.size(); ++i) {
+                const std::string& filename = stagedWdFiles[i];
+                const std::string& stagedBlobHash = stagingArea.at(filename);
+                if (wdHashes[i] == stagedBlobHash) {
+                    continue; // Unchanged: no need to read either side
+                }
+                MappedFile wdContent = MappedFile::read(filename);
+                MappedFile stagedContent = mapBlob(stagedBlobHash);
+                if (!sameContent(wdContent.view(), stagedContent.view())) {
+                    go = visitFile(filename, FileDiff::Kind::Modified, stagedContent.view(), wdContent.view());
+                }
+            }
+            // Files that were in staging but are no longer in WD (deleted)
+            std::vector<std::string> deletedFiles;
+            for (const auto& pair : stagingArea) {
+                if (!fs::exists(pair.first)) deletedFiles.push_back(pair.first);
+            }
+            std::sort(deletedFiles.begin(), deletedFiles.end());
+            for (size_t i = 0; go && i < deletedFiles.size(); ++i) {
+                go = visitFile(deletedFiles[i], FileDiff::Kind::Deleted, mapBlob(stagingArea.at(deletedFiles[i])).view(), "");
+            }
+            saveIndexIfDirty();
+        }
+        // Scenario 2: diff staging area vs HEAD commit (like 'git diff --staged' or 'git diff --cached')
+        else if (arg1 == "--staged" || arg1 == "--cached") {
+            if (headCommitHash.empty()) {
+                result.error = "No HEAD commit to compare against. Use `commit` first.";
+                return result;
+            }
+            const Commit* headCommitPtr = findCommit(headCommitHash);
+            if (!headCommitPtr) {
+                result.error = "Error: HEAD commit " + headCommitHash.substr(0, 7) + " not found or corrupt.";
+                return result;
+            }
+            visitor.begin(DiffMode::IndexVsHead, headCommitHash, "");
+            const FileTable& headFiles = filesOf(*headCommitPtr);
+
+            std::set<std::string> allFiles; // Sorted, so the output order is stable
+            for (const auto& pair : stagingArea) allFiles.insert(pair.first);
+            for (const auto& entry : headFiles) allFiles.insert(headFiles.path(entry));
+
+            bool go = true;
+            for (auto it = allFiles.begin(); go && it != allFiles.end(); ++it) {
+                const std::string& filename = *it;
+                bool inStaging = stagingArea.count(filename);
+                const std::string headBlobHash = headFiles.blob(filename);
+                bool inHead = !headBlobHash.empty();
+
+                if (inStaging && inHead) {
+                    const std::string& stagedBlobHash = stagingArea.at(filename);
+                    if (stagedBlobHash == headBlobHash) continue; // Same blob: neither side is read
+                    MappedFile stagedContent = mapBlob(stagedBlobHash);
+                    MappedFile headContent = mapBlob(headBlobHash);
+                    if (!sameContent(stagedContent.view(), headContent.view())) {
+                        go = visitFile(filename, FileDiff::Kind::Modified, headContent.view(), stagedContent.view());
+                    }
+                } else if (inHead && !inStaging) { // Deleted from staging
+                    go = visitFile(filename, FileDiff::Kind::Deleted, mapBlob(headBlobHash).view(), "");
+                } else if (!inHead && inStaging) { // Added to staging
+                    go = visitFile(filename, FileDiff::Kind::Added, "", mapBlob(stagingArea.at(filename)).view());
+                }
+            }
+        }
+        // Scenario 3: diff two commits (e.g., 'minigit diff <commit1> <commit2>')
+        else if (!arg1.empty() && !arg2.empty()) {
+            std::string notFound1, notFound2;
+            const Commit* c1Ptr = findCommit(resolveCommitish(arg1, &notFound1));
+            const Commit* c2Ptr = findCommit(resolveCommitish(arg2, &notFound2));
+
+            if (!c1Ptr) {
+                result.error = notFound1.empty() ? "Error: Commit " + arg1 + " not found or corrupt." : notFound1;
+                return result;
+            }
+            if (!c2Ptr) {
+                result.error = notFound2.empty() ? "Error: Commit " + arg2 + " not found or corrupt." : notFound2;
+                return result;
+            }
+            visitor.begin(DiffMode::CommitVsCommit, c1Ptr->hash, c2Ptr->hash);
+
+            // Only changed paths are visited: subtrees with equal hashes are skipped entirely. Both sides
+            // of every change are prefetched, so the blobs of later files load while earlier ones are diffed.
+            const std::vector<FileChange> changes = diffCommits(c1Ptr, c2Ptr);
+            std::vector<std::string> blobs;
+            for (const FileChange& change : changes) {
+                blobs.push_back(change.oldBlob);
+                blobs.push_back(change.newBlob);
+            }
+            std::unique_ptr<BlobPrefetcher> prefetch = prefetchBlobs(std::move(blobs));
+            for (const FileChange& change : changes) {
+                MappedFile oldContent = prefetch->next();
+                MappedFile newContent = prefetch->next();
+                bool go;
+                if (!change.oldBlob.empty() && !change.newBlob.empty()) {
+                    go = visitFile(change.path, FileDiff::Kind::Modified, oldContent.view(), newContent.view());
+                } else if (!change.oldBlob.empty()) {
+                    go = visitFile(change.path, FileDiff::Kind::Deleted, oldContent.view(), "");
+                } else {
+                    go = visitFile(change.path, FileDiff::Kind::Added, "", newContent.view());
+                }
+                if (!go) break;
+            }
+        }
+        // Scenario 4: diff working directory vs a specific commit (e.g., 'minigit diff <commit>')
+        else if (!arg1.empty() && arg2.empty()) {
+            std::string notFound;
+            const Commit* targetCommitPtr = findCommit(resolveCommitish(arg1, &notFound));
+            if (!targetCommitPtr) {
+                result.error = notFound.empty() ? "Error: Commit " + arg1 + " not found or corrupt." : notFound;
+                return result;
+            }
+            visitor.begin(DiffMode::WorkingTreeVsCommit, targetCommitPtr->hash, "");
+
+            const FileTable& targetFiles = filesOf(*targetCommitPtr);
+            std::set<std::string> allFiles; // Sorted, so the output order is stable
+            std::vector<std::string> wdFiles = listWorkingFiles();
+            allFiles.insert(wdFiles.begin(), wdFiles.end());
+            // Tracked files are hashed first (stat-cache, parallel), so unchanged ones are never read
+            std::vector<std::string> trackedWdFiles;
+            for (const std::string& filename : wdFiles) {
+                if (targetFiles.contains(filename)) trackedWdFiles.push_back(filename);
+            }
+            std::vector<std::string> trackedHashes = hashWorkingFiles(trackedWdFiles);
+            std::unordered_map<std::string, std::string> wdHashes;
+            for (size_t i = 0; i < trackedWdFiles.size(); ++i) wdHashes[trackedWdFiles[i]] = trackedHashes[i];
+            for (const auto& entry : targetFiles) {
+                allFiles.insert(targetFiles.path(entry));
+            }
+
+            bool go = true;
+            for (auto it = allFiles.begin(); go && it != allFiles.end(); ++it) {
+                const std::string& filename = *it;
+                bool inWD = fs::exists(filename) && fs::is_regular_file(filename);
+                const std::string commitBlobHash = targetFiles.blob(filename);
+                bool inCommit = !commitBlobHash.empty();
+
+                if (inWD && inCommit) {
+                    auto hashed = wdHashes.find(filename);
+                    if (hashed != wdHashes.end() && hashed->second == commitBlobHash) continue;
+                    MappedFile wdContent = MappedFile::read(filename);
+                    MappedFile commitContent = mapBlob(commitBlobHash);
+                    if (!sameContent(wdContent.view(), commitContent.view())) {
+                        go = visitFile(filename, FileDiff::Kind::Modified, commitContent.view(), wdContent.view());
+                    }
+                } else if (inCommit && !inWD) { // File deleted in WD
+                    go = visitFile(filename, FileDiff::Kind::Deleted, mapBlob(commitBlobHash).view(), "");
+                } else if (inWD && !inCommit) { // File added in WD (untracked from commit's perspective)
+                    go = visitFile(filename, FileDiff::Kind::Added, "", MappedFile::read(filename).view());
+                }
+            }
+            saveIndexIfDirty();
+        }
+        else {
+            result.error = "Error: diff expects no arguments, --staged, one commit, or two commits.";
+        }
+        return result;
+    }
+
+    // Upgrades the repository to the current format: loose objects and commits move into fanout directories.
+    // Safe to interrupt; running it again finishes the move.
+    void upgrade() {
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return;
+        }
+        if (repoFormatVersion > REPO_FORMAT_VERSION) {
+            std::cout << "Error: Repository format " << repoFormatVersion << " is newer than this MiniGit supports.\n";
+            return;
+        }
+        if (repoFormatVersion >= 5 && !fanoutMigrationPending) {
+            std::cout << "Repository already uses format " << repoFormatVersion << ".\n";
+            return;
+        }
+        size_t moved = migrateToFanout();
+        std::cout << "Upgraded repository to format " << repoFormatVersion << ": moved " << moved
+                  << " loose files into fanout directories.\n";
+    }
+
+    // Packs every object (loose objects and existing packs) into one delta-compressed packfile
+    // in .minigit/objects/pack and removes what it replaced, then rewrites the commit-graph. Versions of the same path are
+    // packed next to each other so they can be stored as deltas of one another.
+    void gc() {
+        if (!fs::exists(".minigit")) {
+            std::cout << "Not a MiniGit repository. Please run 'init' first.\n";
+            return;
+        }
+        if (fanoutMigrationPending) migrateToFanout(); // Every loose file must be at its fanout path before packing
+        fs::create_directories(".minigit/objects/pack");
+        loadPacks();
+
+        // Chunk manifests stay loose (they are small, and packing them whole would undo the dedup);
+        // their chunks are packed like any other object.
+        std::vector<std::string> looseObjects;
+        for (std::string& name : listStore(".minigit/objects")) {
+            MappedFile object = openStoreFile(".minigit/objects", name);
+            if (object.view().substr(0, CHUNK_MANIFEST_MAGIC.size()) == CHUNK_MANIFEST_MAGIC) continue;
+            looseObjects.push_back(std::move(name));
+        }
+        if (looseObjects.empty() && packs.size() <= 1) {
+            std::cout << "Nothing to pack.\n";
+            return;
+        }
+
+        // Path of each object as a delta hint: blobs by file path, trees by directory.
+        std::unordered_map<std::string, std::string> hints;
+        std::unordered_set<std::string> visitedTrees;
+        std::function<void(const std::string&, const std::string&)> hintTree = [&](const std::string& treeHash, const std::string& prefix) {
+            if (!visitedTrees.insert(treeHash).second) return;
+            if (!objectSourcePath.empty() && !hasObject(treeHash)) return; // Omitted by a partial clone: not fetched for a hint
+            hints.emplace(treeHash, "tree:" + prefix);
+            for (const TreeEntry& entry : loadTree(treeHash)) {
+                if (entry.isTree) hintTree(entry.hash, prefix + entry.name + "/");
+                else hints.emplace(entry.hash, prefix + entry.name);
+            }
+        };
+        for (const std::string& hash : listStore(".minigit/commits")) {
+            const Commit* c = findCommit(hash);
+            if (!c) continue;
+            if (!c->treeHash.empty()) hintTree(c->treeHash, "");
+            else {
+                const FileTable& files = filesOf(*c);
+                for (const auto& entry : files) hints.emplace(entry.blob.toString(), files.path(entry));
+            }
+        }
+        for (const StashEntry& entry : readStash()) {
+            hintTree(entry.workTree, "");
+            hintTree(entry.indexTree, "");
+        }
+        for (const auto& [path, blob] : stagingArea) hints.emplace(blob, path);
+
+        std::vector<PackFile::Input> inputs;
+        for (const std::string& name : looseObjects) inputs.push_back({name, hints.count(name) ? hints[name] : ""});
+        for (const auto& pack : packs) {
+            for (std::string& name : pack->names()) inputs.push_back({name, hints.count(name) ? hints[name] : ""});
+        }
+
+        std::vector<std::string> sortedNames;
+        for (const PackFile::Input& input : inputs) sortedNames.push_back(input.name);
+        std::sort(sortedNames.begin(), sortedNames.end());
+        std::string packId;
+        for (const std::string& name : sortedNames) packId += name + "\n";
+        const std::string packBase = ".minigit/objects/pack/pack-" + hashFileContent(packId);
+
+        PackFile::WriteStats stats;
+        auto loadObject = [this](const std::string& hash, std::string& content) {
+            MappedFile object = mapBlob(hash);
+            if (!object.isOpen()) {
+                std::cerr << "Error: Object " << hash << " could not be read.\n";
+                return false;
+            }
+            content.assign(object.view());
+            return true;
+        };
+        if (!PackFile::write(packBase + ".pack", packBase + ".idx", std::move(inputs), loadObject, stats)) {
+            std::cerr << "Error: Could not write pack " << packBase << ".pack\n";
+            return;
+        }
+        // Nothing it replaces may be deleted before the pack, its index and their directory entries are on disk
+        if (!objectWriter.sync({packBase + ".pack", packBase + ".idx", ".minigit/objects/pack"})) {
+            std::cerr << "Error: Could not sync pack " << packBase << ".pack; keeping the loose objects and old packs.\n";
+            return;
+        }
+
+        // The new pack holds everything: drop the old packs and loose copies.
+        packs.clear();
+        packsLoaded = false;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(".minigit/objects/pack")) {
+            std::string path = entry.path().generic_string();
+            if (path != packBase + ".pack" && path != packBase + ".idx") fs::remove(entry.path(), ec);
+        }
+        std::set<fs::path> fanoutDirs;
+        for (const std::string& name : looseObjects) {
+            fs::path path = objectPath(name);
+            if (fs::remove(path, ec) && path.parent_path() != ".minigit/objects") fanoutDirs.insert(path.parent_path());
+        }
+        for (const fs::path& dir : fanoutDirs) {
+            if (fs::is_empty(dir, ec)) fs::remove(dir, ec); // rmdir: fails (keeps it) if an object was added meanwhile
+        }
+        objectWriter.forgetDirectories(); // Some it created may be gone now
+        objectWriter.removeStaleTemporaries(); // Left behind by commands that crashed mid-write
+        rebuildObjectFilter();
+
+        writeCommitGraph(allCommitGraphEntries()); // Also picks up commits made by older MiniGit versions
+        if (!refStore.packLooseRefs()) std::cerr << "Warning: Could not write .minigit/packed-refs\n";
+
+        if (repoFormatVersion < 3) { // Packs (and compressed loose objects from now on) need format 3
+            repoFormatVersion = 3;
+            writeRepoConfig();
+        }
+        std::cout << "Packed " << stats.objects << " objects (" << stats.deltas << " as deltas): "
+                  << stats.rawBytes << " bytes -> " << stats.packedBytes << " bytes\n";
+    }
+};
+
 #endif // MINIGIT_SYSTEM_HPP
\ No newline at end of file
@@ -0,0 +1,238 @@
+#ifndef OBJECT_FORMAT_HPP
+#define OBJECT_FORMAT_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Encoding.hpp"
+
+// Binary encodings of commit and tree objects (repository format 4).
+//
+// Commit: "MGCO", u8 version, then length-prefixed fields: message, timestamp, tree hash,
+//         varint parent count + parent hashes, then a sorted table of (path, blob hash) records
+//         (only used by flat-table commits converted from before tree objects existed).
+// Tree:   "MGTR", u8 version, then a sorted table of (u8 kind, hash, name) records; kind 0 = blob, 1 = tree.
+// Sorted table: varint count, count u32 offsets of the records (relative to the end of the offsets),
+//               then the records. The offsets make the table binary-searchable without parsing it.
+//
+// Lengths are varints and strings are raw bytes, so messages and names may contain newlines or ':'.
+// The views below only point into the encoded buffer (e.g. a MappedFile); nothing is copied.
+
+namespace object_format_detail {
+
+    inline void putString(std::string& out, std::string_view value) {
+        putVarint(out, value.size());
+        out.append(value.data(), value.size());
+    }
+
+    inline bool getString(std::string_view in, size_t& pos, std::string_view& value) {
+        uint64_t length;
+        if (!getVarint(in, pos, length) || length > in.size() - pos) return false;
+        value = in.substr(pos, static_cast<size_t>(length));
+        pos += static_cast<size_t>(length);
+        return true;
+    }
+
+    // Appends a sorted table whose records were encoded separately.
+    inline void putTable(std::string& out, const std::vector<std::string>& records) {
+        putVarint(out, records.size());
+        uint32_t offset = 0;
+        for (const std::string& record : records) {
+            for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((offset >> (8 * i)) & 0xff));
+            offset += static_cast<uint32_t>(record.size());
+        }
+        for (const std::string& record : records) out += record;
+    }
+
+    // Random access into a table written by putTable().
+    class Table {
+    public:
+        // Reads the table header at 'pos' and moves 'pos' past the whole table.
+        bool parse(std::string_view data, size_t& pos) {
+            uint64_t entries;
+            if (!getVarint(data, pos, entries) || entries > (data.size() - pos) / 4) return false;
+            count = static_cast<size_t>(entries);
+            offsets = data.data() + pos;
+            records = data.substr(pos + 4 * count);
+            for (size_t i = 0; i < count; ++i) {
+                if (offsetAt(i) > records.size() || (i > 0 && offsetAt(i) < offsetAt(i - 1))) return false;
+            }
+            pos = data.size(); // Tables are always the last part of an object
+            return true;
+        }
+
+        size_t size() const { return count; }
+
+        // The bytes of record i.
+        std::string_view record(size_t i) const {
+            size_t begin = offsetAt(i);
+            size_t end = i + 1 < count ? offsetAt(i + 1) : records.size();
+            return records.substr(begin, end - begin);
+        }
+
+    private:
+        const char* offsets = nullptr;
+        std::string_view records;
+        size_t count = 0;
+
+        size_t offsetAt(size_t i) const {
+            uint32_t value = 0;
+            for (int b = 0; b < 4; ++b) value |= static_cast<uint32_t>(static_cast<uint8_t>(offsets[4 * i + b])) << (8 * b);
+            return value;
+        }
+    };
+
+    inline bool hasMagic(std::string_view data, std::string_view magic, uint8_t version) {
+        return data.size() > magic.size() && data.substr(0, magic.size()) == magic &&
+               static_cast<uint8_t>(data[magic.size()]) == version;
+    }
+
+} // namespace object_format_detail
+
+class TreeView {
+public:
+    static constexpr std::string_view MAGIC = "MGTR";
+    static constexpr uint8_t VERSION = 1;
+
+    struct Entry {
+        bool isTree = false;
+        std::string_view hash;
+        std::string_view name;
+    };
+
+    static bool isBinary(std::string_view data) { return data.substr(0, MAGIC.size()) == MAGIC; }
+
+    // 'entries' must be sorted by name.
+    static std::string encode(const std::vector<Entry>& entries) {
+        using namespace object_format_detail;
+        std::vector<std::string> records;
+        records.reserve(entries.size());
+        for (const Entry& entry : entries) {
+            std::string record(1, static_cast<char>(entry.isTree ? 1 : 0));
+            putString(record, entry.hash);
+            putString(record, entry.name);
+            records.push_back(std::move(record));
+        }
+        std::string out(MAGIC);
+        out.push_back(static_cast<char>(VERSION));
+        putTable(out, records);
+        return out;
+    }
+
+    bool parse(std::string_view data) {
+        if (!object_format_detail::hasMagic(data, MAGIC, VERSION)) return false;
+        size_t pos = MAGIC.size() + 1;
+        return table.parse(data, pos);
+    }
+
+    size_t size() const { return table.size(); }
+
+    bool entry(size_t i, Entry& out) const {
+        std::string_view record = table.record(i);
+        if (record.empty()) return false;
+        size_t pos = 1;
+        out.isTree = record[0] == 1;
+        return object_format_detail::getString(record, pos, out.hash) && object_format_detail::getString(record, pos, out.name);
+    }
+
+    // Binary search by entry name.
+    bool find(std::string_view name, Entry& out) const {
+        size_t lo = 0, hi = table.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (!entry(mid, out)) return false;
+            int order = out.name.compare(name);
+            if (order == 0) return true;
+            if (order < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        return false;
+    }
+
+private:
+    object_format_detail::Table table;
+};
+
+class CommitView {
+public:
+    static constexpr std::string_view MAGIC = "MGCO";
+    static constexpr uint8_t VERSION = 1;
+
+    std::string_view message;
+    std::string_view timestamp;
+    std::string_view tree;
+    std::vector<std::string_view> parents;
+
+    static bool isBinary(std::string_view data) { return data.substr(0, MAGIC.size()) == MAGIC; }
+
+    // 'files' (path, blob hash) must be sorted by path; it is empty for commits that have a tree.
+    static std::string encode(std::string_view message, std::string_view timestamp, std::string_view tree,
+                              const std::vector<std::string>& parents,
+                              const std::vector<std::pair<std::string_view, std::string_view>>& files) {
+        using namespace object_format_detail;
+        std::string out(MAGIC);
+        out.push_back(static_cast<char>(VERSION));
+        putString(out, message);
+        putString(out, timestamp);
+        putString(out, tree);
+        putVarint(out, parents.size());
+        for (const std::string& parent : parents) putString(out, parent);
+        std::vector<std::string> records;
+        records.reserve(files.size());
+        for (const auto& [path, blob] : files) {
+            std::string record;
+            putString(record, path);
+            putString(record, blob);
+            records.push_back(std::move(record));
+        }
+        putTable(out, records);
+        return out;
+    }
+
+    bool parse(std::string_view data) {
+        using namespace object_format_detail;
+        if (!hasMagic(data, MAGIC, VERSION)) return false;
+        size_t pos = MAGIC.size() + 1;
+        uint64_t parentCount;
+        if (!getString(data, pos, message) || !getString(data, pos, timestamp) || !getString(data, pos, tree) ||
+            !getVarint(data, pos, parentCount) || parentCount > data.size() - pos) {
+            return false;
+        }
+        parents.resize(static_cast<size_t>(parentCount));
+        for (std::string_view& parent : parents) {
+            if (!getString(data, pos, parent)) return false;
+        }
+        return files.parse(data, pos);
+    }
+
+    size_t fileCount() const { return files.size(); }
+
+    bool file(size_t i, std::string_view& path, std::string_view& blob) const {
+        std::string_view record = files.record(i);
+        size_t pos = 0;
+        return object_format_detail::getString(record, pos, path) && object_format_detail::getString(record, pos, blob);
+    }
+
+    // Binary search of the file table by path.
+    bool findFile(std::string_view path, std::string_view& blob) const {
+        size_t lo = 0, hi = files.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            std::string_view midPath;
+            if (!file(mid, midPath, blob)) return false;
+            int order = midPath.compare(path);
+            if (order == 0) return true;
+            if (order < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        return false;
+    }
+
+private:
+    object_format_detail::Table files;
+};
+
+#endif // OBJECT_FORMAT_HPP
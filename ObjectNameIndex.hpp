@@ -0,0 +1,56 @@
+#ifndef OBJECT_NAME_INDEX_HPP
+#define OBJECT_NAME_INDEX_HPP
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sorted array of object IDs for resolving abbreviated names.
+// IDs that share a prefix are adjacent, so a prefix lookup is one binary search (O(log n))
+// plus a look at the next entry to tell a unique match from an ambiguous one.
+class ObjectNameIndex {
+public:
+    enum class Match { None, Unique, Ambiguous };
+
+    void assign(std::vector<std::string> ids) {
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        sorted = std::move(ids);
+    }
+
+    void insert(const std::string& id) {
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), id);
+        if (it == sorted.end() || *it != id) sorted.insert(it, id);
+    }
+
+    size_t size() const { return sorted.size(); }
+
+    // Finds the IDs starting with 'prefix'. An exact ID always matches uniquely, even if it is
+    // also a prefix of longer IDs. On Ambiguous, 'candidates' (if given) receives up to maxCandidates matches.
+    Match lookup(std::string_view prefix, std::string& id, std::vector<std::string>* candidates = nullptr,
+                 size_t maxCandidates = 8) const {
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), prefix,
+                                   [](const std::string& a, std::string_view b) { return std::string_view(a) < b; });
+        if (it == sorted.end() || !startsWith(*it, prefix)) return Match::None;
+        if (it->size() == prefix.size() || it + 1 == sorted.end() || !startsWith(*(it + 1), prefix)) {
+            id = *it;
+            return Match::Unique;
+        }
+        if (candidates) {
+            for (; it != sorted.end() && startsWith(*it, prefix) && candidates->size() < maxCandidates; ++it) {
+                candidates->push_back(*it);
+            }
+        }
+        return Match::Ambiguous;
+    }
+
+private:
+    std::vector<std::string> sorted;
+
+    static bool startsWith(const std::string& value, std::string_view prefix) {
+        return value.size() >= prefix.size() && std::string_view(value).substr(0, prefix.size()) == prefix;
+    }
+};
+
+#endif // OBJECT_NAME_INDEX_HPP
@@ -0,0 +1,75 @@
+#ifndef OBJECT_SOURCE_HPP
+#define OBJECT_SOURCE_HPP
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "PackFile.hpp"
+
+// Read-only view of another repository's stores: the object source a partial clone fetches the
+// commits and objects it omitted from (see MiniGitSystem::clone()). The source is any path the
+// process can read, e.g. a network mount of the upstream repository.
+// Loose files are looked up at their fanout and at their flat path, so the source may be in any format
+// (or in the middle of an 'upgrade'). Every method is thread-safe once open() has run.
+class ObjectSource {
+public:
+    // Opens the repository whose working tree is 'repositoryPath'. Returns false if it has no object store.
+    bool open(const std::string& repositoryPath) {
+        namespace fs = std::filesystem;
+        root = (fs::path(repositoryPath) / ".minigit").generic_string();
+        packs.clear();
+        std::error_code ec;
+        if (!fs::is_directory(root + "/objects", ec) || !fs::is_directory(root + "/commits", ec)) {
+            root.clear();
+            return false;
+        }
+        for (auto it = fs::directory_iterator(root + "/objects/pack", ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+            if (it->path().extension() != ".idx") continue;
+            fs::path packPath = it->path();
+            packPath.replace_extension(".pack");
+            auto pack = std::make_unique<PackFile>();
+            if (pack->open(packPath.string(), it->path().string())) packs.push_back(std::move(pack));
+        }
+        return true;
+    }
+
+    bool isOpen() const { return !root.empty(); }
+    const std::string& directory() const { return root; } // The source's .minigit directory
+
+    // The stored (possibly compressed or chunked) loose object; not open if it is not loose.
+    MappedFile looseObject(const std::string& hash) const { return openStoreFile("objects", hash); }
+    MappedFile commitFile(const std::string& hash) const { return openStoreFile("commits", hash); }
+
+    // Reads and resolves a packed object.
+    bool packedObject(const std::string& hash, std::string& content) const {
+        for (const auto& pack : packs) {
+            if (pack->read(hash, content)) return true;
+        }
+        return false;
+    }
+
+    std::vector<std::string> packedNames() const {
+        std::vector<std::string> names;
+        for (const auto& pack : packs) {
+            for (std::string& name : pack->names()) names.push_back(std::move(name));
+        }
+        return names;
+    }
+
+private:
+    std::string root;
+    std::vector<std::unique_ptr<PackFile>> packs;
+
+    MappedFile openStoreFile(const std::string& dir, const std::string& hash) const {
+        MappedFile file;
+        if (hash.size() > 2 && file.open(root + "/" + dir + "/" + hash.substr(0, 2) + "/" + hash.substr(2))) return file;
+        file.open(root + "/" + dir + "/" + hash);
+        return file;
+    }
+};
+
+#endif // OBJECT_SOURCE_HPP
@@ -0,0 +1,213 @@
+#ifndef OBJECT_WRITER_HPP
+#define OBJECT_WRITER_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>  // For open()
+#include <signal.h> // For kill()
+#include <unistd.h> // For fsync(), syncfs(), getpid()
+#endif
+
+// Crash-safe writes of immutable objects (blobs, trees, commits).
+// stage() writes the object to a temporary file in <repo>/tmp; flush() makes every staged file durable
+// with one sync and only then renames them to their final paths. An object is therefore never visible
+// under its name before its content is on disk: a crash leaves whole objects or stray temporary files
+// (removed by gc), never a truncated object that readers would take for valid content.
+//
+// The sync is a single syncfs() of the repository's filesystem on Linux (at most one per flush) and one
+// fsync per staged file elsewhere. fsync of a file does not persist its directory entry, so after the renames
+// flush() fsyncs each directory they touched as well; only then does the caller update the ref that publishes
+// a commit, and a ref never survives a crash that lost the objects it points to.
+//
+// stage() and isStaged() may be called from several threads.
+class ObjectWriter {
+public:
+    explicit ObjectWriter(std::string repoDir = ".minigit") : root(std::move(repoDir)) {}
+    ObjectWriter(const ObjectWriter&) = delete;
+    ObjectWriter& operator=(const ObjectWriter&) = delete;
+    ~ObjectWriter() { flush(); } // Whatever is still staged is published, never dropped
+
+    // Writes 'header' + 'content' to a temporary file that flush() will move to 'path'.
+    bool stage(const std::string& path, std::string_view header, std::string_view content) {
+        std::string temp;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (staged.count(path)) return true; // Objects are immutable: the same path has the same content
+            temp = tempDir() + "/" + std::to_string(processId()) + "-" + std::to_string(nextTempId());
+        }
+        if (!ensureDirectory(tempDir()) || !ensureDirectory(std::filesystem::path(path).parent_path().string())) return false;
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        out.close();
+        if (!out) {
+            std::remove(temp.c_str());
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!staged.insert(path).second) { // Another thread staged it meanwhile
+            std::remove(temp.c_str());
+            return true;
+        }
+        pending.push_back({path, temp});
+        return true;
+    }
+
+    // True if 'path' was staged and not yet flushed (it does not exist on disk yet).
+    bool isStaged(const std::string& path) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return staged.count(path) != 0;
+    }
+
+    // Syncs every staged file, renames them into place and syncs the directories the renames touched;
+    // 'published' (if given) receives the paths that were moved. Returns false if a file could not be synced
+    // or moved (those objects stay unpublished, their temporary files are removed) or the directories could
+    // not be synced.
+    bool flush(std::vector<std::string>* published = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.empty()) return true;
+        std::vector<std::string> temps;
+        for (const Pending& object : pending) temps.push_back(object.temp);
+        bool ok = sync(temps);
+        std::unordered_set<std::string> touched{tempDir()}; // Directories are fsync'ed one by one, not with a second syncfs()
+        for (const Pending& object : pending) {
+            if (ok && std::rename(object.temp.c_str(), object.path.c_str()) == 0) {
+                touched.insert(std::filesystem::path(object.path).parent_path().string());
+                if (published) published->push_back(object.path);
+                continue;
+            }
+            std::remove(object.temp.c_str());
+            ok = false;
+        }
+        pending.clear();
+        staged.clear();
+        return syncEach(std::vector<std::string>(touched.begin(), touched.end())) && ok;
+    }
+
+    // Makes files written outside stage() durable, e.g. packs (used by gc before it deletes what they replace).
+    // 'paths' may name directories as well, so new or renamed entries in them are persisted too.
+    // One syncfs() of the repository's filesystem on Linux, one fsync per path elsewhere.
+    bool sync(const std::vector<std::string>& paths) const {
+#if defined(__linux__)
+        (void)paths;
+        int fd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) return false;
+        bool ok = ::syncfs(fd) == 0;
+        ::close(fd);
+        return ok;
+#else
+        return syncEach(paths);
+#endif
+    }
+
+    // Drops the cache of directories known to exist, after someone else removed some (e.g. gc's empty fanout directories).
+    void forgetDirectories() {
+        std::lock_guard<std::mutex> lock(mutex);
+        directories.clear();
+    }
+
+    // Removes temporary files left behind by processes that crashed before flush() (used by gc): those whose
+    // writer (the <pid> of their <pid>-<n> name) is no longer running, and any older than STALE_AGE, in case
+    // the pid was reused or belongs to another host. Temporaries of live writers are kept.
+    void removeStaleTemporaries() const {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        const auto now = fs::file_time_type::clock::now();
+        for (auto it = fs::directory_iterator(tempDir(), ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+            std::error_code entryError;
+            auto written = fs::last_write_time(it->path(), entryError);
+            if (entryError) continue; // Already renamed or removed by its writer
+            if (now - written > STALE_AGE || writerGone(it->path().filename().string())) fs::remove(it->path(), entryError);
+        }
+    }
+
+private:
+    static constexpr std::chrono::hours STALE_AGE{24}; // No write takes longer than this
+
+    struct Pending {
+        std::string path; // Final object path
+        std::string temp;
+    };
+
+    std::string root;
+    mutable std::mutex mutex;
+    std::vector<Pending> pending;
+    std::unordered_set<std::string> staged;
+    std::unordered_set<std::string> directories; // Directories known to exist (e.g. object fanout directories)
+
+    std::string tempDir() const { return root + "/tmp"; } // Same filesystem as the objects, so rename() is atomic
+
+    bool ensureDirectory(const std::string& dir) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (dir.empty() || directories.count(dir)) return true;
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        directories.insert(dir);
+        return true;
+    }
+
+    // One fsync per path (files or directories).
+    static bool syncEach(const std::vector<std::string>& paths) {
+#if !defined(_WIN32)
+        bool ok = true;
+        for (const std::string& path : paths) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0 || ::fsync(fd) != 0) ok = false;
+            if (fd >= 0) ::close(fd);
+        }
+        return ok;
+#else
+        (void)paths;
+        return true; // Writes are flushed by the stream; no portable way to force them to disk
+#endif
+    }
+
+    // Shared by every ObjectWriter of the process (e.g. the main one and the object source fetch path),
+    // so their <pid>-<n> temporary names never collide.
+    static uint64_t nextTempId() {
+        static std::atomic<uint64_t> next{0};
+        return next++;
+    }
+
+    static long processId() {
+#ifndef _WIN32
+        return static_cast<long>(::getpid());
+#else
+        return 0;
+#endif
+    }
+
+    // True if the process that wrote the temporary file 'name' has exited (or the name is not one of ours).
+    // Windows names carry no pid, so there only the age check applies.
+    static bool writerGone(const std::string& name) {
+#ifndef _WIN32
+        char* end = nullptr;
+        long pid = std::strtol(name.c_str(), &end, 10);
+        if (end == name.c_str() || *end != '-' || pid <= 0) return true;
+        return ::kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH; // EPERM: running as another user
+#else
+        (void)name;
+        return false;
+#endif
+    }
+};
+
+#endif // OBJECT_WRITER_HPP
@@ -0,0 +1,249 @@
+#ifndef PACK_FILE_HPP
+#define PACK_FILE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Compression.hpp"
+#include "Encoding.hpp"
+#include "MappedFile.hpp"
+
+// Packfile: many objects in one file instead of one file (and inode) per object.
+//
+// pack-<id>.pack:  "MGPK", u32 version, u32 count, then for every object:
+//                  u8 kind (0 = whole, 1 = delta), [u64 base object offset if delta],
+//                  u64 payload length, payload (a Compression.hpp envelope of the content or the delta)
+// pack-<id>.idx:   "MGPI", u32 version, u32 count, then count records of
+//                  {u64 pack offset, u32 name offset, u32 name length} sorted by name,
+//                  followed by the concatenated names. Lookups binary-search the records: O(log n).
+//
+// All integers are little-endian. Delta bases always precede the objects that use them.
+class PackFile {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t DELTA_WINDOW = 10;    // Recent objects tried as delta bases
+    static constexpr size_t MAX_DELTA_DEPTH = 10; // Longest chain of deltas a read has to resolve
+
+    struct Input {
+        std::string name;
+        std::string deltaHint; // Objects with equal hints (e.g. the same path) are packed next to each other
+    };
+
+    struct WriteStats {
+        size_t objects = 0;
+        size_t deltas = 0;
+        uint64_t rawBytes = 0;
+        uint64_t packedBytes = 0;
+    };
+
+    // Maps a pack and its index. Returns false if either is missing or malformed.
+    bool open(const std::string& packPath, const std::string& idxPath) {
+        if (!pack.open(packPath) || !index.open(idxPath)) return false;
+        std::string_view packData = pack.view(), indexData = index.view();
+        if (packData.size() < 12 || packData.substr(0, 4) != "MGPK" || indexData.size() < 12 || indexData.substr(0, 4) != "MGPI") {
+            return false;
+        }
+        if (readLE<uint32_t>(packData.data() + 4) != VERSION || readLE<uint32_t>(indexData.data() + 4) != VERSION) return false;
+        count = readLE<uint32_t>(indexData.data() + 8);
+        if (readLE<uint32_t>(packData.data() + 8) != count) return false;
+        if (indexData.size() < 12 + static_cast<size_t>(count) * RECORD_SIZE) return false;
+        namesStart = 12 + static_cast<size_t>(count) * RECORD_SIZE;
+        for (uint32_t i = 0; i < count; ++i) {
+            const char* record = recordAt(i);
+            if (readLE<uint64_t>(record) >= packData.size()) return false;
+            if (static_cast<size_t>(readLE<uint32_t>(record + 8)) + readLE<uint32_t>(record + 12) > indexData.size() - namesStart) return false;
+        }
+        return true;
+    }
+
+    size_t objectCount() const { return count; }
+
+    bool contains(const std::string& name) const {
+        uint64_t offset;
+        return findOffset(name, offset);
+    }
+
+    // Reads and fully resolves (decompresses, applies deltas) one object.
+    bool read(const std::string& name, std::string& content) const {
+        uint64_t offset;
+        return findOffset(name, offset) && readAt(offset, content, 0);
+    }
+
+    // Names of every object in the pack, in index (sorted) order.
+    std::vector<std::string> names() const {
+        std::vector<std::string> result;
+        result.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) result.emplace_back(nameAt(i));
+        return result;
+    }
+
+    // Writes 'objects' to packPath/idxPath. load(name, content) supplies each object's content.
+    // Objects are delta-compressed against up to DELTA_WINDOW preceding objects with the same hint.
+    // Both files are written under temporary names and renamed into place, index last,
+    // so a reader never sees an index without a complete pack.
+    static bool write(const std::string& packPath, const std::string& idxPath, std::vector<Input> objects,
+                      const std::function<bool(const std::string&, std::string&)>& load, WriteStats& stats) {
+        std::sort(objects.begin(), objects.end(), [](const Input& a, const Input& b) {
+            return a.deltaHint != b.deltaHint ? a.deltaHint < b.deltaHint : a.name < b.name;
+        });
+        objects.erase(std::unique(objects.begin(), objects.end(), [](const Input& a, const Input& b) { return a.name == b.name; }),
+                      objects.end());
+
+        std::string packTemp = packPath + ".tmp";
+        std::ofstream out(packTemp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out.write("MGPK", 4);
+        writeLE(out, VERSION);
+        writeLE(out, static_cast<uint32_t>(objects.size()));
+        uint64_t offset = 12;
+
+        struct WindowEntry {
+            std::string hint;
+            std::string content;
+            uint64_t offset;
+            size_t depth;
+        };
+        std::vector<WindowEntry> window;
+        std::vector<std::pair<std::string, uint64_t>> offsets;
+        offsets.reserve(objects.size());
+
+        for (const Input& object : objects) {
+            std::string content;
+            if (!load(object.name, content)) {
+                out.close();
+                std::remove(packTemp.c_str());
+                return false;
+            }
+            std::string payload = encodeEnvelope(content);
+            const size_t wholeSize = payload.size();
+            const WindowEntry* base = nullptr;
+            for (const WindowEntry& candidate : window) {
+                if (candidate.hint != object.deltaHint || candidate.depth >= MAX_DELTA_DEPTH) continue;
+                if (candidate.content.size() / 2 > content.size() || content.size() / 2 > candidate.content.size()) continue;
+                std::string deltaPayload = encodeEnvelope(encodeDelta(candidate.content, content));
+                if (deltaPayload.size() < wholeSize / 2 && deltaPayload.size() < payload.size()) { // Only worthwhile deltas
+                    payload = std::move(deltaPayload);
+                    base = &candidate;
+                }
+            }
+
+            offsets.emplace_back(object.name, offset);
+            out.put(static_cast<char>(base ? 1 : 0));
+            offset += 1;
+            if (base) {
+                writeLE(out, base->offset);
+                offset += 8;
+                ++stats.deltas;
+            }
+            writeLE(out, static_cast<uint64_t>(payload.size()));
+            out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+            offset += 8 + payload.size();
+            ++stats.objects;
+            stats.rawBytes += content.size();
+
+            size_t depth = base ? base->depth + 1 : 0;
+            if (window.size() == DELTA_WINDOW) window.erase(window.begin());
+            window.push_back({object.deltaHint, std::move(content), offsets.back().second, depth});
+        }
+        out.close();
+        if (!out) {
+            std::remove(packTemp.c_str());
+            return false;
+        }
+        stats.packedBytes = offset;
+
+        std::sort(offsets.begin(), offsets.end());
+        std::string idxTemp = idxPath + ".tmp";
+        std::ofstream idx(idxTemp, std::ios::binary | std::ios::trunc);
+        if (!idx.is_open()) {
+            std::remove(packTemp.c_str());
+            return false;
+        }
+        idx.write("MGPI", 4);
+        writeLE(idx, VERSION);
+        writeLE(idx, static_cast<uint32_t>(offsets.size()));
+        uint32_t nameOffset = 0;
+        for (const auto& [name, packOffset] : offsets) {
+            writeLE(idx, packOffset);
+            writeLE(idx, nameOffset);
+            writeLE(idx, static_cast<uint32_t>(name.size()));
+            nameOffset += static_cast<uint32_t>(name.size());
+        }
+        for (const auto& entry : offsets) idx.write(entry.first.data(), static_cast<std::streamsize>(entry.first.size()));
+        idx.close();
+        if (!idx || std::rename(packTemp.c_str(), packPath.c_str()) != 0 || std::rename(idxTemp.c_str(), idxPath.c_str()) != 0) {
+            std::remove(packTemp.c_str());
+            std::remove(idxTemp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t RECORD_SIZE = 16;
+    static constexpr size_t MAX_RESOLVE_DEPTH = 64; // Guards reads against corrupt (cyclic) delta chains
+
+    MappedFile pack;
+    MappedFile index;
+    uint32_t count = 0;
+    size_t namesStart = 0;
+
+    const char* recordAt(uint32_t i) const { return index.data() + 12 + static_cast<size_t>(i) * RECORD_SIZE; }
+
+    std::string_view nameAt(uint32_t i) const {
+        const char* record = recordAt(i);
+        return index.view().substr(namesStart + readLE<uint32_t>(record + 8), readLE<uint32_t>(record + 12));
+    }
+
+    bool findOffset(const std::string& name, uint64_t& offset) const {
+        uint32_t lo = 0, hi = count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            int order = nameAt(mid).compare(name);
+            if (order == 0) {
+                offset = readLE<uint64_t>(recordAt(mid));
+                return true;
+            }
+            if (order < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        return false;
+    }
+
+    bool readAt(uint64_t offset, std::string& content, size_t depth) const {
+        std::string_view data = pack.view();
+        if (depth > MAX_RESOLVE_DEPTH || offset >= data.size()) return false;
+        size_t pos = static_cast<size_t>(offset);
+        uint8_t kind = static_cast<uint8_t>(data[pos++]);
+        uint64_t baseOffset = 0;
+        if (kind == 1) {
+            if (data.size() - pos < 8) return false;
+            baseOffset = readLE<uint64_t>(data.data() + pos);
+            pos += 8;
+            if (baseOffset >= offset) return false; // Bases always come first
+        } else if (kind != 0) {
+            return false;
+        }
+        if (data.size() - pos < 8) return false;
+        uint64_t length = readLE<uint64_t>(data.data() + pos);
+        pos += 8;
+        if (length > data.size() - pos) return false;
+
+        std::string decoded;
+        if (!decodeEnvelope(data.substr(pos, static_cast<size_t>(length)), decoded)) return false;
+        if (kind == 0) {
+            content = std::move(decoded);
+            return true;
+        }
+        std::string base;
+        return readAt(baseOffset, base, depth + 1) && applyDelta(base, decoded, content);
+    }
+};
+
+#endif // PACK_FILE_HPP
@@ -0,0 +1,271 @@
+#ifndef REF_STORE_HPP
+#define REF_STORE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h> // For open(), O_CREAT | O_EXCL
+#ifndef _WIN32
+#include <unistd.h> // For write(), fsync()
+#else
+#include <io.h>
+#include <sys/stat.h>
+#endif
+
+#include "MappedFile.hpp"
+
+// Branch references.
+//   .minigit/packed-refs      "<commit hash> <branch name>\n" per branch, sorted by name; loaded with one read
+//   .minigit/refs/heads/<name> loose ref, one per file; overrides the packed entry of the same name
+// Every file is replaced atomically through a lock file "<path>.lock", like in git: it is created with
+// O_CREAT | O_EXCL, so concurrent updates of the same file take turns instead of overwriting each other's
+// temporary file; then it is written, fsync'ed and renamed over the file, and the directory is fsync'ed.
+// A crash leaves either the old or the new value (and possibly a stale lock file, which blocks updates of that
+// file until it is removed). A Transaction applies many updates with a single packed-refs rewrite
+// (one fsync) instead of one loose file per branch.
+class RefStore {
+public:
+    static constexpr size_t LOOSE_UPDATE_LIMIT = 1; // Transactions with more updates go to packed-refs
+
+    explicit RefStore(std::string repoDir = ".minigit") : root(std::move(repoDir)) {}
+
+    // Reads packed-refs, then lets loose refs override it.
+    std::unordered_map<std::string, std::string> load() const {
+        std::unordered_map<std::string, std::string> refs;
+        for (const auto& [name, hash] : readPacked()) refs[name] = hash;
+        for (const std::string& name : looseNames()) {
+            std::ifstream file(looseRefPath(name));
+            std::string hash;
+            std::getline(file, hash);
+            refs[name] = hash;
+        }
+        return refs;
+    }
+
+    // Value of one ref (loose first, then packed); empty if it does not exist.
+    std::string read(const std::string& name) const {
+        std::ifstream loose(looseRefPath(name));
+        std::string hash;
+        if (loose.is_open()) {
+            std::getline(loose, hash);
+            return hash;
+        }
+        std::map<std::string, std::string> packed = readPacked();
+        auto it = packed.find(name);
+        return it == packed.end() ? "" : it->second;
+    }
+
+    // Collects ref updates and applies them together on commit().
+    class Transaction {
+    public:
+        explicit Transaction(const RefStore& owner) : store(owner) {}
+
+        void update(const std::string& name, const std::string& hash) { updates[name] = hash; }
+        size_t size() const { return updates.size(); }
+
+        // Small transactions rewrite the loose ref; larger ones fold every update into packed-refs.
+        // Loose refs of updated names are rewritten too (or they would shadow the new packed value).
+        bool commit() {
+            if (updates.empty()) return true;
+            bool ok = true;
+            if (updates.size() <= LOOSE_UPDATE_LIMIT) {
+                for (const auto& [name, hash] : updates) ok = store.writeLoose(name, hash) && ok;
+            } else {
+                LockFile lock(store.packedPath()); // Before reading, so concurrent transactions do not lose updates
+                std::map<std::string, std::string> packed = store.readPacked();
+                for (const auto& [name, hash] : updates) packed[name] = hash;
+                ok = lock.locked() && lock.commit(serializePacked(packed));
+                std::error_code ec;
+                for (const auto& [name, hash] : updates) {
+                    if (std::filesystem::exists(store.looseRefPath(name), ec)) ok = store.writeLoose(name, hash) && ok;
+                }
+            }
+            updates.clear();
+            return ok;
+        }
+
+    private:
+        const RefStore& store;
+        std::map<std::string, std::string> updates;
+    };
+
+    Transaction transaction() const { return Transaction(*this); }
+
+    // Moves every loose ref into packed-refs (used by gc). packed-refs and each loose ref are locked while
+    // this runs, so a concurrent update either finishes first (and is packed) or waits and stays loose.
+    // Loose files are only removed once the new packed-refs is in place.
+    bool packLooseRefs() const {
+        LockFile packedLock(packedPath());
+        if (!packedLock.locked()) return false;
+        std::map<std::string, std::string> packed = readPacked();
+        std::vector<std::pair<std::string, std::unique_ptr<LockFile>>> loose;
+        for (const std::string& name : looseNames()) {
+            auto lock = std::make_unique<LockFile>(looseRefPath(name));
+            if (!lock->locked()) continue; // Busy: it stays loose (and overrides its packed entry)
+            std::ifstream file(looseRefPath(name));
+            std::string hash;
+            if (!std::getline(file, hash) || hash.empty()) continue; // Deleted or emptied meanwhile
+            packed[name] = hash;
+            loose.emplace_back(name, std::move(lock));
+        }
+        if (!packedLock.commit(serializePacked(packed))) return false;
+        std::error_code ec;
+        for (const auto& entry : loose) std::filesystem::remove(looseRefPath(entry.first), ec); // Before its lock goes
+        return true;
+    }
+
+    // Replaces 'path' with 'content' through "<path>.lock" (see the class comment). Fails if the lock
+    // stays taken for LOCK_TIMEOUT or a write, fsync or rename fails.
+    static bool writeFileAtomic(const std::string& path, std::string_view content) {
+        LockFile lock(path);
+        return lock.locked() && lock.commit(content);
+    }
+
+private:
+    static constexpr std::chrono::milliseconds LOCK_TIMEOUT{1000}; // Other updates of a file take far less
+
+    // "<target>.lock", created exclusively; removed again unless commit() renamed it over the target.
+    class LockFile {
+    public:
+        explicit LockFile(std::string targetPath) : target(std::move(targetPath)), path(target + ".lock") {
+            const auto deadline = std::chrono::steady_clock::now() + LOCK_TIMEOUT;
+            for (;;) {
+#ifndef _WIN32
+                fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+#else
+                fd = ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#endif
+                if (fd >= 0 || errno != EEXIST || std::chrono::steady_clock::now() >= deadline) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            held = fd >= 0;
+        }
+        LockFile(const LockFile&) = delete;
+        LockFile& operator=(const LockFile&) = delete;
+        ~LockFile() {
+            closeFile();
+            if (held) std::remove(path.c_str());
+        }
+
+        bool locked() const { return fd >= 0; }
+
+        // Writes and fsyncs 'content', renames the lock file over the target and fsyncs the directory.
+        bool commit(std::string_view content) {
+            if (fd < 0) return false;
+            bool ok = writeAll(content);
+#ifndef _WIN32
+            ok = ok && ::fsync(fd) == 0;
+#else
+            ok = ok && ::_commit(fd) == 0;
+#endif
+            ok = closeFile() && ok;
+            if (!ok || std::rename(path.c_str(), target.c_str()) != 0) return false;
+            held = false;
+            return syncDirectory();
+        }
+
+    private:
+        std::string target;
+        std::string path;
+        int fd = -1;
+        bool held = false; // The lock file is ours and still to be removed (not renamed)
+
+        bool writeAll(std::string_view content) {
+            while (!content.empty()) {
+#ifndef _WIN32
+                ssize_t written = ::write(fd, content.data(), content.size());
+#else
+                int written = ::_write(fd, content.data(), static_cast<unsigned>(content.size()));
+#endif
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) return false;
+                content.remove_prefix(static_cast<size_t>(written));
+            }
+            return true;
+        }
+
+        bool closeFile() {
+            if (fd < 0) return true;
+#ifndef _WIN32
+            bool ok = ::close(fd) == 0;
+#else
+            bool ok = ::_close(fd) == 0;
+#endif
+            fd = -1;
+            return ok;
+        }
+
+        // The rename is only durable once the directory entry is (no directory fsync on Windows).
+        bool syncDirectory() const {
+#ifndef _WIN32
+            std::string dir = std::filesystem::path(target).parent_path().string();
+            int dirFd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+            if (dirFd < 0) return false;
+            bool ok = ::fsync(dirFd) == 0;
+            ::close(dirFd);
+            return ok;
+#else
+            return true;
+#endif
+        }
+    };
+
+    std::string root;
+
+    std::string headsDir() const { return root + "/refs/heads"; }
+    std::string packedPath() const { return root + "/packed-refs"; }
+    std::string looseRefPath(const std::string& name) const { return headsDir() + "/" + name; }
+
+    // Names of the loose refs (lock files are not refs).
+    std::vector<std::string> looseNames() const {
+        std::vector<std::string> names;
+        std::error_code ec;
+        if (!std::filesystem::exists(headsDir(), ec)) return names;
+        for (auto it = std::filesystem::recursive_directory_iterator(headsDir(), ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file() || it->path().extension() == ".lock") continue;
+            names.push_back(it->path().lexically_relative(headsDir()).generic_string());
+        }
+        return names;
+    }
+
+    std::map<std::string, std::string> readPacked() const {
+        std::map<std::string, std::string> refs;
+        MappedFile file(packedPath());
+        std::string_view data = file.view();
+        while (!data.empty()) {
+            size_t end = data.find('\n');
+            std::string_view line = data.substr(0, end);
+            data = end == std::string_view::npos ? std::string_view() : data.substr(end + 1);
+            size_t space = line.find(' ');
+            if (line.empty() || line[0] == '#' || space == std::string_view::npos) continue;
+            refs[std::string(line.substr(space + 1))] = std::string(line.substr(0, space));
+        }
+        return refs;
+    }
+
+    static std::string serializePacked(const std::map<std::string, std::string>& refs) {
+        std::string content = "# minigit packed-refs\n";
+        for (const auto& [name, hash] : refs) content += hash + " " + name + "\n";
+        return content;
+    }
+
+    bool writeLoose(const std::string& name, const std::string& hash) const {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(looseRefPath(name)).parent_path(), ec);
+        return writeFileAtomic(looseRefPath(name), hash + "\n");
+    }
+};
+
+#endif // REF_STORE_HPP
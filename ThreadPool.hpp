@@ -0,0 +1,158 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Each worker owns a deque: it pops its own tasks from the back and, when it runs dry,
+// steals from the front of the other workers' deques, so uneven tasks (one huge file among
+// many small ones) don't leave cores idle.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount) {
+        if (threadCount == 0) threadCount = 1;
+        for (unsigned int i = 0; i < threadCount; ++i) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (unsigned int i = 0; i < threadCount; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    // Queues a task. Tasks are spread round-robin over the workers' deques.
+    void submit(std::function<void()> task) {
+        WorkQueue& queue = *queues[nextQueue++ % queues.size()];
+        {
+            // Counted and pushed under stateMutex so a sleeping worker can never miss the task.
+            std::lock_guard<std::mutex> stateLock(stateMutex);
+            std::lock_guard<std::mutex> queueLock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+            ++queued;
+            ++pending;
+        }
+        workAvailable.notify_one();
+    }
+
+    // Blocks until every submitted task has finished. Rethrows the first exception a task threw.
+    void wait() {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        allDone.wait(lock, [this] { return pending == 0; });
+        if (firstError) {
+            std::exception_ptr error = firstError;
+            firstError = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Number of workers to use for 'jobs' (0 means one per hardware thread).
+    static unsigned int resolveJobs(unsigned int jobs) {
+        if (jobs != 0) return jobs;
+        unsigned int hardware = std::thread::hardware_concurrency();
+        return hardware == 0 ? 1 : hardware;
+    }
+
+    // Runs body(i) for every i in [0, count) on 'jobs' threads and returns when all calls have finished.
+    // With a single job (or a single item) everything runs inline on the calling thread.
+    static void parallelFor(size_t count, unsigned int jobs, const std::function<void(size_t)>& body) {
+        jobs = resolveJobs(jobs);
+        if (jobs <= 1 || count <= 1) {
+            for (size_t i = 0; i < count; ++i) body(i);
+            return;
+        }
+        ThreadPool pool(static_cast<unsigned int>(std::min<size_t>(jobs, count)));
+        for (size_t i = 0; i < count; ++i) {
+            pool.submit([&body, i] { body(i); });
+        }
+        pool.wait();
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue{0};
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queued = 0;  // Tasks sitting in a deque (guarded by stateMutex)
+    size_t pending = 0; // Tasks queued or running (guarded by stateMutex)
+    bool stopping = false;
+    std::exception_ptr firstError;
+
+    bool popOwn(size_t self, std::function<void()>& task) {
+        WorkQueue& queue = *queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t self, std::function<void()>& task) {
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkQueue& victim = *queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        for (;;) {
+            std::function<void()> task;
+            if (popOwn(self, task) || steal(self, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex);
+                    --queued;
+                }
+                try {
+                    task();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(stateMutex);
+                    if (!firstError) firstError = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (--pending == 0) allDone.notify_all();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+    }
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,206 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Hot-path instrumentation: scoped timers and counters, enabled with 'minigit --timing', --trace=<file>,
+// MINIGIT_TIMING=1 or MINIGIT_TRACE=<file>. When disabled, a scope or counter is one relaxed atomic
+// load and a branch. When enabled, the process prints a summary table to stderr at exit, and with a
+// trace file it also writes Chrome trace-event JSON (load it in chrome://tracing or Perfetto).
+//
+//   TRACE_SCOPE("hashFile");                        // times the rest of the enclosing block
+//   TRACE_COUNT(TraceCounter::BytesHashed, size);   // adds to a process-wide counter
+//
+// Scope names must be string literals (they are kept by pointer). Both macros are thread-safe.
+
+enum class TraceCounter {
+    BytesHashed,
+    FilesStated,
+    DirectoryEntries,
+    FilesRead,
+    BlobsLoaded,
+    BlobBytesLoaded,
+    ObjectsFetched,
+    CommitsParsed,
+    TreesParsed,
+    Count // Number of counters
+};
+
+class Trace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static bool enabled() { return state().on.load(std::memory_order_relaxed); }
+
+    // Starts collecting. With a non-empty 'chromeTracePath', individual scope events are kept as well.
+    static void enable(const std::string& chromeTracePath = "") {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.start = Clock::now();
+        if (!chromeTracePath.empty()) s.tracePath = chromeTracePath;
+        s.on.store(true, std::memory_order_relaxed);
+    }
+
+    static void count(TraceCounter counter, uint64_t amount) {
+        state().counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    static void record(const char* name, Clock::time_point begin, Clock::time_point end) {
+        State& s = state();
+        const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        Timer& timer = s.timers[name];
+        ++timer.calls;
+        timer.totalNs += ns;
+        timer.maxNs = std::max(timer.maxNs, ns);
+        if (!s.tracePath.empty() && s.events.size() < MAX_EVENTS) {
+            s.events.push_back({name, threadNumber(s), micros(s, begin), ns / 1000.0});
+        }
+    }
+
+    // Times one scope (see TRACE_SCOPE).
+    class Scope {
+    public:
+        explicit Scope(const char* scopeName) : name(Trace::enabled() ? scopeName : nullptr) {
+            if (name) begin = Clock::now();
+        }
+        ~Scope() {
+            if (name) Trace::record(name, begin, Clock::now());
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        Clock::time_point begin;
+    };
+
+    // Prints the summary table: one row per scope (slowest total first), then the counters.
+    static void report(std::ostream& out) {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        const double wallMs = std::chrono::duration<double, std::milli>(Clock::now() - s.start).count();
+        std::vector<std::pair<std::string_view, Timer>> rows(s.timers.begin(), s.timers.end());
+        std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second.totalNs > b.second.totalNs; });
+
+        out << "--- MiniGit Timing (wall " << std::fixed << std::setprecision(2) << wallMs << " ms) ---\n";
+        out << std::left << std::setw(28) << "scope" << std::right << std::setw(10) << "calls" << std::setw(12) << "total ms"
+            << std::setw(12) << "avg us" << std::setw(12) << "max us" << "\n";
+        for (const auto& [name, timer] : rows) {
+            out << std::left << std::setw(28) << name << std::right << std::setw(10) << timer.calls
+                << std::setw(12) << timer.totalNs / 1e6 << std::setw(12) << timer.totalNs / 1e3 / static_cast<double>(timer.calls)
+                << std::setw(12) << timer.maxNs / 1e3 << "\n";
+        }
+        out << "\n";
+        for (size_t i = 0; i < COUNTERS; ++i) {
+            out << std::left << std::setw(28) << counterName(static_cast<TraceCounter>(i)) << std::right << std::setw(10)
+                << s.counters[i].load(std::memory_order_relaxed) << "\n";
+        }
+        out << "Scopes nest and worker threads add up, so totals may exceed the wall time.\n";
+        out << "-------------------------------\n";
+        out.unsetf(std::ios::floatfield);
+    }
+
+    // Writes the Chrome trace file requested in enable(), if any. Returns false if it could not be written.
+    static bool writeChromeTrace() {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.tracePath.empty()) return true;
+        std::ofstream out(s.tracePath, std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for (size_t i = 0; i < s.events.size(); ++i) {
+            const Event& event = s.events[i];
+            out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "},\n";
+        }
+        out << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << micros(s, Clock::now()) << ",\"args\":{";
+        for (size_t i = 0; i < COUNTERS; ++i) {
+            out << (i ? "," : "") << "\"" << counterName(static_cast<TraceCounter>(i)) << "\":"
+                << s.counters[i].load(std::memory_order_relaxed);
+        }
+        out << "}}\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    static constexpr size_t COUNTERS = static_cast<size_t>(TraceCounter::Count);
+    static constexpr size_t MAX_EVENTS = 1000000; // Bounds memory on huge trees; the summary still counts everything
+
+    struct Timer {
+        uint64_t calls = 0;
+        int64_t totalNs = 0;
+        int64_t maxNs = 0;
+    };
+    struct Event {
+        const char* name;
+        unsigned thread;
+        double startUs;
+        double durationUs;
+    };
+    struct State {
+        std::atomic<bool> on{false};
+        std::atomic<uint64_t> counters[COUNTERS] = {};
+        std::mutex mutex; // Guards everything below
+        Clock::time_point start = Clock::now();
+        std::string tracePath;
+        std::map<std::string_view, Timer> timers;
+        std::vector<Event> events;
+        std::unordered_map<std::thread::id, unsigned> threads;
+    };
+
+    static State& state() {
+        static State instance;
+        return instance;
+    }
+
+    // Small, stable thread numbers for the trace viewer (0 = first thread seen). Called with the mutex held.
+    static unsigned threadNumber(State& s) {
+        auto inserted = s.threads.emplace(std::this_thread::get_id(), static_cast<unsigned>(s.threads.size()));
+        return inserted.first->second;
+    }
+
+    static double micros(const State& s, Clock::time_point time) {
+        return std::chrono::duration<double, std::micro>(time - s.start).count();
+    }
+
+    static const char* counterName(TraceCounter counter) {
+        switch (counter) {
+            case TraceCounter::BytesHashed: return "bytes hashed";
+            case TraceCounter::FilesStated: return "files stat'ed";
+            case TraceCounter::DirectoryEntries: return "directory entries";
+            case TraceCounter::FilesRead: return "files read";
+            case TraceCounter::BlobsLoaded: return "blobs loaded";
+            case TraceCounter::BlobBytesLoaded: return "blob bytes loaded";
+            case TraceCounter::ObjectsFetched: return "objects fetched";
+            case TraceCounter::CommitsParsed: return "commits parsed";
+            case TraceCounter::TreesParsed: return "trees parsed";
+            case TraceCounter::Count: break;
+        }
+        return "?";
+    }
+};
+
+#define MINIGIT_TRACE_JOIN2(a, b) a##b
+#define MINIGIT_TRACE_JOIN(a, b) MINIGIT_TRACE_JOIN2(a, b)
+#define TRACE_SCOPE(name) Trace::Scope MINIGIT_TRACE_JOIN(traceScope_, __LINE__)(name)
+#define TRACE_COUNT(counter, amount)                                   \
+    do {                                                               \
+        if (Trace::enabled()) Trace::count((counter), (amount));       \
+    } while (0)
+
+#endif // TRACE_HPP
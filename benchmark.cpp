@@ -0,0 +1,439 @@
+#include "MiniGitSystem.hpp"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <filesystem>
+#ifndef _WIN32
+#include <unistd.h> // For getpid()
+#endif
+
+namespace fs = std::filesystem;
+
+// Benchmark suite: generates a synthetic repository and times the MiniGit operations against it.
+// Every timed step runs in-process on a fresh MiniGitSystem, like one CLI invocation (so repository
+// loading is part of each measurement). Results are written as JSON for tracking across releases.
+//
+//   g++ -std=c++17 -O2 benchmark.cpp -o minigit-bench
+//   ./minigit-bench --files 20000 --depth 50 --branches 4 --output bench.json
+
+struct BenchConfig {
+    size_t files = 2000;
+    size_t filesPerDir = 50;
+    size_t depth = 20;          // Commits on master after the initial one
+    size_t branches = 2;        // Forked along the history, one extra commit each
+    double editPercent = 1.0;   // Files modified per commit (and dirtied for status_dirty / diff_worktree)
+    size_t medianSize = 4096;   // Bytes; file sizes are log-normal around it
+    double sizeSigma = 1.0;     // 0 = every file has the median size
+    size_t maxSize = 1024 * 1024;
+    size_t runs = 5;            // Repetitions of each query
+    unsigned int jobs = 0;      // Threads for add/status/diff/checkout (0 = all cores)
+    uint64_t seed = 1;
+    std::string hash = "sha256";
+    std::string dir;            // Default: a fresh directory under the system temp directory
+    std::string output;         // Default: stdout
+    bool keep = false;
+};
+
+// Timings of one operation, in milliseconds.
+struct BenchResult {
+    std::string name;
+    std::vector<double> samples;
+};
+
+// Swallows MiniGit's progress output while an operation is timed.
+class QuietStdout {
+public:
+    QuietStdout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~QuietStdout() { std::cout.rdbuf(saved); }
+
+private:
+    std::ostringstream sink;
+    std::streambuf* saved;
+};
+
+class Benchmark {
+public:
+    explicit Benchmark(BenchConfig settings) : config(std::move(settings)), rng(config.seed) {}
+
+    // Builds the repository and runs every measurement. Returns false if the repository could not be created.
+    bool run() {
+        root = config.dir.empty() ? defaultDirectory() : fs::path(config.dir);
+        std::error_code ec;
+        if (fs::exists(root / ".minigit", ec)) {
+            std::cerr << "Error: " << root.string() << " already holds a repository.\n";
+            return false;
+        }
+        fs::create_directories(root, ec);
+        if (ec) {
+            std::cerr << "Error: Could not create " << root.string() << ": " << ec.message() << "\n";
+            return false;
+        }
+        const fs::path previous = fs::current_path();
+        fs::current_path(root);
+        buildRepository();
+        measureQueries();
+        fs::current_path(previous);
+        if (!config.keep) fs::remove_all(root, ec);
+        return true;
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\n";
+        out << "  \"benchmark\": \"minigit\",\n";
+        out << "  \"timestamp\": \"" << startTime << "\",\n";
+        out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+        out << "  \"config\": {\"files\": " << config.files << ", \"files_per_dir\": " << config.filesPerDir
+            << ", \"depth\": " << config.depth << ", \"branches\": " << config.branches
+            << ", \"edit_percent\": " << config.editPercent << ", \"median_size\": " << config.medianSize
+            << ", \"size_sigma\": " << config.sizeSigma << ", \"max_size\": " << config.maxSize
+            << ", \"runs\": " << config.runs << ", \"jobs\": " << config.jobs << ", \"seed\": " << config.seed
+            << ", \"hash\": \"" << jsonEscape(config.hash) << "\"},\n";
+        out << "  \"repository\": {\"files\": " << paths.size() << ", \"bytes\": " << totalBytes
+            << ", \"commits\": " << commitCount << ", \"branches\": " << config.branches + 1 << "},\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            std::vector<double> sorted = results[i].samples;
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0;
+            for (double sample : sorted) sum += sample;
+            out << "    {\"name\": \"" << jsonEscape(results[i].name) << "\", \"runs\": " << sorted.size();
+            if (!sorted.empty()) {
+                out << std::fixed << std::setprecision(3)
+                    << ", \"min_ms\": " << sorted.front()
+                    << ", \"median_ms\": " << sorted[sorted.size() / 2]
+                    << ", \"mean_ms\": " << sum / static_cast<double>(sorted.size())
+                    << ", \"max_ms\": " << sorted.back();
+                out.unsetf(std::ios::floatfield);
+            }
+            out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+private:
+    BenchConfig config;
+    std::mt19937_64 rng;
+    fs::path root;
+    std::vector<std::string> paths;
+    std::vector<std::string> branchNames;
+    std::string firstCommit;
+    uint64_t totalBytes = 0;
+    size_t commitCount = 0;
+    size_t editRound = 0;
+    std::vector<BenchResult> results;
+    std::string startTime = currentTime();
+
+    // --- Repository generation ---
+
+    void buildRepository() {
+        progress("generating " + std::to_string(config.files) + " files");
+        for (size_t i = 0; i < config.files; ++i) {
+            std::ostringstream path;
+            path << "d" << std::setw(4) << std::setfill('0') << i / std::max<size_t>(config.filesPerDir, 1)
+                 << "/f" << std::setw(6) << std::setfill('0') << i << ".txt";
+            paths.push_back(path.str());
+            std::string content = generateContent(pickSize());
+            totalBytes += content.size();
+            writeFile(paths.back(), content);
+        }
+
+        time("init", [&](MiniGitSystem& git) { git.init(config.hash); });
+        time("add_all", [&](MiniGitSystem& git) { git.add(std::vector<std::string>{"."}); });
+        time("commit_initial", [&](MiniGitSystem& git) { git.commit("initial"); });
+        ++commitCount;
+        firstCommit = headCommit();
+
+        progress("building " + std::to_string(config.depth) + " commits and " + std::to_string(config.branches) + " branches");
+        size_t nextBranch = 0;
+        for (size_t c = 1; c <= config.depth; ++c) {
+            std::vector<std::string> edited = editFiles();
+            time("add_edits", [&](MiniGitSystem& git) { git.add(edited); });
+            time("commit", [&](MiniGitSystem& git) { git.commit("edit " + std::to_string(c)); });
+            ++commitCount;
+            // Fork the branches evenly along the history
+            while (nextBranch < config.branches && (nextBranch + 1) * (config.depth + 1) <= c * (config.branches + 1)) {
+                branchNames.push_back("bench-" + std::to_string(nextBranch++));
+                time("branch", [&](MiniGitSystem& git) { git.branch({branchNames.back()}); });
+            }
+        }
+        while (nextBranch < config.branches) { // depth 0: fork everything at the initial commit
+            branchNames.push_back("bench-" + std::to_string(nextBranch++));
+            time("branch", [&](MiniGitSystem& git) { git.branch({branchNames.back()}); });
+        }
+        for (const std::string& name : branchNames) {
+            time("checkout", [&](MiniGitSystem& git) { git.checkout(name); });
+            std::vector<std::string> edited = editFiles();
+            run([&](MiniGitSystem& git) { git.add(edited); });
+            time("commit", [&](MiniGitSystem& git) { git.commit("work on " + name); });
+            ++commitCount;
+            time("checkout", [&](MiniGitSystem& git) { git.checkout("master"); });
+        }
+    }
+
+    // Replaces a few lines in editPercent of the files (at least one); returns their paths.
+    std::vector<std::string> editFiles() {
+        size_t count = std::max<size_t>(1, static_cast<size_t>(std::llround(paths.size() * config.editPercent / 100.0)));
+        std::vector<std::string> edited;
+        std::uniform_int_distribution<size_t> pick(0, paths.size() - 1);
+        ++editRound;
+        for (size_t k = 0; k < count; ++k) {
+            const std::string& path = paths[pick(rng)];
+            std::vector<std::string> lines;
+            std::ifstream in(path, std::ios::binary);
+            for (std::string line; std::getline(in, line);) lines.push_back(line);
+            in.close();
+            if (lines.empty()) lines.emplace_back();
+            std::uniform_int_distribution<size_t> pickLine(0, lines.size() - 1);
+            for (int e = 0; e < 3; ++e) lines[pickLine(rng)] = "edited in round " + std::to_string(editRound) + " " + std::to_string(rng() % 100000);
+            std::string content;
+            for (const std::string& line : lines) content += line + "\n";
+            writeFile(path, content);
+            edited.push_back(path);
+        }
+        std::sort(edited.begin(), edited.end());
+        edited.erase(std::unique(edited.begin(), edited.end()), edited.end());
+        return edited;
+    }
+
+    size_t pickSize() {
+        if (config.sizeSigma <= 0) return config.medianSize;
+        std::lognormal_distribution<double> distribution(std::log(static_cast<double>(std::max<size_t>(config.medianSize, 1))), config.sizeSigma);
+        return std::min(config.maxSize, std::max<size_t>(16, static_cast<size_t>(distribution(rng))));
+    }
+
+    // Source-like text: lines of 20-80 characters drawn from a small vocabulary, so diffs find matches.
+    std::string generateContent(size_t size) {
+        static const char* const words[] = {"int", "return", "value", "count", "index", "const", "auto", "std::string",
+                                            "if", "for", "while", "result", "name", "path", "size", "{", "}", "=", "+", ";"};
+        std::string content;
+        content.reserve(size + 80);
+        std::uniform_int_distribution<size_t> pickWord(0, sizeof(words) / sizeof(words[0]) - 1);
+        std::uniform_int_distribution<size_t> pickLength(20, 80);
+        while (content.size() < size) {
+            size_t lineEnd = content.size() + pickLength(rng);
+            while (content.size() < lineEnd) {
+                content += words[pickWord(rng)];
+                content += ' ';
+            }
+            content.back() = '\n';
+        }
+        content.resize(size);
+        if (!content.empty()) content.back() = '\n';
+        return content;
+    }
+
+    static void writeFile(const std::string& path, const std::string& content) {
+        fs::path parent = fs::path(path).parent_path();
+        std::error_code ec;
+        if (!parent.empty()) fs::create_directories(parent, ec);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    // --- Queries ---
+
+    void measureQueries() {
+        // Files written within the last second are not stat-cached (racy entries); wait them out and warm
+        // the index once, so status measures the steady state of a tree that was committed earlier
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        run([](MiniGitSystem& git) { git.getStatus(); });
+
+        progress("running queries (" + std::to_string(config.runs) + " runs each)");
+        const std::string head = headCommit();
+        for (size_t r = 0; r < config.runs; ++r) {
+            time("open", [](MiniGitSystem&) {});
+            time("status_clean", [](MiniGitSystem& git) { git.getStatus(); });
+            time("log", [](MiniGitSystem& git) {
+                size_t count = 0;
+                for (const MiniGitSystem::LogEntry& entry : git.walkLog()) count += entry.parents.size() + 1;
+                (void)count;
+            });
+            time("diff_commits", [&](MiniGitSystem& git) {
+                MiniGitSystem::DiffVisitor visitor;
+                git.diff(firstCommit, head, visitor);
+            });
+        }
+        for (size_t r = 0; r < config.runs && !branchNames.empty(); ++r) {
+            time("checkout_branch", [&](MiniGitSystem& git) { git.checkout(branchNames[r % branchNames.size()]); });
+            time("checkout_master", [](MiniGitSystem& git) { git.checkout("master"); });
+        }
+
+        editFiles(); // Unstaged changes for the remaining queries
+        for (size_t r = 0; r < config.runs; ++r) {
+            time("status_dirty", [](MiniGitSystem& git) { git.getStatus(); });
+            time("diff_worktree", [](MiniGitSystem& git) {
+                MiniGitSystem::DiffVisitor visitor;
+                git.diff("HEAD", "", visitor);
+            });
+        }
+    }
+
+    // --- Helpers ---
+
+    // Runs 'operation' on a freshly loaded repository, like one minigit process.
+    template <typename Operation>
+    void run(Operation operation) {
+        QuietStdout quiet;
+        MiniGitSystem git;
+        git.setJobs(config.jobs, config.jobs != 0); // 0 (the default) leaves prefetching at its own thread count
+        operation(git);
+    }
+
+    template <typename Operation>
+    void time(const std::string& name, Operation operation) {
+        auto start = std::chrono::steady_clock::now();
+        run(operation);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        auto it = std::find_if(results.begin(), results.end(), [&](const BenchResult& r) { return r.name == name; });
+        if (it == results.end()) it = results.insert(results.end(), BenchResult{name, {}});
+        it->samples.push_back(ms);
+    }
+
+    std::string headCommit() {
+        std::string hash;
+        run([&](MiniGitSystem& git) { hash = git.getStatus().headCommit; });
+        return hash;
+    }
+
+    static void progress(const std::string& message) { std::cerr << "[bench] " << message << "\n"; }
+
+    static fs::path defaultDirectory() {
+#ifndef _WIN32
+        long pid = static_cast<long>(::getpid());
+#else
+        long pid = 0;
+#endif
+        return fs::temp_directory_path() / ("minigit-bench-" + std::to_string(pid));
+    }
+
+    static std::string currentTime() {
+        std::time_t now = std::time(nullptr);
+        std::tm utc = *std::gmtime(&now);
+        std::ostringstream ss;
+        ss << std::put_time(&utc, "%Y-%m-%dT%H:%M:%SZ");
+        return ss.str();
+    }
+
+    static std::string jsonEscape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) < 0x20) continue;
+            out += c;
+        }
+        return out;
+    }
+};
+
+// Parses "4096", "64K", "16M" or "1G".
+static bool parseSize(const std::string& text, size_t& bytes) {
+    size_t digits = text.find_first_not_of("0123456789");
+    if (digits == 0 || text.empty()) return false;
+    size_t multiplier = 1;
+    if (digits != std::string::npos) {
+        if (digits + 1 != text.size()) return false;
+        switch (text[digits]) {
+            case 'K': case 'k': multiplier = 1024; break;
+            case 'M': case 'm': multiplier = 1024 * 1024; break;
+            case 'G': case 'g': multiplier = 1024 * 1024 * 1024; break;
+            default: return false;
+        }
+    }
+    bytes = static_cast<size_t>(std::stoull(text.substr(0, digits))) * multiplier;
+    return true;
+}
+
+static bool parseCount(const std::string& text, size_t& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    value = static_cast<size_t>(std::stoull(text));
+    return true;
+}
+
+static void printUsage() {
+    std::cout << "Usage: minigit-bench [options]\n";
+    std::cout << "  --files N            Files in the generated tree (default 2000)\n";
+    std::cout << "  --files-per-dir N    Files per directory (default 50)\n";
+    std::cout << "  --depth N            Commits on master after the initial one (default 20)\n";
+    std::cout << "  --branches N         Branches forked along the history (default 2)\n";
+    std::cout << "  --edit-percent P     Files modified per commit, in percent (default 1)\n";
+    std::cout << "  --size S             Median file size, e.g. 4K (default 4K)\n";
+    std::cout << "  --size-sigma X       Spread of the log-normal size distribution (default 1, 0 = fixed size)\n";
+    std::cout << "  --max-size S         Largest file (default 1M)\n";
+    std::cout << "  --runs N             Repetitions of each query (default 5)\n";
+    std::cout << "  --jobs N             Worker threads (default 0 = all cores)\n";
+    std::cout << "  --hash sha256|blake3 Object ID hash (default sha256)\n";
+    std::cout << "  --seed N             Random seed (default 1)\n";
+    std::cout << "  --dir PATH           Where to build the repository (default: a temporary directory)\n";
+    std::cout << "  --keep               Keep the repository afterwards\n";
+    std::cout << "  --output FILE        Write the JSON report to FILE instead of stdout\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& option = args[i];
+        if (option == "--keep") {
+            config.keep = true;
+            continue;
+        }
+        if (option == "-h" || option == "--help") {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 >= args.size()) {
+            std::cerr << "Error: " << option << " expects a value.\n";
+            printUsage();
+            return 1;
+        }
+        const std::string& value = args[++i];
+        size_t number = 0;
+        bool ok = true;
+        if (option == "--files") ok = parseCount(value, config.files) && config.files > 0;
+        else if (option == "--files-per-dir") ok = parseCount(value, config.filesPerDir) && config.filesPerDir > 0;
+        else if (option == "--depth") ok = parseCount(value, config.depth);
+        else if (option == "--branches") ok = parseCount(value, config.branches);
+        else if (option == "--runs") ok = parseCount(value, config.runs) && config.runs > 0;
+        else if (option == "--size") ok = parseSize(value, config.medianSize);
+        else if (option == "--max-size") ok = parseSize(value, config.maxSize);
+        else if (option == "--jobs") { ok = parseCount(value, number); config.jobs = static_cast<unsigned int>(number); }
+        else if (option == "--seed") { ok = parseCount(value, number); config.seed = number; }
+        else if (option == "--edit-percent") { config.editPercent = std::atof(value.c_str()); ok = config.editPercent >= 0; }
+        else if (option == "--size-sigma") { config.sizeSigma = std::atof(value.c_str()); ok = config.sizeSigma >= 0; }
+        else if (option == "--hash") { config.hash = value; ok = value == "sha256" || value == "blake3"; }
+        else if (option == "--dir") config.dir = value;
+        else if (option == "--output") config.output = value;
+        else {
+            std::cerr << "Error: Unknown option " << option << "\n";
+            printUsage();
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Error: Invalid value for " << option << ": " << value << "\n";
+            return 1;
+        }
+    }
+    if (!config.dir.empty()) config.dir = fs::absolute(config.dir).string();
+    if (!config.output.empty()) config.output = fs::absolute(config.output).string();
+
+    Benchmark benchmark(config);
+    if (!benchmark.run()) return 1;
+    if (config.output.empty()) {
+        benchmark.writeJson(std::cout);
+        return 0;
+    }
+    std::ofstream out(config.output);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not write " << config.output << "\n";
+        return 1;
+    }
+    benchmark.writeJson(out);
+    return 0;
+}
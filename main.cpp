@@ -1,86 +1,611 @@
-#include "MiniGitSystem.hpp"
-#include <vector>
-#include <string>
-#include <iostream>
-#include <filesystem> // Required for fs::current_path() if you want to use it for debugging
-
-namespace fs = std::filesystem;
-
-int main(int argc, char* argv[]) {
-    // MiniGitSystem operates on the current directory, so no path argument is needed for the constructor.
-    MiniGitSystem git;
-
-    if (argc < 2) {
-        std::cout << "Usage: minigit <command> [args...]\n";
-        std::cout << "Commands:\n";
-        std::cout << "  init                      - Initialize a new MiniGit repository.\n";
-        std::cout << "  add <file>                - Add file content to the staging area.\n";
-        std::cout << "  commit <message>          - Record changes to the repository.\n";
-        std::cout << "  log                       - Show commit history.\n";
-        std::cout << "  branch <name>             - Create a new branch.\n";
-        std::cout << "  checkout <target>         - Switch branches or restore working tree files.\n";
-        std::cout << "  status                    - Show the working tree status.\n";
-        std::cout << "  diff [arg1] [arg2]        - Show changes between commits, staging, or working tree.\n";
-        return 1;
-    }
-
-    std::string command = argv[1];
-
-    if (command == "init") {
-        git.init();
-    } else if (command == "add") {
-        if (argc < 3) {
-            std::cout << "Usage: minigit add <filename>\n";
-            return 1;
-        }
-        git.add(argv[2]);
-    } else if (command == "commit") {
-        if (argc < 3) {
-            std::cout << "Usage: minigit commit \"<message>\"\n"; // Emphasize quotes for multi-word messages
-            return 1;
-        }
-        std::string message = argv[2];
-        // Combine all arguments into a single message string for messages with spaces
-        for (int i = 3; i < argc; ++i) {
-            message += " " + std::string(argv[i]);
-        }
-        git.commit(message);
-    } else if (command == "log") {
-        git.log();
-    } else if (command == "branch") {
-        if (argc < 3) {
-            std::cout << "Usage: minigit branch <name>\n";
-            return 1;
-        }
-        git.branch(argv[2]);
-    } else if (command == "checkout") {
-        if (argc < 3) {
-            std::cout << "Usage: minigit checkout <branch_name_or_commit_hash>\n";
-            return 1;
-        }
-        git.checkout(argv[2]);
-    } else if (command == "status") {
-        git.status();
-    } else if (command == "diff") {
-        if (argc == 2) { // minigit diff (WD vs staging)
-            git.diff();
-        } else if (argc == 3) { // minigit diff <commit> (WD vs commit) OR minigit diff --staged
-            git.diff(argv[2]);
-        } else if (argc == 4) { // minigit diff <commit1> <commit2> (commit vs commit)
-            git.diff(argv[2], argv[3]);
-        } else {
-            std::cout << "Usage:\n";
-            std::cout << "  minigit diff                          # Show diff between working directory and staging\n";
-            std::cout << "  minigit diff --staged (or --cached) # Show diff between staging and HEAD commit\n";
-            std::cout << "  minigit diff <commit>                 # Show diff between working directory and a commit\n";
-            std::cout << "  minigit diff <commit1> <commit2>      # Show diff between two commits\n";
-            return 1;
-        }
-    } else {
-        std::cout << "Unknown command: " << command << "\n";
-        std::cout << "Commands: init, add <file>, commit <message>, log, branch <name>, checkout <target>, status, diff\n";
-        return 1;
-    }
-
-    return 0;
+#include "MiniGitSystem.hpp"
+#include "Daemon.hpp"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <mutex>
+#include <algorithm>
+#include <filesystem> // Required for fs::current_path() if you want to use it for debugging
+
+namespace fs = std::filesystem;
+
+// Removes "--jobs N", "--jobs=N", "-j N" or "-jN" from args and stores N in 'jobs' ('given' tells whether it was there).
+// Returns false if the option is present but its value is not a number.
+static bool extractJobsOption(std::vector<std::string>& args, unsigned int& jobs, bool& given) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        std::string value;
+        size_t consumed = 1;
+        if (args[i] == "--jobs" || args[i] == "-j") {
+            if (i + 1 >= args.size()) return false;
+            value = args[i + 1];
+            consumed = 2;
+        } else if (args[i].rfind("--jobs=", 0) == 0) {
+            value = args[i].substr(7);
+        } else if (args[i].rfind("-j", 0) == 0 && args[i].size() > 2) {
+            value = args[i].substr(2);
+        } else {
+            continue;
+        }
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) return false;
+        jobs = static_cast<unsigned int>(std::stoul(value));
+        given = true;
+        args.erase(args.begin() + static_cast<std::ptrdiff_t>(i), args.begin() + static_cast<std::ptrdiff_t>(i + consumed));
+        --i;
+    }
+    return true;
+}
+
+// Removes "--diff-algorithm=<name>", "--patience", "--histogram" and "-U<n>"/"--unified=<n>" from args.
+// Returns false if an option has an unknown algorithm name or a non-numeric line count.
+static bool extractDiffOptions(std::vector<std::string>& args, DiffAlgorithm& algorithm, size_t& contextLines) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg.rfind("--diff-algorithm=", 0) == 0) {
+            if (!parseDiffAlgorithm(arg.substr(17), algorithm)) return false;
+        } else if (arg == "--patience") {
+            algorithm = DiffAlgorithm::Patience;
+        } else if (arg == "--histogram") {
+            algorithm = DiffAlgorithm::Histogram;
+        } else if (arg.rfind("--unified=", 0) == 0 || (arg.rfind("-U", 0) == 0 && arg.size() > 2)) {
+            std::string value = arg.substr(arg[1] == 'U' ? 2 : 10);
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) return false;
+            contextLines = static_cast<size_t>(std::stoul(value));
+        } else {
+            continue;
+        }
+        args.erase(args.begin() + static_cast<std::ptrdiff_t>(i));
+        --i;
+    }
+    return true;
+}
+
+// Parses a byte count with an optional K, M or G suffix (e.g. "4M").
+static bool parseSize(const std::string& text, uint64_t& bytes) {
+    size_t digits = text.find_first_not_of("0123456789");
+    if (digits == 0 || text.empty()) return false;
+    uint64_t multiplier = 1;
+    if (digits != std::string::npos) {
+        if (digits + 1 != text.size()) return false;
+        switch (text[digits]) {
+            case 'K': case 'k': multiplier = 1024ull; break;
+            case 'M': case 'm': multiplier = 1024ull * 1024; break;
+            case 'G': case 'g': multiplier = 1024ull * 1024 * 1024; break;
+            default: return false;
+        }
+    }
+    bytes = std::stoull(text.substr(0, digits)) * multiplier;
+    return true;
+}
+
+// --- Terminal formatting of the library results ---
+
+static void printStatus(const MiniGitSystem::StatusResult& status, std::ostream& out) {
+    out << "--- MiniGit Status ---\n";
+    out << "On branch " << (status.branch.empty() ? "(detached HEAD)" : status.branch) << "\n";
+    out << "HEAD points to: " << (status.headCommit.empty() ? "No commits yet" : status.headCommit.substr(0, 7)) << "\n\n";
+
+    if (!status.mergeHead.empty()) {
+        out << "Merging " << status.mergeHead.substr(0, 7) << " (commit to conclude the merge)\n";
+        if (!status.unmerged.empty()) {
+            out << "Unmerged paths:\n";
+            out << "  (edit the conflicts, then use \"minigit add <file>...\" to mark them resolved)\n";
+            for (const auto& file : status.unmerged) out << "    Unmerged:   " << file << "\n";
+        }
+        out << "\n";
+    }
+
+    if (status.hasStagedChanges()) {
+        out << "Changes to be committed:\n";
+        for (const auto& file : status.stagedAdded) out << "    New file:   " << file << "\n";
+        for (const auto& file : status.stagedModified) out << "    Modified:   " << file << "\n";
+        for (const auto& file : status.stagedDeleted) out << "    Deleted:    " << file << "\n";
+        out << "\n";
+    } else {
+        out << "No changes to be committed.\n\n";
+    }
+
+    if (status.hasUnstagedChanges()) {
+        out << "Changes not staged for commit:\n";
+        for (const auto& file : status.modifiedSinceStaged) {
+            out << "    Modified:   " << file << " (not staged - staged version differs from WD)\n";
+        }
+        for (const auto& file : status.modified) out << "    Modified:   " << file << "\n";
+        for (const auto& file : status.deleted) out << "    Deleted:    " << file << "\n";
+        out << "\n";
+    } else {
+        out << "No changes not staged for commit.\n\n";
+    }
+
+    if (!status.untracked.empty()) {
+        out << "Untracked files:\n";
+        out << "  (use \"minigit add <file>...\" to include in what will be committed)\n";
+        for (const auto& file : status.untracked) out << "    " << file << "\n";
+        out << "\n";
+    } else {
+        out << "No untracked files.\n\n";
+    }
+
+    if (status.clean()) {
+        out << "Your working directory is clean.\n";
+    }
+    out << "----------------------\n";
+}
+
+static void printLog(MiniGitSystem& git, bool firstParentOnly, std::ostream& out, std::ostream& err) {
+    if (git.headCommit().empty()) {
+        out << "No commits yet.\n";
+        return;
+    }
+    const std::string& headBranch = git.currentBranch();
+    out << "--- Commit History ---\n";
+    MiniGitSystem::LogRange log = git.walkLog(firstParentOnly);
+    for (const MiniGitSystem::LogEntry& c : log) {
+        out << "Commit: " << c.hash.substr(0, 7);
+        if (headBranch.empty() && git.headCommit() == c.hash) {
+            out << " (HEAD, detached)";
+        } else if (!headBranch.empty() && git.headCommit() == c.hash) {
+            out << " (HEAD -> " << headBranch << ")";
+        }
+        // Also show other branches pointing to this commit
+        for (const auto& [branchName, commitHash] : git.branchRefs()) {
+            if (branchName != headBranch && commitHash == c.hash) out << ", " << branchName;
+        }
+        out << "\n";
+
+        if (!c.parents.empty()) {
+            out << (c.parents.size() > 1 ? "Merge:   " : "Parents: ");
+            for (const auto& p : c.parents) out << p.substr(0, 7) << " ";
+            out << "\n";
+        }
+        if (c.shallow) out << "Shallow: earlier history was not cloned\n";
+        out << "Date:    " << c.timestamp << "\n";
+        out << "Message: " << c.message << "\n\n";
+    }
+    for (const std::string& warning : log.warnings()) err << warning << "\n";
+    out << "----------------------\n";
+}
+
+// Prints a diff as unified hunks while the library computes it.
+class DiffPrinter : public MiniGitSystem::DiffVisitor {
+public:
+    using Mode = MiniGitSystem::DiffMode;
+    using Kind = MiniGitSystem::FileDiff::Kind;
+
+    explicit DiffPrinter(std::ostream& stream) : out(stream) {}
+
+    void begin(Mode diffMode, const std::string& oldCommit, const std::string& newCommit) override {
+        mode = diffMode;
+        commit = oldCommit;
+        switch (mode) {
+            case Mode::WorkingTreeVsIndex: out << "Diff: Working Directory vs Staging Area (unstaged changes)\n"; break;
+            case Mode::IndexVsHead: out << "Diff: Staging Area vs HEAD commit (staged changes)\n"; break;
+            case Mode::WorkingTreeVsCommit: out << "Diff: Working Directory vs Commit " << oldCommit.substr(0, 7) << "\n"; break;
+            case Mode::CommitVsCommit:
+                out << "Diff between " << oldCommit.substr(0, 7) << " and " << newCommit.substr(0, 7) << "\n";
+                break;
+        }
+    }
+
+    bool fileStart(const MiniGitSystem::FileDiff& file) override {
+        out << "--- Diff for: " << file.path << label(file.kind) << " ---\n";
+        return true;
+    }
+
+    bool hunk(const MiniGitSystem::FileDiff&, const DiffEngine::Hunk& hunk) override {
+        out << "@@ -" << hunk.oldStart << "," << hunk.oldCount << " +" << hunk.newStart << "," << hunk.newCount << " @@\n";
+        for (const DiffEngine::Line& line : hunk.lines) out << line.op << line.text << "\n";
+        return true;
+    }
+
+    void fileEnd(const MiniGitSystem::FileDiff&) override { out << "---------------------------\n"; }
+
+    // Printed when the diff visited no file at all.
+    void printNoDifferences() const {
+        switch (mode) {
+            case Mode::WorkingTreeVsIndex: out << "No differences in working directory compared to staged area.\n"; break;
+            case Mode::IndexVsHead: out << "No staged changes to show.\n"; break;
+            case Mode::WorkingTreeVsCommit:
+                out << "No differences in working directory compared to commit " << commit.substr(0, 7) << ".\n";
+                break;
+            case Mode::CommitVsCommit: out << "No differences between commits.\n"; break;
+        }
+    }
+
+private:
+    std::ostream& out;
+    Mode mode = Mode::WorkingTreeVsIndex;
+    std::string commit;
+
+    const char* label(Kind kind) const {
+        if (kind == Kind::Modified) return "";
+        bool deleted = kind == Kind::Deleted;
+        switch (mode) {
+            case Mode::WorkingTreeVsIndex: return deleted ? " (deleted from WD)" : " (new in WD)";
+            case Mode::IndexVsHead: return deleted ? " (deleted from staged)" : " (new file staged)";
+            case Mode::WorkingTreeVsCommit: return deleted ? " (deleted in WD)" : " (new in WD)";
+            case Mode::CommitVsCommit: return deleted ? " (deleted)" : " (new file)";
+        }
+        return "";
+    }
+};
+
+static const char* const NOT_A_REPOSITORY = "Not a MiniGit repository. Please run 'init' first.\n";
+
+static const char* const DAEMON_SOCKET = ".minigit/daemon.sock";
+
+// Runs 'status' or 'diff' with its command-line arguments, writing what the user sees to out/err.
+// Shared by the CLI and the daemon, so both give identical answers.
+static int runQuery(MiniGitSystem& git, const std::string& command, std::vector<std::string> args, std::ostream& out, std::ostream& err) {
+    // Both commands accept --jobs N to hash working directory files on N threads (0 = all cores)
+    unsigned int jobs = 1;
+    bool jobsGiven = false;
+    if (!extractJobsOption(args, jobs, jobsGiven)) {
+        out << "Error: --jobs expects a number of threads.\n";
+        return 1;
+    }
+    git.setJobs(jobs, jobsGiven);
+
+    DiffAlgorithm algorithm = DiffAlgorithm::Myers;
+    size_t contextLines = 3;
+    if (command == "diff" && !extractDiffOptions(args, algorithm, contextLines)) {
+        out << "Error: --diff-algorithm expects myers, patience or histogram, and -U/--unified a number of lines.\n";
+        return 1;
+    }
+    git.setDiffOptions(algorithm, contextLines);
+
+    if (!git.isRepository()) {
+        out << NOT_A_REPOSITORY;
+        return 1;
+    }
+    if (command == "status") {
+        MiniGitSystem::StatusResult status = git.getStatus();
+        for (const std::string& warning : status.warnings) err << warning << "\n";
+        printStatus(status, out);
+    } else if (args.size() <= 2) { // diff (WD vs staging), diff <commit> | --staged, diff <commit1> <commit2>
+        DiffPrinter printer(out);
+        MiniGitSystem::DiffResult result = git.diff(args.size() > 0 ? args[0] : "", args.size() > 1 ? args[1] : "", printer);
+        if (!result.ok()) {
+            err << result.error << "\n";
+            return 1;
+        }
+        if (result.filesChanged == 0) printer.printNoDifferences();
+    } else {
+        out << "Usage:\n";
+        out << "  minigit diff                          # Show diff between working directory and staging\n";
+        out << "  minigit diff --staged (or --cached) # Show diff between staging and HEAD commit\n";
+        out << "  minigit diff <commit>                 # Show diff between working directory and a commit\n";
+        out << "  minigit diff <commit1> <commit2>      # Show diff between two commits\n";
+        out << "  (add --jobs N to hash working directory files on N threads)\n";
+        out << "  (add --diff-algorithm=myers|patience|histogram or -U<n> to change the hunks)\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Collects a daemon request's diagnostics. Worker threads (blob prefetching, hashing) may report
+// through std::cerr at the same time: there is no put area, so every write takes the lock.
+class SharedErrorBuffer : public std::streambuf {
+public:
+    std::string str() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return text;
+    }
+
+protected:
+    std::streamsize xsputn(const char* data, std::streamsize count) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        text.append(data, static_cast<size_t>(count));
+        return count;
+    }
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+        std::lock_guard<std::mutex> lock(mutex);
+        text.push_back(traits_type::to_char_type(c));
+        return c;
+    }
+
+private:
+    std::mutex mutex;
+    std::string text;
+};
+
+// Sends std::cerr to 'target' while it exists.
+struct RedirectStderr {
+    explicit RedirectStderr(std::streambuf& target) : saved(std::cerr.rdbuf(&target)) {}
+    ~RedirectStderr() { std::cerr.rdbuf(saved); }
+    std::streambuf* saved;
+};
+
+// Keeps the repository loaded and answers status/diff requests from other minigit processes
+// until 'minigit daemon stop'. Only paths reported by the file watcher are re-examined per request.
+static int runDaemon(MiniGitSystem& git) {
+    if (!git.isRepository()) {
+        std::cout << NOT_A_REPOSITORY;
+        return 1;
+    }
+    FileWatcher watcher;
+    if (!watcher.start([&](const std::string& dir) { return git.isIgnoredDirectory(dir); })) {
+        std::cout << "Error: Daemon mode needs inotify (Linux).\n";
+        return 1;
+    }
+    DaemonSocket socket;
+    if (!socket.listen(DAEMON_SOCKET)) {
+        std::cout << "Error: Could not listen on " << DAEMON_SOCKET << " (is a daemon already running?)\n";
+        return 1;
+    }
+    git.enableWorkingTreeCache();
+    std::cout << "MiniGit daemon listening on " << DAEMON_SOCKET << "\n";
+    socket.serve(watcher,
+        [&](const FileWatcher::Changes& changes) {
+            if (changes.overflow) git.invalidateWorkingTree();
+            git.markWorkingPathsDirty(changes.paths);
+            if (changes.repositoryChanged) git.reloadRepoState(); // Another process committed, staged, ...
+        },
+        [&](const std::vector<std::string>& args, std::string& output, std::string& errors, bool& stop) {
+            if (args.size() == 1 && args[0] == "stop") {
+                stop = true;
+                output = "MiniGit daemon stopped.\n";
+                return 0;
+            }
+            if (args.empty() || (args[0] != "status" && args[0] != "diff")) {
+                output = "Error: The daemon only answers status and diff.\n";
+                return 1;
+            }
+            std::ostringstream out;
+            SharedErrorBuffer errorBuffer;
+            std::ostream err(&errorBuffer);
+            int code;
+            {
+                RedirectStderr capture(errorBuffer); // What the library reports on its own goes to the client too
+                code = runQuery(git, args[0], std::vector<std::string>(args.begin() + 1, args.end()), out, err);
+            }
+            output = out.str();
+            errors = errorBuffer.str();
+            return code;
+        });
+    std::cout << "MiniGit daemon stopped.\n";
+    return 0;
+}
+
+// 'clone <source> [<directory>] [--depth N]': the repository is built in the target directory (created if needed),
+// so this runs before a MiniGitSystem is constructed for the current one.
+static int runClone(std::vector<std::string> args) {
+    size_t depth = 1;
+    for (size_t i = 0; i < args.size(); ++i) {
+        std::string value;
+        size_t consumed = 1;
+        if (args[i] == "--depth" && i + 1 < args.size()) {
+            value = args[i + 1];
+            consumed = 2;
+        } else if (args[i].rfind("--depth=", 0) == 0) {
+            value = args[i].substr(8);
+        } else {
+            continue;
+        }
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+            args.clear(); // Prints the usage below
+            break;
+        }
+        depth = static_cast<size_t>(std::stoul(value));
+        args.erase(args.begin() + static_cast<std::ptrdiff_t>(i), args.begin() + static_cast<std::ptrdiff_t>(i + consumed));
+        --i;
+    }
+    if (args.empty() || args.size() > 2) {
+        std::cout << "Usage: minigit clone <source> [<directory>] [--depth N]  (N commits per branch, 0 = all; default 1)\n";
+        return 1;
+    }
+    const std::string source = fs::absolute(args[0]).lexically_normal().string(); // Before changing into the target directory
+    if (args.size() == 2) {
+        std::error_code ec;
+        fs::create_directories(args[1], ec);
+        fs::current_path(args[1], ec);
+        if (ec) {
+            std::cout << "Error: Could not enter " << args[1] << ": " << ec.message() << "\n";
+            return 1;
+        }
+    }
+    MiniGitSystem git;
+    return git.clone(source, depth) ? 0 : 1;
+}
+
+// Prints the timing summary (and writes the Chrome trace) when main() returns, whichever way it does.
+struct TimingReport {
+    ~TimingReport() {
+        if (!Trace::enabled()) return;
+        Trace::report(std::cerr);
+        if (!Trace::writeChromeTrace()) std::cerr << "Warning: Could not write the trace file.\n";
+    }
+};
+
+// Removes "--timing" and "--trace=<file>" from the arguments and enables tracing for them
+// (or for MINIGIT_TIMING=1 / MINIGIT_TRACE=<file>).
+static void extractTimingOptions(int& argc, char* argv[]) {
+    const char* timingEnv = std::getenv("MINIGIT_TIMING");
+    const char* traceEnv = std::getenv("MINIGIT_TRACE");
+    bool timing = (timingEnv && *timingEnv && std::string(timingEnv) != "0") || (traceEnv && *traceEnv);
+    std::string tracePath = traceEnv ? traceEnv : "";
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--timing") {
+            timing = true;
+        } else if (arg.rfind("--trace=", 0) == 0 && arg.size() > 8) {
+            timing = true;
+            tracePath = arg.substr(8);
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    if (timing) Trace::enable(tracePath);
+}
+
+int main(int argc, char* argv[]) {
+    extractTimingOptions(argc, argv);
+    TimingReport timingReport;
+
+    // status and diff are answered by a running daemon if there is one (MINIGIT_NO_DAEMON=1 opts out).
+    // Timed runs stay in-process, so the report shows where this process spends its time.
+    if (argc >= 2 && !std::getenv("MINIGIT_NO_DAEMON") && !Trace::enabled()) {
+        std::string command = argv[1];
+        bool stopDaemon = command == "daemon" && argc >= 3 && std::string(argv[2]) == "stop";
+        if (command == "status" || command == "diff" || stopDaemon) {
+            std::string output, errors;
+            int code = DaemonSocket::request(DAEMON_SOCKET, std::vector<std::string>(argv + (stopDaemon ? 2 : 1), argv + argc), output, errors);
+            if (code >= 0) {
+                std::cerr << errors;
+                std::cout << output;
+                return code;
+            }
+            if (stopDaemon) {
+                std::cout << "No MiniGit daemon is running.\n";
+                return 1;
+            }
+        }
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "clone") {
+        return runClone(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    // MiniGitSystem operates on the current directory, so no path argument is needed for the constructor.
+    MiniGitSystem git;
+    if (git.isRepository()) {
+        std::cout << "Loading existing MiniGit repository...\n";
+        std::cout << "MiniGit repository loaded.\n";
+    } else {
+        std::cout << "No existing MiniGit repository found. Call 'init' to create one.\n";
+    }
+
+    if (argc < 2) {
+        std::cout << "Usage: minigit <command> [args...]\n";
+        std::cout << "Commands:\n";
+        std::cout << "  init [--hash=<algo>] [--chunk-threshold=<size>] - Initialize a new MiniGit repository (sha256 or blake3).\n";
+        std::cout << "  clone <source> [<dir>] [--depth N] - Shallow, partial clone; omitted objects are fetched on demand.\n";
+        std::cout << "  add <pathspec>... | -A     - Add file contents (files, directories, globs) to the staging area.\n";
+        std::cout << "  commit <message>          - Record changes to the repository.\n";
+        std::cout << "  log [--first-parent]      - Show commit history.\n";
+        std::cout << "  branch <name>...          - Create new branches at HEAD.\n";
+        std::cout << "  checkout <target> [--jobs N] - Switch branches or restore working tree files.\n";
+        std::cout << "  merge <branch>            - Join another branch's history into the current branch.\n";
+        std::cout << "  stash [push [-m <msg>] | pop | list] - Set uncommitted changes aside, or restore the latest set.\n";
+        std::cout << "  status [--jobs N]         - Show the working tree status.\n";
+        std::cout << "  diff [arg1] [arg2] [--jobs N] [--diff-algorithm=A] [-U<n>] - Show changes between commits, staging, or working tree.\n";
+        std::cout << "  gc (or repack)            - Pack all objects into one delta-compressed packfile.\n";
+        std::cout << "  upgrade                   - Move to the current repository format (fanout object directories).\n";
+        std::cout << "  daemon [stop]             - Serve status/diff from memory for other minigit processes.\n";
+        std::cout << "Options: --timing (timing summary on stderr), --trace=<file> (also Chrome trace JSON)\n";
+        return 1;
+    }
+
+    std::string command = argv[1];
+
+    if (command == "init") {
+        std::string hashName = "sha256";
+        uint64_t chunkThreshold = 0;
+        for (int i = 2; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option.rfind("--hash=", 0) == 0) {
+                hashName = option.substr(7);
+            } else if (option.rfind("--chunk-threshold=", 0) == 0 && parseSize(option.substr(18), chunkThreshold)) {
+                continue;
+            } else {
+                std::cout << "Usage: minigit init [--hash=sha256|blake3] [--chunk-threshold=<size>[K|M|G]]\n";
+                return 1;
+            }
+        }
+        git.init(hashName, chunkThreshold);
+    } else if (command == "add") {
+        // Files are hashed on all cores unless --jobs N says otherwise
+        std::vector<std::string> args(argv + 2, argv + argc);
+        unsigned int jobs = 0;
+        bool jobsGiven = false;
+        if (!extractJobsOption(args, jobs, jobsGiven)) {
+            std::cout << "Error: --jobs expects a number of threads.\n";
+            return 1;
+        }
+        auto allFlag = std::find_if(args.begin(), args.end(), [](const std::string& arg) { return arg == "-A" || arg == "--all"; });
+        const bool all = allFlag != args.end();
+        if (all) args.erase(allFlag);
+        if (args.empty() && !all) {
+            std::cout << "Usage: minigit add <pathspec>... | -A [--jobs N]\n";
+            return 1;
+        }
+        git.setJobs(jobs, jobsGiven);
+        if (!git.add(args, all)) return 1;
+    } else if (command == "commit") {
+        if (argc < 3) {
+            std::cout << "Usage: minigit commit \"<message>\"\n"; // Emphasize quotes for multi-word messages
+            return 1;
+        }
+        std::string message = argv[2];
+        // Combine all arguments into a single message string for messages with spaces
+        for (int i = 3; i < argc; ++i) {
+            message += " " + std::string(argv[i]);
+        }
+        git.commit(message);
+    } else if (command == "log") {
+        if (!git.isRepository()) {
+            std::cout << NOT_A_REPOSITORY;
+            return 1;
+        }
+        printLog(git, argc >= 3 && std::string(argv[2]) == "--first-parent", std::cout, std::cerr);
+    } else if (command == "gc" || command == "repack") {
+        git.gc();
+    } else if (command == "upgrade") {
+        git.upgrade();
+    } else if (command == "branch") {
+        if (argc < 3) {
+            std::cout << "Usage: minigit branch <name>...\n";
+            return 1;
+        }
+        git.branch(std::vector<std::string>(argv + 2, argv + argc)); // Several names are created in one ref update
+    } else if (command == "checkout") {
+        // Large checkouts write files on all cores unless --jobs N says otherwise
+        std::vector<std::string> args(argv + 2, argv + argc);
+        unsigned int jobs = 0;
+        bool jobsGiven = false;
+        if (!extractJobsOption(args, jobs, jobsGiven)) {
+            std::cout << "Error: --jobs expects a number of threads.\n";
+            return 1;
+        }
+        if (args.empty()) {
+            std::cout << "Usage: minigit checkout <branch_name_or_commit_hash> [--jobs N]\n";
+            return 1;
+        }
+        git.setJobs(jobs, jobsGiven);
+        git.checkout(args[0]);
+    } else if (command == "merge") {
+        if (argc != 3) {
+            std::cout << "Usage: minigit merge <branch_name_or_commit_hash>\n";
+            return 1;
+        }
+        git.merge(argv[2]);
+    } else if (command == "stash") {
+        std::vector<std::string> args(argv + 2, argv + argc);
+        const std::string action = args.empty() || args[0] == "-m" ? "push" : args[0];
+        if (!args.empty() && args[0] == action) args.erase(args.begin());
+        if (action == "push" && (args.empty() || (args.size() == 2 && args[0] == "-m"))) {
+            git.stash(args.empty() ? "" : args[1]);
+        } else if (action == "pop" && args.empty()) {
+            git.stashPop();
+        } else if (action == "list" && args.empty()) {
+            std::vector<MiniGitSystem::StashEntry> entries = git.listStash();
+            for (size_t i = 0; i < entries.size(); ++i) std::cout << "stash@{" << i << "}: " << entries[i].message << "\n";
+        } else {
+            std::cout << "Usage: minigit stash [push [-m <message>] | pop | list]\n";
+            return 1;
+        }
+    } else if (command == "status" || command == "diff") {
+        return runQuery(git, command, std::vector<std::string>(argv + 2, argv + argc), std::cout, std::cerr);
+    } else if (command == "daemon") {
+        return runDaemon(git);
+    } else {
+        std::cout << "Unknown command: " << command << "\n";
+        std::cout << "Commands: init, clone <source>, add <file>, commit <message>, log, branch <name>, checkout <target>, merge <branch>, stash, status, diff, gc, upgrade, daemon\n";
+        return 1;
+    }
+
+    return 0;
 }
\ No newline at end of file